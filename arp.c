@@ -4,9 +4,9 @@
  * @author Perry Spagnola 
  * @date 2/19/11 - created
  * @version 1.0
- * @brief Sends "arp" and "ping" commands, and retrieves and processes the responses.
- * @details The "arp" and "ping" commands are invoked for very specific purposes. Please
- * see the function descriptions for details.
+ * @brief Pings hosts, and sends "arp" commands and retrieves and processes the responses.
+ * @details Pings are sent in-process, see icmp.c. The "arp" command is invoked for a
+ * very specific purpose. Please see the function descriptions for details.
  *
  * @copyright Copyright 2011 Perry M. Spagnola. All rights reserved.
  *
@@ -25,229 +25,325 @@
  */
 
 #include "wol_lib.h"
+#include "wol_stats.h"
+#include "wol_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+/** The time pingIP() waits for the echo reply, in milliseconds. */
+#define PING_TIMEOUT_MS  1000
+
 
 /**
  * Sends a single ping packet to the specified IP address. 
- * Calls the ping command: <code>ping -c 1 ip-address</code>.
+ * The ICMP echo request is sent in-process by <code>pingIPWithTimeout()</code>,
+ * waiting up to PING_TIMEOUT_MS for the reply.
+ *
+ * When the lookup cache is on, a recent result for the address is
+ * returned without pinging, see <code>wol_cache_enable()</code>.
  *
  * @param ipAddr - the IP address to ping.
  *
- * @return the success or error of the ping command. The specific error cannot be retrieved.
+ * @return the success or error of the ping. The specific error cannot be retrieved.
  * @retval 0 - success
  * @retval 1 - error
  */
 int pingIP(char *ipAddr)
 {
-	FILE *in;
-	extern FILE *popen();
-	char buff[512];
-	char command[512] = "ping -c 1 ";
-	char errorCondition[512] = "1 packets transmitted, 0 packets received";
-	int returnValue = 0;
-	
-	/**
-     * Build the IP specific PING command by concatenating the IP address
-     * to the command buffer initialized with the "ping -c 1" command string.
-     */
-	strcat(command, ipAddr);
+	int status;
 	
-	/** 
-	 * <code>popen()</code> creates a pipe so we can read the output
-	 * of the ping command we are invoking. If it fails, the return value is
-     * set to one (1), an error.
-	 */
-	if (!(in = popen(command, "r"))) {
-		returnValue = 1;
-	}
-	else {
-		/** 
-		 * Else, read the output of the ping command, one line at a time.
-		 */
-		while (fgets(buff, sizeof(buff), in) != NULL ) {
-			//printf("Output: %s", buff);
-			/**
-			 * Look for the error condition: "1 packets transmitted, 0 packets received". 
-             * If found, set the return value to one (1), an error, and break out of the loop.
-			 */
-			if (strncmp(errorCondition, buff, strlen(errorCondition)) == 0) {
-				returnValue = 1;
-				break;
-			}
-		}
+	if (wol_cache_get(WOL_CACHE_PING, ipAddr, NULL, 0, &status) == 0) {
+		return status;
 	}
-					
-	/**
-     * The function has completed. Close the pipe, and return the success or error value.
-     */
-	pclose(in);	
+	status = pingIPWithTimeout(ipAddr, PING_TIMEOUT_MS, NULL);
+	wol_cache_put(WOL_CACHE_PING, ipAddr, status, NULL);
 	
-	return returnValue;
+	return status;
 }
 
 
+#if !defined(__linux__)
 /**
  * Retrieves the MAC address for the specified IP address.
  * Sends the arp command: <code>arp ip-address</code>. Searches the return
  * strings for a colon, and returns the contiguous string containing the colon.
  * Note: The arp command does not return a fully formatted MAC address string.
  * Leading zeroes are missing from the octets, as an example. The MAC address
- * string is formatted by an internal call to <code>formatMAC()</code>.
+ * string is formatted by an internal call to <code>formatMAC_r()</code>.
+ * The IP address must be a dotted quad, so nothing else reaches the shell.
  *
  * @param ipAddr - the IP address to retrieve the MAC address for.
  * @param macAddr - a pointer to the buffer to write the formatted MAC address into.
+ * @param macLen - the size of the buffer
  *
  * @return the success or error of the arp command. The specific error cannot be retrieved.
  * @retval 0 - success
  * @retval 1 - error
  */
-int macForIP(char *ipAddr, char *macAddr)
+static int macForIPArpCmd(const char *ipAddr, char *macAddr, size_t macLen)
 {
 	FILE *in;
-	extern FILE *popen();
 	char buff[512];
-	char command[1024] = "arp ";
-	int returnValue = 0;
+	char command[32];
+	struct in_addr ip;
+	int returnValue = 1;
 	
 	/**
-     * Build the IP specific ARP command by concatenating the IP address
-     * to the command buffer initialized with the "arp" command string.
+     * Build the IP specific ARP command. The address is checked first, as it
+     * is passed to the shell.
      */
-	strcat(command, ipAddr);
+	if (inet_pton(AF_INET, ipAddr, &ip) != 1 ||
+		snprintf(command, sizeof(command), "arp %s", ipAddr) >= (int)sizeof(command)) {
+		return 1;
+	}
 	
 	/**
-     * Execute the "arp ipAddr" command. If it fails, set the return value
-     * to one (1), an error.
+     * Execute the "arp ipAddr" command. If it fails, return one (1), an error.
      */
 	if (!(in = popen(command, "r"))) {
-		returnValue = 1;
+		return 1;
 	}
-	else {
+	
+	/**
+     * Read the output, one line at a time.
+     */
+	while (fgets(buff, sizeof(buff), in) != NULL ) {
 		/**
-         * Else, read the output, one line at a time.
+         * Search for the MAC address. Tokenize the line, and iterate
+         * through the tokens. Look for a colon. It will be the only
+         * sub-string token with a colon. strtok_r() keeps its state in
+         * savePtr, not in a global.
          */
-		while (fgets(buff, sizeof(buff), in) != NULL ) {
-			//printf("Output: %s", buff);
-			
+		char *savePtr = NULL;
+		char *pch = strtok_r (buff, " ", &savePtr);
+		
+		while (pch != NULL && strchr(pch, ':') == NULL) {
+			pch = strtok_r (NULL, " ", &savePtr);
+		}
+		
+		if (pch == NULL) {
 			/**
-			 * Break the command output string into tokens separated
-			 * by white space.
-			 */
-			char * pch;
-			pch = strtok (buff," ");
-			
+             * If the MAC address is not found, set the MAC address string
+             * to: "no MAC found".
+             */
+			returnValue = (snprintf(macAddr, macLen, "no MAC found") >= (int)macLen);
+		}
+		else {
 			/**
-			 * Search for the MAC address. Tokenize the line, and iterate
-             * through the tokens. Look for a colon. It will be the only 
-             * sub-string token with a colon. WHen the ":" is found terminate
-             * iterating through the tokens.
-			 */
-			char macAddrTemp[32] = "";
-			int found = 0;
-			while (pch != NULL) {
-				//printf ("%s\n",pch);
-				if (strchr(pch, ':') != 0) {
-					/* found the MAC address */
-					strcpy(macAddrTemp, pch);
-					found = 1;
-					break;
-				}
-				pch = strtok (NULL, " ");
-			}
-			
-			if (!found) {
-                /**
-                 * If the MAC address is not found, set the MAC address string
-                 * to: "no MAC found".
-                 */
-				strcpy(macAddr, "no MAC found");
-			}
-			else {
-				/**
-				 * Else, found the MAC address. Format it to make sure each
-				 * octet has two hex digits. If not, add the leading 0. Set the
-                 * return value to the success or error condition of the formatMAC()
-                 * function, and break out of the line iterator loop.
-				 */
-				returnValue = formatMAC(macAddrTemp, macAddr);
-				break;
-			}
-		}			
+             * Else, found the MAC address. Format it to make sure each
+             * octet has two hex digits, and stop reading.
+             */
+			returnValue = formatMAC_r(pch, macAddr, macLen);
+			break;
+		}
 	}
 	
-	/**
-     * The function is complete. Close the pipe, and return the success or error value.
-     */
 	pclose(in);
 	
-	return returnValue;	
+	return returnValue;
 }
+#endif
 
 
 /**
- * Formats the MAC address string ito the classic six two hex digit octets
- * separated by colons. Mainly looks for single digit octets and adds a
- * leading zero.
+ * Retrieves the MAC address for the specified IP address, bypassing the
+ * lookup cache.
+ * On Linux the MAC address is looked up in the live map of the neighbor
+ * watcher when it is running, see <code>wol_neigh_watch_start()</code>, and
+ * otherwise in a snapshot of the kernel neighbor table, see
+ * <code>neighTableLoad()</code>. Elsewhere the arp command is sent,
+ * see <code>macForIPArpCmd()</code>. The MAC address is written as six two hex
+ * digit octets separated by colons. If the IP address has no entry, the MAC
+ * address string is set to: "no MAC found".
  *
- * @param unformattedMAC - the MAC address string to format
- * @param formattedMAC - a pointer to the buffer to write the formatted MAC address into.
+ * @param ipAddr - the IP address to retrieve the MAC address for.
+ * @param macAddr - a pointer to the buffer to write the formatted MAC address into.
+ * @param macLen - the size of the buffer, WOL_MAC_STRLEN is enough
  *
- * @return zero (0) if successful, there is no failure mode for this function
+ * @return the success or error of the lookup. The specific error cannot be retrieved.
  * @retval 0 - success
+ * @retval 1 - error, or the buffer is too small
  */
-int formatMAC(char *unformattedMAC, char *formattedMAC) {
-	
-	char tempbuf[3] = ""; /* buffer for a MAC address octet */
-	char delims[] = ":";  /* the delimiter for octet separation */
-	char *token = NULL;  /* the current token */
+static int macForIPLookup(const char *ipAddr, char *macAddr, size_t macLen)
+{
+#if defined(__linux__)
+	wol_neigh_table *table;
+	char found[WOL_MAC_STRLEN];
+	struct in_addr ip;
+	wol_mac mac;
+	int rc;
+	WOL_STATS_START(start);
 	
-    /**
-     * Tokenize the unformatted MAC address string using ":" as a delimiter.
-     */
-	token = strtok( unformattedMAC, delims );
+	if (macLen == 0) {
+		return 1;
+	}
 	
-    /**
-     * Iterate through the tokens.
+	/**
+     * Ask the neighbor watcher first. It answers from memory, without a
+     * netlink dump.
      */
-	while( token != NULL ) {
-		// DEBUG: printf( "result is \"%s\"\n", result );
-		
-		if (strlen(token) == 1) {
-            /**
-             * If the token is only one character, add a leading zero, and
-             * concatenate it to the formatted MAC address string.
-             */
-			// DEBUG:printf("correcting: %s\n", result);
-			strcpy(tempbuf, "0");
-			strcat(tempbuf, token);
-			// DEBUG:printf("corrected: %s\n", tempbuf);
-			
-			strcat(formattedMAC, tempbuf);
+	if (inet_pton(AF_INET, ipAddr, &ip) == 1 && (rc = wol_neigh_watch_lookup(ip.s_addr, &mac)) >= 0) {
+		WOL_STATS_COUNT(WOL_CTR_ARP_LOOKUPS, 1);
+		if (rc == 0) {
+			wol_mac_format(mac, WOL_MAC_LOWER, found, sizeof(found));
 		}
 		else {
-            /**
-             * Else, simply concatenate the token as-is.
-             */
-			strcat(formattedMAC, token);
-		}
-		
-		/**
-         * Get the next token. If it is not NULL, concatenate the delimiter ":" 
-         * to the formatted MAC address string. The token will be processed by 
-         * the next iteration of the loop. If it is NULL, nothing is concatenated,
-         * and the loop will terminate.
-         */
-		token = strtok( NULL, delims );		
-		if (token) {
-			strcat(formattedMAC, delims);
+			WOL_STATS_COUNT(WOL_CTR_ARP_MISSES, 1);
+			strcpy(found, "no MAC found");
 		}
+		WOL_STATS_LATENCY(WOL_HIST_ARP, start);
+	}
+	
+	/**
+     * Else fetch the neighbor table. If it cannot be read, return one (1), an error.
+     */
+	else if ((table = neighTableLoad()) == NULL) {
+		WOL_STATS_ERROR(WOL_STAGE_ARP, errno);
+		macAddr[0] = '\0';
+		return 1;
 	}
 	
-    /**
-     * The function has completed. Return a success value. There is no failure 
-     * mode for this function.
+	/**
+     * A missing entry is not an error, the MAC address string tells the caller.
      */
-	return 0;	
+	else {
+		WOL_STATS_COUNT(WOL_CTR_ARP_LOOKUPS, 1);
+		if (neighTableLookup(table, (char *)ipAddr, found) != 0) {
+			WOL_STATS_COUNT(WOL_CTR_ARP_MISSES, 1);
+		}
+		neighTableFree(table);
+		WOL_STATS_LATENCY(WOL_HIST_ARP, start);
+	}
+	
+	if (strlen(found) >= macLen) {
+		macAddr[0] = '\0';
+		return 1;
+	}
+	strcpy(macAddr, found);
+	
+	return 0;
+#else
+	return macForIPArpCmd(ipAddr, macAddr, macLen);
+#endif
+}
+
+
+/**
+ * Retrieves the MAC address for the specified IP address. Reentrant: there is
+ * no hidden state, the IP address is not modified, and at most macLen bytes
+ * are written. The MAC address is looked up as for
+ * <code>macForIPLookup()</code>, unless the lookup cache is on and holds a
+ * recent result for the address, see <code>wol_cache_enable()</code>.
+ * "no MAC found" is cached too, for the shorter negative TTL.
+ *
+ * @param ipAddr - the IP address to retrieve the MAC address for.
+ * @param macAddr - a pointer to the buffer to write the formatted MAC address into.
+ * @param macLen - the size of the buffer, WOL_MAC_STRLEN is enough
+ *
+ * @return the success or error of the lookup. The specific error cannot be retrieved.
+ * @retval 0 - success
+ * @retval 1 - error, or the buffer is too small
+ */
+int macForIP_r(const char *ipAddr, char *macAddr, size_t macLen)
+{
+	int status;
+	
+	if (wol_cache_get(WOL_CACHE_MAC, ipAddr, macAddr, macLen, &status) == 0) {
+		return 0;
+	}
+	if (macForIPLookup(ipAddr, macAddr, macLen) != 0) {
+		return 1;
+	}
+	wol_cache_put(WOL_CACHE_MAC, ipAddr, strcmp(macAddr, "no MAC found") == 0, macAddr);
+	
+	return 0;
+}
+
+
+/**
+ * Retrieves the MAC address for the specified IP address, as for
+ * <code>macForIP_r()</code>.
+ *
+ * @param ipAddr - the IP address to retrieve the MAC address for.
+ * @param macAddr - a pointer to the buffer, at least WOL_MAC_STRLEN bytes, to write the formatted MAC address into.
+ *
+ * @return the success or error of the lookup. The specific error cannot be retrieved.
+ * @retval 0 - success
+ * @retval 1 - error
+ */
+int macForIP(char *ipAddr, char *macAddr)
+{
+	return macForIP_r(ipAddr, macAddr, WOL_MAC_STRLEN);
+}
+
+
+/**
+ * Retrieves the MAC address for the specified IP address as a packed
+ * wol_mac value, as for <code>macForIP()</code>.
+ *
+ * @param ipAddr - the IP address to retrieve the MAC address for.
+ * @param mac - populated with the packed MAC address.
+ *
+ * @return the success or error of the lookup.
+ * @retval 0 - success
+ * @retval 1 - error, or no MAC address found
+ */
+int macForIPAddr(char *ipAddr, wol_mac *mac)
+{
+	char macAddr[WOL_MAC_STRLEN] = "";
+	
+	if (macForIP_r(ipAddr, macAddr, sizeof(macAddr)) != 0 || wol_mac_parse(macAddr, mac) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * Formats the MAC address string into the classic six two hex digit lowercase
+ * octets separated by colons. Octets missing their leading zero, as in the
+ * output of the arp command, are accepted. The MAC address is parsed into a
+ * wol_mac and formatted by <code>wol_mac_format()</code>, so the unformatted
+ * string is not modified. Reentrant.
+ *
+ * @param unformattedMAC - the MAC address string to format
+ * @param formattedMAC - a pointer to the buffer to write the formatted MAC address into.
+ * @param len - the size of the buffer, WOL_MAC_STRLEN is enough
+ *
+ * @return the success or error of the formatting
+ * @retval 0 - success
+ * @retval 1 - error, the string is not a MAC address, or the buffer is too small. formattedMAC is set to "".
+ */
+int formatMAC_r(const char *unformattedMAC, char *formattedMAC, size_t len)
+{
+	wol_mac mac;
+	
+	if (len == 0) {
+		return 1;
+	}
+	if (wol_mac_parse(unformattedMAC, &mac) < 0 ||
+		wol_mac_format(mac, WOL_MAC_LOWER, formattedMAC, len) < 0) {
+		formattedMAC[0] = '\0';
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * Formats the MAC address string, as for <code>formatMAC_r()</code>.
+ *
+ * @param unformattedMAC - the MAC address string to format
+ * @param formattedMAC - a pointer to the buffer, at least WOL_MAC_STRLEN bytes, to write the formatted MAC address into.
+ *
+ * @return the success or error of the formatting
+ * @retval 0 - success
+ * @retval 1 - error, the string is not a MAC address. formattedMAC is set to "".
+ */
+int formatMAC(char *unformattedMAC, char *formattedMAC)
+{
+	return formatMAC_r(unformattedMAC, formattedMAC, WOL_MAC_STRLEN);
 }
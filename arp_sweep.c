@@ -0,0 +1,437 @@
+/**
+ * @file arp_sweep.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Discovers the MAC addresses of a whole subnet with an active ARP sweep.
+ * @details An ARP request is broadcast for every address of a CIDR range from
+ * one AF_PACKET socket, paced to a configured rate, and the replies are
+ * collected as they arrive into an IP to MAC address index, the same one the
+ * kernel neighbor table is loaded into. Cold hosts are found without a ping
+ * and an arp command per address. Only available on Linux.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* ppoll() */
+#endif
+
+#include "neigh.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#define ARP_SWEEP_DEF_RATE   2000      /**< requests per second by default */
+#define ARP_SWEEP_DEF_WAIT   1000      /**< milliseconds to wait after the last request */
+#define ARP_SWEEP_MIN_PREFIX 16        /**< the largest range swept, a /16 */
+#define ARP_SWEEP_RCVBUF     (1 << 20)
+
+#define ARP_HRD_ETHER   1
+#define ARP_OP_REQUEST  1
+#define ARP_OP_REPLY    2
+
+
+/**
+ * An ARP packet for IPv4 over Ethernet, as sent and received on a SOCK_DGRAM
+ * packet socket, without the Ethernet header. 28 bytes, no padding.
+ */
+struct arp_sweep_pkt {
+	uint16_t hrd;                  /**< hardware type, ARP_HRD_ETHER */
+	uint16_t pro;                  /**< protocol type, ETH_P_IP */
+	uint8_t hln;                   /**< hardware address length, 6 */
+	uint8_t pln;                   /**< protocol address length, 4 */
+	uint16_t op;                   /**< ARP_OP_REQUEST or ARP_OP_REPLY */
+	unsigned char sha [6];         /**< sender hardware address */
+	unsigned char spa [4];         /**< sender protocol address */
+	unsigned char tha [6];         /**< target hardware address */
+	unsigned char tpa [4];         /**< target protocol address */
+};
+
+
+/**
+ * Function to read the monotonic clock.
+ *
+ * @return nanoseconds
+ */
+static long long arp_sweep_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+
+/**
+ * Function to parse a range in CIDR notation.
+ *
+ * @param cidr - "a.b.c.d/len", or "a.b.c.d" for a single address
+ * @param net - populated with the network address, host byte order
+ * @param prefix - populated with the prefix length
+ *
+ * @return 0 success, or -1 malformed
+ */
+static int arp_sweep_parse (const char *cidr, uint32_t *net, int *prefix)
+{
+	char buf [INET_ADDRSTRLEN + 4];
+	char *slash, *end;
+	struct in_addr addr;
+	long len = 32;
+
+	if (strlen (cidr) >= sizeof (buf)) {
+		return (-1);
+	}
+	strcpy (buf, cidr);
+	if ((slash = strchr (buf, '/')) != NULL) {
+		*slash++ = '\0';
+		len = strtol (slash, &end, 10);
+		if (end == slash || *end != '\0' || len < 0 || len > 32) {
+			return (-1);
+		}
+	}
+	if (inet_pton (AF_INET, buf, &addr) != 1) {
+		return (-1);
+	}
+	*prefix = (int)len;
+	*net = ntohl(addr.s_addr) & (len == 0 ? 0 : 0xffffffffu << (32 - len));
+
+	return (0);
+}
+
+
+/**
+ * Function to find the interface and the local address to send from. Without
+ * an interface name, the interface whose subnet contains the range is used.
+ * The local address is the interface address in the range, or its first IPv4
+ * address.
+ *
+ * @param ifName - the interface name, or NULL
+ * @param net - the network address of the range, host byte order
+ * @param found - populated with the interface name, IF_NAMESIZE bytes
+ * @param local - populated with the local address, network byte order
+ *
+ * @return 0 success, or -1 with errno ENODEV if there is no such interface
+ */
+static int arp_sweep_iface (const char *ifName, uint32_t net, char *found, uint32_t *local)
+{
+	struct ifaddrs *ifList, *ifa;
+	int matched = 0;
+
+	if (getifaddrs (&ifList) < 0) {
+		return (-1);
+	}
+	for (ifa = ifList; ifa != NULL; ifa = ifa->ifa_next) {
+		uint32_t addr, mask;
+		int inRange;
+
+		if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET || ifa->ifa_netmask == NULL ||
+			(ifa->ifa_flags & (IFF_UP | IFF_LOOPBACK | IFF_NOARP)) != IFF_UP) {
+			continue;
+		}
+		if (ifName != NULL && strcmp (ifa->ifa_name, ifName) != 0) {
+			continue;
+		}
+		addr = ntohl(((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr);
+		mask = ntohl(((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr.s_addr);
+		inRange = ((addr & mask) == (net & mask));
+		if ((ifName == NULL && !inRange) || (matched && !inRange)) {
+			continue;
+		}
+		strncpy (found, ifa->ifa_name, IF_NAMESIZE - 1);
+		found [IF_NAMESIZE - 1] = '\0';
+		*local = htonl(addr);
+		matched = 1;
+		if (inRange) {
+			break;
+		}
+	}
+	freeifaddrs (ifList);
+
+	if (!matched) {
+		errno = ENODEV;
+		return (-1);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to read the ARP packets queued on the socket, and index the
+ * senders in the range. Replies and requests are both taken: a host that
+ * sends either has told us its address. Our own requests are skipped.
+ *
+ * @param fd - the packet socket
+ * @param net - the network address of the range, host byte order
+ * @param mask - the netmask of the range, host byte order
+ * @param table - the index to populate
+ *
+ * @return 0 success, or -1 on failure to allocate
+ */
+static int arp_sweep_drain (int fd, uint32_t net, uint32_t mask, wol_neigh_table *table)
+{
+	static const unsigned char zeroes [6], ones [6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	struct arp_sweep_pkt pkt;
+	struct sockaddr_ll from;
+	socklen_t fromLen;
+	ssize_t len;
+	uint32_t ip;
+
+	for (;;) {
+		fromLen = sizeof (from);
+		len = recvfrom (fd, &pkt, sizeof (pkt), MSG_DONTWAIT, (struct sockaddr *)&from, &fromLen);
+		if (len < 0) {
+			return ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1);
+		}
+		if (len < (ssize_t)sizeof (pkt) || from.sll_pkttype == PACKET_OUTGOING ||
+			pkt.hrd != htons(ARP_HRD_ETHER) || pkt.pro != htons(ETH_P_IP) || pkt.hln != 6 || pkt.pln != 4 ||
+			(pkt.op != htons(ARP_OP_REPLY) && pkt.op != htons(ARP_OP_REQUEST))) {
+			continue;
+		}
+		memcpy (&ip, pkt.spa, 4);
+		if ((ntohl(ip) & mask) != net || memcmp (pkt.sha, zeroes, 6) == 0 || memcmp (pkt.sha, ones, 6) == 0) {
+			continue;
+		}
+		if (neigh_table_insert (table, ip, wol_mac_from_bytes (pkt.sha)) < 0) {
+			return (-1);
+		}
+	}
+}
+
+
+/**
+ * Function to sweep a range with ARP requests, and collect the replies.
+ *
+ * @param fd - the packet socket, bound to the interface
+ * @param ifIndex - the interface index
+ * @param srcAddr - the interface hardware address
+ * @param local - the local address, network byte order
+ * @param net - the network address of the range, host byte order
+ * @param prefix - the prefix length of the range
+ * @param rate - requests per second
+ * @param waitMs - milliseconds to wait for replies after the last request
+ * @param table - the index to populate
+ *
+ * @return 0 success, or -1 with errno set
+ */
+static int arp_sweep_run (int fd, int ifIndex, const unsigned char *srcAddr, uint32_t local,
+						  uint32_t net, int prefix, int rate, int waitMs, wol_neigh_table *table)
+{
+	struct arp_sweep_pkt pkt;
+	struct sockaddr_ll to;
+	struct pollfd pfd;
+	uint32_t mask = (prefix == 0) ? 0 : 0xffffffffu << (32 - prefix);
+	uint32_t first = net, last = net | ~mask, next;
+	long long start, now, interval = 1000000000LL / rate, deadline = 0;
+	uint64_t sent = 0;
+
+	/**
+     * The network and broadcast addresses are not hosts, except in a /31 or
+     * a /32.
+     */
+	if (prefix < 31) {
+		first++;
+		last--;
+	}
+
+	memset (&pkt, 0, sizeof (pkt));
+	pkt.hrd = htons(ARP_HRD_ETHER);
+	pkt.pro = htons(ETH_P_IP);
+	pkt.hln = 6;
+	pkt.pln = 4;
+	pkt.op = htons(ARP_OP_REQUEST);
+	memcpy (pkt.sha, srcAddr, 6);
+	memcpy (pkt.spa, &local, 4);
+
+	memset (&to, 0, sizeof (to));
+	to.sll_family = AF_PACKET;
+	to.sll_protocol = htons(ETH_P_ARP);
+	to.sll_ifindex = ifIndex;
+	to.sll_halen = 6;
+	memset (to.sll_addr, 0xff, 6);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	next = first;
+	start = arp_sweep_now ();
+	for (;;) {
+		struct timespec ts;
+		long long wait;
+
+		/**
+         * Send every request that is due. A full queue is retried at the
+         * next pass, so the pace slips rather than requests being lost.
+         */
+		now = arp_sweep_now ();
+		while (deadline == 0 && now - start >= (long long)sent * interval) {
+			uint32_t ip = htonl(next);
+
+			if (ip != local) {
+				memcpy (pkt.tpa, &ip, 4);
+				if (sendto (fd, &pkt, sizeof (pkt), 0, (struct sockaddr *)&to, sizeof (to)) < 0) {
+					if (errno == EAGAIN || errno == ENOBUFS || errno == EINTR) {
+						break;
+					}
+					return (-1);
+				}
+				sent++;
+			}
+			if (next == last) {
+				deadline = arp_sweep_now () + (long long)waitMs * 1000000LL;
+				break;
+			}
+			next++;
+		}
+
+		/**
+         * Wait for replies until the next request is due, or the final wait
+         * is over.
+         */
+		now = arp_sweep_now ();
+		if (deadline != 0) {
+			if (now >= deadline) {
+				break;
+			}
+			wait = deadline - now;
+		}
+		else {
+			wait = start + (long long)sent * interval - now;
+			if (wait < 100000) {
+				wait = 100000;
+			}
+		}
+		ts.tv_sec = wait / 1000000000LL;
+		ts.tv_nsec = wait % 1000000000LL;
+		if (ppoll (&pfd, 1, &ts, NULL) < 0 && errno != EINTR) {
+			return (-1);
+		}
+		if (arp_sweep_drain (fd, net, mask, table) < 0) {
+			return (-1);
+		}
+	}
+
+	return (arp_sweep_drain (fd, net, mask, table));
+}
+
+#endif /* __linux__ */
+
+
+/**
+ * Function to discover the MAC addresses of a range of IPv4 addresses with an
+ * active ARP sweep. An ARP request is broadcast for each address of the
+ * range, at most ratePps per second, and the replies are collected until
+ * waitMs after the last request. A /20 is swept in about three seconds at the
+ * default rate. The kernel neighbor table is not consulted or changed.
+ *
+ * @param ifName - the interface to sweep from, or NULL for the one whose subnet contains the range
+ * @param cidr - the range in CIDR notation, e.g. "10.1.0.0/20", at most a /16
+ * @param ratePps - requests per second, 0 for the default 2000
+ * @param waitMs - milliseconds to wait for replies after the last request, 0 for the default 1000
+ *
+ * @return the hosts that answered, or NULL with errno set on failure. Look up
+ * with neighTableLookup(), and free with neighTableFree(). Needs CAP_NET_RAW.
+ */
+wol_neigh_table *wol_arp_sweep (const char *ifName, const char *cidr, int ratePps, int waitMs)
+{
+#if defined(__linux__)
+	wol_neigh_table *table;
+	struct ifreq ifr;
+	struct sockaddr_ll sll;
+	char found [IF_NAMESIZE];
+	unsigned char srcAddr [6];
+	uint32_t net, local;
+	int fd, prefix, rcvBuf = ARP_SWEEP_RCVBUF, ifIndex;
+
+	if (cidr == NULL || arp_sweep_parse (cidr, &net, &prefix) < 0 || prefix < ARP_SWEEP_MIN_PREFIX ||
+		(ifName != NULL && strlen (ifName) >= IF_NAMESIZE)) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if (arp_sweep_iface (ifName, net, found, &local) < 0) {
+		return (NULL);
+	}
+
+	if ((fd = socket (AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ARP))) < 0) {
+		return (NULL);
+	}
+
+	/**
+     * Look up the interface index, and its hardware address for the requests,
+     * and bind, so only that interface's ARP traffic is received.
+     */
+	memset (&ifr, 0, sizeof (ifr));
+	strcpy (ifr.ifr_name, found);
+	if (ioctl (fd, SIOCGIFINDEX, &ifr) < 0) {
+		goto fail;
+	}
+	ifIndex = ifr.ifr_ifindex;
+	if (ioctl (fd, SIOCGIFHWADDR, &ifr) < 0) {
+		goto fail;
+	}
+	memcpy (srcAddr, ifr.ifr_hwaddr.sa_data, 6);
+
+	memset (&sll, 0, sizeof (sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ARP);
+	sll.sll_ifindex = ifIndex;
+	if (bind (fd, (struct sockaddr *)&sll, sizeof (sll)) < 0) {
+		goto fail;
+	}
+	setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof (rcvBuf));
+
+	if ((table = neigh_table_new (prefix >= 24 ? 256 : 1u << (32 - prefix) >> 2)) == NULL) {
+		goto fail;
+	}
+	if (arp_sweep_run (fd, ifIndex, srcAddr, local, net, prefix, ratePps > 0 ? ratePps : ARP_SWEEP_DEF_RATE,
+					   waitMs > 0 ? waitMs : ARP_SWEEP_DEF_WAIT, table) < 0) {
+		int err = errno;
+
+		neighTableFree (table);
+		errno = err;
+		goto fail;
+	}
+
+	close (fd);
+	return (table);
+
+fail:
+	close (fd);
+	return (NULL);
+#else
+	(void)ifName;
+	(void)cidr;
+	(void)ratePps;
+	(void)waitMs;
+	errno = ENOSYS;
+	return (NULL);
+#endif
+}
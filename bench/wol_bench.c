@@ -0,0 +1,768 @@
+/**
+ * @file wol_bench.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Benchmark harness for the wol_lib entry points.
+ * @details Microbenchmarks time the parsing and formatting functions and magic
+ * packet construction in batches, and report the median, best and worst batch
+ * in nanoseconds per call; only the latency benchmarks, which time each call,
+ * report a p99. End-to-end benchmarks measure send throughput
+ * against a loopback wol_listen receiver, and the latency of pingIP() and macForIP()
+ * against localhost, or a host given with --host. The send_wol() benchmark
+ * broadcasts real magic packets on the attached network, so it only runs
+ * with --broadcast.
+ * Stress benchmarks run the reentrant _r functions from one thread, then from
+ * --threads threads at once, one per core by default and at least 2, and
+ * check every result against the single threaded one; the rates show how
+ * lookups scale. The deviceInfoForHost_r() stress needs an mDNS responder
+ * at --host, and is skipped without one.
+ * Results are written as JSON, or CSV with --csv, one record per benchmark,
+ * so runs can be diffed and tracked for regressions.
+ *
+ * Build on Linux from this directory:
+ *
+ *     gcc -std=gnu99 -O2 -pthread -I.. -o wol_bench wol_bench.c ../ *.c
+ *
+ * (without the space in the last glob). Usage:
+ *
+ *     wol_bench [--csv] [--filter substring] [--host ip] [--scale n] [--threads n] [--broadcast]
+ *
+ * The ping benchmarks need an ICMP socket, see pingIPWithTimeout().
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+#include "in_ether.h"
+#include "wol_listen.h"
+#include "wol_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/** Not exported by wol_lib.h. */
+int buildDigCmd(char *server, char *hostName, char *port, char *serviceType, char *domain, char *query, char *cmd);
+
+#define BENCH_REPEATS     15           /**< timed batches per microbenchmark */
+#define BENCH_BATCH       20000        /**< calls per microbenchmark batch */
+#define BENCH_SENDS       50000        /**< packets per throughput benchmark */
+#define BENCH_PINGS       200          /**< calls per latency benchmark */
+#define BENCH_MACS        1024         /**< distinct MAC strings cycled through */
+#define BENCH_PORT        47009        /**< the loopback receiver's port */
+#define BENCH_STRESS      200000       /**< calls per thread per stress benchmark */
+#define BENCH_MAX_THREADS 256
+
+
+/**
+ * One benchmark result. Microbenchmarks fill the per call times of their
+ * batches: the median, fastest and slowest batch means. Latency benchmarks
+ * time each call, and fill the true percentiles. Throughput and stress
+ * benchmarks fill the mean time per call, and the rates.
+ */
+struct bench_result {
+	const char *name;
+	const char *kind;                  /**< "micro", "throughput", "latency" or "stress" */
+	long iterations;
+	double medianNs;
+	double minNs;
+	double maxNs;
+	double p99Ns;                      /**< latency only, 0 where not measured */
+	double opsPerSec;
+	double received;                   /**< throughput: the fraction the receiver saw; stress: the fraction correct */
+};
+
+static int csvOutput = 0;
+static int resultCount = 0;
+static const char *filter = NULL;
+static const char *host = "127.0.0.1";
+static int scale = 1;
+static int threads = 0;
+static int stressFailed = 0;
+static int broadcast = 0;
+
+static char *macStrs [BENCH_MACS];            /**< mixed styles, dashed included */
+static char macBuf [BENCH_MACS][WOL_MAC_STRLEN];
+static char *colonStrs [BENCH_MACS];          /**< colon separated only, as in_ether() takes */
+static char colonBuf [BENCH_MACS][WOL_MAC_STRLEN];
+static char rawMacBuf [BENCH_MACS][WOL_MAC_STRLEN];
+
+/** Defeats dead code elimination of the benchmarked results. */
+static volatile unsigned long sink;
+
+
+/**
+ * Function to read the monotonic clock in nanoseconds.
+ */
+static long long bench_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+
+static int bench_cmp_double (const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return ((x > y) - (x < y));
+}
+
+
+/**
+ * Function to check the --filter option.
+ */
+static int bench_selected (const char *name)
+{
+	return (filter == NULL || strstr (name, filter) != NULL);
+}
+
+
+/**
+ * Function to write one result, as a JSON array element or a CSV row.
+ */
+static void bench_report (const struct bench_result *r)
+{
+	if (csvOutput) {
+		if (resultCount == 0) {
+			printf ("name,kind,iterations,median_ns,min_ns,max_ns,p99_ns,ops_per_sec,received\n");
+		}
+		printf ("%s,%s,%ld,%.1f,%.1f,%.1f,%.1f,%.0f,%.4f\n", r->name, r->kind, r->iterations,
+				r->medianNs, r->minNs, r->maxNs, r->p99Ns, r->opsPerSec, r->received);
+	}
+	else {
+		printf ("%s\n  {\"name\": \"%s\", \"kind\": \"%s\", \"iterations\": %ld, \"median_ns\": %.1f, "
+				"\"min_ns\": %.1f, \"max_ns\": %.1f, \"p99_ns\": %.1f, \"ops_per_sec\": %.0f, \"received\": %.4f}",
+				resultCount == 0 ? "[" : ",", r->name, r->kind, r->iterations,
+				r->medianNs, r->minNs, r->maxNs, r->p99Ns, r->opsPerSec, r->received);
+	}
+	resultCount++;
+	fflush (stdout);
+}
+
+
+/*
+ * Microbenchmarks. Each body runs one call for iteration i.
+ */
+
+typedef void (*bench_body) (long i);
+
+/**
+ * Function to time a microbenchmark: BENCH_REPEATS batches of BENCH_BATCH
+ * calls after a warm-up batch, reporting the median, best and worst batch.
+ */
+static void bench_micro (const char *name, bench_body body)
+{
+	double perCall [BENCH_REPEATS];
+	struct bench_result r;
+	long batch = BENCH_BATCH * scale, i;
+	int rep;
+
+	if (!bench_selected (name)) {
+		return;
+	}
+	for (i = 0; i < batch; i++) {
+		body (i);
+	}
+	for (rep = 0; rep < BENCH_REPEATS; rep++) {
+		long long start = bench_now ();
+
+		for (i = 0; i < batch; i++) {
+			body (i);
+		}
+		perCall [rep] = (double)(bench_now () - start) / batch;
+	}
+	qsort (perCall, BENCH_REPEATS, sizeof (double), bench_cmp_double);
+
+	memset (&r, 0, sizeof (r));
+	r.name = name;
+	r.kind = "micro";
+	r.iterations = batch * BENCH_REPEATS;
+	r.medianNs = perCall [BENCH_REPEATS / 2];
+	r.minNs = perCall [0];
+	r.maxNs = perCall [BENCH_REPEATS - 1];
+	r.opsPerSec = 1e9 / r.medianNs;
+	bench_report (&r);
+}
+
+static void body_in_ether (long i)
+{
+	unsigned char hw [6];
+
+	in_ether (colonStrs [i & (BENCH_MACS - 1)], hw);
+	sink += hw [5];
+}
+
+static void body_in_ether_bulk (long i)
+{
+	static wol_mac macs [BENCH_MACS];
+	static int status [BENCH_MACS];
+
+	/** One call parses all BENCH_MACS strings; report per string. */
+	if ((i & (BENCH_MACS - 1)) == 0) {
+		in_ether_bulk (macStrs, BENCH_MACS, macs, status);
+		sink += macs [7];
+	}
+}
+
+static void body_wol_mac_parse (long i)
+{
+	wol_mac mac;
+
+	wol_mac_parse (macStrs [i & (BENCH_MACS - 1)], &mac);
+	sink += mac;
+}
+
+static void body_wol_mac_format (long i)
+{
+	char buf [WOL_MAC_STRLEN];
+
+	wol_mac_format ((wol_mac)i * 0x10001, WOL_MAC_LOWER, buf, sizeof (buf));
+	sink += buf [16];
+}
+
+static void body_formatMAC (long i)
+{
+	char formatted [WOL_MAC_STRLEN];
+
+	formatMAC (rawMacBuf [i & (BENCH_MACS - 1)], formatted);
+	sink += formatted [16];
+}
+
+static void body_formatModelIdentifier (long i)
+{
+	char unformatted [64];
+	char formatted [64];
+
+	/** The input is tokenized in place, so each call takes a fresh copy. */
+	strcpy (unformatted, "\"osxvers=12\" \"model=MacPro6,1\"");
+	formatted [0] = '\0';
+	formatModelIdentifier (unformatted, formatted);
+	sink += formatted [3] + i;
+}
+
+static void body_buildDigCmd (long i)
+{
+	char cmd [256];
+
+	cmd [0] = '\0';
+	buildDigCmd ("224.0.0.251", "host-1234", "5353", "_device-info._tcp", "local", "TXT", cmd);
+	sink += cmd [10] + i;
+}
+
+static void body_wol_build_magic (long i)
+{
+	unsigned char packet [WOL_PACKET_LEN];
+
+	wol_build_magic ((wol_mac)i, packet);
+	sink += packet [101];
+}
+
+static wol_pktcache *benchCache;
+
+static void body_wol_pktcache_get (long i)
+{
+	sink += wol_pktcache_get (benchCache, (wol_mac)(i & (BENCH_MACS - 1)))[101];
+}
+
+
+/*
+ * End-to-end benchmarks.
+ */
+
+/**
+ * The loopback receiver: a magic packet listener, counting the valid magic
+ * packets until stopped.
+ */
+struct bench_receiver {
+	wol_listener *lsn;
+	volatile int stop;
+	pthread_t thread;
+};
+
+static void *bench_receive (void *arg)
+{
+	struct bench_receiver *rx = arg;
+
+	while (!rx->stop) {
+		wol_listen_poll (rx->lsn, 100);
+	}
+	return (NULL);
+}
+
+static int bench_receiver_start (struct bench_receiver *rx, int port)
+{
+	memset (rx, 0, sizeof (*rx));
+	if ((rx->lsn = wol_listen_open (&port, 1, NULL, 0)) == NULL) {
+		return (-1);
+	}
+	if (pthread_create (&rx->thread, NULL, bench_receive, rx) != 0) {
+		wol_listen_close (rx->lsn);
+		return (-1);
+	}
+	return (0);
+}
+
+static long bench_receiver_stop (struct bench_receiver *rx)
+{
+	wol_listen_stats stats;
+
+	usleep (200000);
+	rx->stop = 1;
+	pthread_join (rx->thread, NULL);
+	wol_listen_get_stats (rx->lsn, &stats);
+	wol_listen_close (rx->lsn);
+
+	return ((long)stats.valid);
+}
+
+
+/**
+ * Function to report a throughput benchmark.
+ */
+static void bench_report_rate (const char *name, long sent, long long elapsedNs, long received)
+{
+	struct bench_result r;
+
+	memset (&r, 0, sizeof (r));
+	r.name = name;
+	r.kind = "throughput";
+	r.iterations = sent;
+	r.medianNs = r.minNs = r.maxNs = (double)elapsedNs / (sent ? sent : 1);
+	r.opsPerSec = sent * 1e9 / elapsedNs;
+	r.received = sent ? (double)received / sent : 0;
+	bench_report (&r);
+}
+
+
+/**
+ * Throughput of send_wol(), one socket and one call per packet, to the
+ * limited broadcast address, which is also delivered to local listeners.
+ * It floods the attached network too, so it only runs with --broadcast.
+ */
+static void bench_send_wol (void)
+{
+	struct bench_receiver rx;
+	long long start;
+	long i, n = BENCH_SENDS * scale / 10, sent = 0;
+
+	if (!bench_selected ("send_wol")) {
+		return;
+	}
+	if (!broadcast) {
+		fprintf (stderr, "send_wol: broadcasts on the attached network, skipped without --broadcast\n");
+		return;
+	}
+	if (bench_receiver_start (&rx, 60000) < 0) {
+		return;
+	}
+	start = bench_now ();
+	for (i = 0; i < n; i++) {
+		sent += (send_wol (colonStrs [i & (BENCH_MACS - 1)]) == 0);
+	}
+	bench_report_rate ("send_wol", sent, bench_now () - start, bench_receiver_stop (&rx));
+}
+
+/**
+ * Throughput of a persistent context, one call per packet, to loopback.
+ */
+static void bench_ctx_send_mac (void)
+{
+	struct bench_receiver rx;
+	wol_ctx *ctx;
+	long long start;
+	long i, n = BENCH_SENDS * scale, sent = 0;
+
+	if (!bench_selected ("wol_ctx_send_mac") || bench_receiver_start (&rx, BENCH_PORT) < 0) {
+		return;
+	}
+	if ((ctx = wol_ctx_create ("127.0.0.1", BENCH_PORT)) == NULL) {
+		bench_receiver_stop (&rx);
+		return;
+	}
+	start = bench_now ();
+	for (i = 0; i < n; i++) {
+		sent += (wol_ctx_send_mac (ctx, (wol_mac)i) == 0);
+	}
+	bench_report_rate ("wol_ctx_send_mac", sent, bench_now () - start, bench_receiver_stop (&rx));
+	wol_ctx_destroy (ctx);
+}
+
+/**
+ * Throughput of batched sends of cached packets, to loopback.
+ */
+static void bench_ctx_send_packets (void)
+{
+	const unsigned char *packets [256];
+	int status [256];
+	struct bench_receiver rx;
+	wol_ctx *ctx;
+	long long start;
+	long i, n = BENCH_SENDS * scale, sent = 0;
+
+	if (!bench_selected ("wol_ctx_send_packets") || bench_receiver_start (&rx, BENCH_PORT) < 0) {
+		return;
+	}
+	if ((ctx = wol_ctx_create ("127.0.0.1", BENCH_PORT)) == NULL) {
+		bench_receiver_stop (&rx);
+		return;
+	}
+	for (i = 0; i < 256; i++) {
+		packets [i] = wol_pktcache_get (benchCache, (wol_mac)i);
+	}
+	start = bench_now ();
+	for (i = 0; i < n; i += 256) {
+		sent += wol_ctx_send_packets (ctx, packets, 256, status);
+	}
+	bench_report_rate ("wol_ctx_send_packets", sent, bench_now () - start, bench_receiver_stop (&rx));
+	wol_ctx_destroy (ctx);
+}
+
+/**
+ * Throughput of the submission queue, one submitter, to loopback. A full
+ * ring is retried, so the rate is the sender thread's.
+ */
+static void bench_queue_submit (void)
+{
+	struct bench_receiver rx;
+	wol_queue *q;
+	long long start;
+	long i, n = BENCH_SENDS * scale;
+
+	if (!bench_selected ("wol_queue_submit") || bench_receiver_start (&rx, BENCH_PORT) < 0) {
+		return;
+	}
+	if ((q = wol_queue_create ("127.0.0.1", BENCH_PORT, 0)) == NULL) {
+		bench_receiver_stop (&rx);
+		return;
+	}
+	start = bench_now ();
+	for (i = 0; i < n; i++) {
+		while (wol_queue_submit (q, (wol_mac)i, 1) < 0) {
+			sched_yield ();
+		}
+	}
+	wol_queue_flush (q, -1);
+	bench_report_rate ("wol_queue_submit", n, bench_now () - start, bench_receiver_stop (&rx));
+	wol_queue_destroy (q);
+}
+
+
+/**
+ * Function to time a latency benchmark, reporting the percentiles of the
+ * individual calls.
+ */
+static void bench_latency (const char *name, int (*call) (char *ipAddr, char *out))
+{
+	double lat [BENCH_PINGS];
+	struct bench_result r;
+	char out [WOL_DEVINFO_LEN];
+	char ipAddr [INET_ADDRSTRLEN];
+	int i, ok = 0;
+
+	if (!bench_selected (name)) {
+		return;
+	}
+	strcpy (ipAddr, host);
+	for (i = 0; i < BENCH_PINGS; i++) {
+		long long start = bench_now ();
+
+		ok += (call (ipAddr, out) == 0);
+		lat [i] = (double)(bench_now () - start);
+	}
+	qsort (lat, BENCH_PINGS, sizeof (double), bench_cmp_double);
+
+	memset (&r, 0, sizeof (r));
+	r.name = name;
+	r.kind = "latency";
+	r.iterations = BENCH_PINGS;
+	r.medianNs = lat [BENCH_PINGS / 2];
+	r.minNs = lat [0];
+	r.maxNs = lat [BENCH_PINGS - 1];
+	r.p99Ns = lat [BENCH_PINGS * 99 / 100];
+	r.opsPerSec = 1e9 / r.medianNs;
+	r.received = (double)ok / BENCH_PINGS;
+	bench_report (&r);
+}
+
+static int call_pingIP (char *ipAddr, char *out)
+{
+	(void)out;
+	return (pingIP (ipAddr));
+}
+
+static int call_macForIP (char *ipAddr, char *out)
+{
+	return (macForIP (ipAddr, out));
+}
+
+
+/*
+ * Stress benchmarks. Each body runs one call for iteration i, and returns 1
+ * if the result is the expected one.
+ */
+
+typedef int (*stress_body) (long i);
+
+#define BENCH_MODELS  4
+#define BENCH_DEVINFO_HOSTS  4
+
+static char macExpected [BENCH_MACS][WOL_MAC_STRLEN];
+static const char *modelTxt [BENCH_MODELS] = {
+	"model=MacPro6,1", "\"osxvers=12\" \"model=iMac14,2\"", "\"model=Macmini9,1\"", "model=MacBookPro18,3"
+};
+static const char *modelExpected [BENCH_MODELS] = { "MacPro6,1", "iMac14,2", "Macmini9,1", "MacBookPro18,3" };
+static char macForHost [WOL_MAC_STRLEN];
+static char devInfoExpected [BENCH_DEVINFO_HOSTS][WOL_DEVINFO_LEN];
+static int devInfoAnswered;
+
+struct stress_thread {
+	stress_body body;
+	long first;
+	long calls;
+	long correct;
+	pthread_t thread;
+};
+
+static void *stress_run (void *arg)
+{
+	struct stress_thread *t = arg;
+	long i;
+
+	for (i = t->first; i < t->first + t->calls; i++) {
+		t->correct += t->body (i);
+	}
+	return (NULL);
+}
+
+/**
+ * Function to run a stress benchmark on 1 thread, then on n threads.
+ */
+static void bench_stress (const char *name, stress_body body, long calls)
+{
+	static struct stress_thread t [BENCH_MAX_THREADS];
+	int counts [2] = { 1, threads }, c, k;
+
+	if (!bench_selected (name)) {
+		return;
+	}
+	for (c = 0; c < 2; c++) {
+		struct bench_result r;
+		char label [64];
+		long long start, elapsed;
+		long correct = 0;
+
+		start = bench_now ();
+		for (k = 0; k < counts [c]; k++) {
+			memset (&t [k], 0, sizeof (t [k]));
+			t [k].body = body;
+			t [k].first = k * calls;
+			t [k].calls = calls;
+			pthread_create (&t [k].thread, NULL, stress_run, &t [k]);
+		}
+		for (k = 0; k < counts [c]; k++) {
+			pthread_join (t [k].thread, NULL);
+			correct += t [k].correct;
+		}
+
+		elapsed = bench_now () - start;
+		if (correct != calls * counts [c]) {
+			fprintf (stderr, "%s: %ld of %ld results wrong on %d threads\n", name,
+					 calls * counts [c] - correct, calls * counts [c], counts [c]);
+			stressFailed = 1;
+		}
+
+		snprintf (label, sizeof (label), "%s x%d", name, counts [c]);
+		memset (&r, 0, sizeof (r));
+		r.name = label;
+		r.kind = "stress";
+		r.iterations = calls * counts [c];
+		r.medianNs = r.minNs = r.maxNs = (double)elapsed / calls;
+		r.opsPerSec = r.iterations * 1e9 / elapsed;
+		r.received = (double)correct / r.iterations;
+		bench_report (&r);
+	}
+}
+
+static int stress_formatMAC_r (long i)
+{
+	char formatted [WOL_MAC_STRLEN];
+
+	return (formatMAC_r (rawMacBuf [i & (BENCH_MACS - 1)], formatted, sizeof (formatted)) == 0 &&
+			strcmp (formatted, macExpected [i & (BENCH_MACS - 1)]) == 0);
+}
+
+static int stress_formatModelIdentifier_r (long i)
+{
+	char formatted [64];
+
+	return (formatModelIdentifier_r (modelTxt [i % BENCH_MODELS], formatted, sizeof (formatted)) == 0 &&
+			strcmp (formatted, modelExpected [i % BENCH_MODELS]) == 0);
+}
+
+static int stress_buildDigCmd_r (long i)
+{
+	char hostName [16], cmd [128], expected [128];
+
+	snprintf (hostName, sizeof (hostName), "mac%ld", i & (BENCH_MACS - 1));
+	snprintf (expected, sizeof (expected), "dig @224.0.0.251 -p5353 %s._device-info._tcp.local TXT", hostName);
+	return (buildDigCmd_r ("224.0.0.251", hostName, "5353", "_device-info._tcp", "local", "TXT", cmd, sizeof (cmd)) == 0 &&
+			strcmp (cmd, expected) == 0);
+}
+
+static int stress_macForIP_r (long i)
+{
+	char macAddr [WOL_MAC_STRLEN];
+
+	(void)i;
+	return (macForIP_r (host, macAddr, sizeof (macAddr)) == 0 && strcmp (macAddr, macForHost) == 0);
+}
+
+static int stress_deviceInfoForHost_r (long i)
+{
+	char hostName [16], devInfo [WOL_DEVINFO_LEN];
+
+	snprintf (hostName, sizeof (hostName), "bench-%ld", i % BENCH_DEVINFO_HOSTS);
+	return (deviceInfoForHost_r (hostName, host, devInfo, sizeof (devInfo)) == 0 &&
+			strcmp (devInfo, devInfoExpected [i % BENCH_DEVINFO_HOSTS]) == 0);
+}
+
+
+int main (int argc, char *argv [])
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp (argv [i], "--csv") == 0) {
+			csvOutput = 1;
+		}
+		else if (strcmp (argv [i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv [++i];
+		}
+		else if (strcmp (argv [i], "--host") == 0 && i + 1 < argc) {
+			host = argv [++i];
+		}
+		else if (strcmp (argv [i], "--scale") == 0 && i + 1 < argc) {
+			scale = atoi (argv [++i]) > 0 ? atoi (argv [i]) : 1;
+		}
+		else if (strcmp (argv [i], "--threads") == 0 && i + 1 < argc) {
+			threads = atoi (argv [++i]);
+		}
+		else if (strcmp (argv [i], "--broadcast") == 0) {
+			broadcast = 1;
+		}
+		else {
+			fprintf (stderr, "usage: %s [--csv] [--filter substring] [--host ip] [--scale n] [--threads n] [--broadcast]\n", argv [0]);
+			return (2);
+		}
+	}
+
+	/**
+     * The inputs: formatted MAC strings in mixed styles for the parsers
+     * that take them all, the same addresses colon separated for in_ether()
+     * and send_wol(), and the unpadded form the arp command prints, for
+     * formatMAC().
+     */
+	srand (1);
+	for (i = 0; i < BENCH_MACS; i++) {
+		wol_mac mac = ((wol_mac)rand () << 16 ^ (wol_mac)rand ()) & 0xffffffffffffULL;
+
+		wol_mac_format (mac, i % 3 == 0 ? WOL_MAC_UPPER : (i % 3 == 1 ? WOL_MAC_DASHED : WOL_MAC_LOWER),
+						macBuf [i], WOL_MAC_STRLEN);
+		macStrs [i] = macBuf [i];
+		wol_mac_format (mac, i % 2 == 0 ? WOL_MAC_UPPER : WOL_MAC_LOWER, colonBuf [i], WOL_MAC_STRLEN);
+		colonStrs [i] = colonBuf [i];
+		sprintf (rawMacBuf [i], "%x:%x:%x:%x:%x:%x", (unsigned)(mac >> 40) & 0xff,
+				 (unsigned)(mac >> 32) & 0xff, (unsigned)(mac >> 24) & 0xff,
+				 (unsigned)(mac >> 16) & 0xff, (unsigned)(mac >> 8) & 0xff, (unsigned)mac & 0xff);
+	}
+	for (i = 0; i < BENCH_MACS; i++) {
+		formatMAC (rawMacBuf [i], macExpected [i]);
+	}
+	macForIP_r (host, macForHost, sizeof (macForHost));
+	devInfoAnswered = 1;
+	for (i = 0; i < BENCH_DEVINFO_HOSTS; i++) {
+		char hostName [16];
+
+		snprintf (hostName, sizeof (hostName), "bench-%d", i);
+		if (deviceInfoForHost_r (hostName, host, devInfoExpected [i], WOL_DEVINFO_LEN) != 0) {
+			devInfoAnswered = 0;
+		}
+	}
+	if (threads <= 0) {
+		threads = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	}
+	/** A stress run on one thread would compare one thread with itself. */
+	if (threads < 2) {
+		threads = 2;
+	}
+	if (threads > BENCH_MAX_THREADS) {
+		threads = BENCH_MAX_THREADS;
+	}
+	if ((benchCache = wol_pktcache_create (BENCH_MACS)) == NULL) {
+		perror ("wol_pktcache_create");
+		return (1);
+	}
+
+	bench_micro ("in_ether", body_in_ether);
+	bench_micro ("in_ether_bulk", body_in_ether_bulk);
+	bench_micro ("wol_mac_parse", body_wol_mac_parse);
+	bench_micro ("wol_mac_format", body_wol_mac_format);
+	bench_micro ("formatMAC", body_formatMAC);
+	bench_micro ("formatModelIdentifier", body_formatModelIdentifier);
+	bench_micro ("buildDigCmd", body_buildDigCmd);
+	bench_micro ("wol_build_magic", body_wol_build_magic);
+	bench_micro ("wol_pktcache_get", body_wol_pktcache_get);
+
+	bench_send_wol ();
+	bench_ctx_send_mac ();
+	bench_ctx_send_packets ();
+	bench_queue_submit ();
+
+	bench_latency ("pingIP", call_pingIP);
+	bench_latency ("macForIP", call_macForIP);
+
+	bench_stress ("formatMAC_r", stress_formatMAC_r, BENCH_STRESS * scale);
+	bench_stress ("formatModelIdentifier_r", stress_formatModelIdentifier_r, BENCH_STRESS * scale);
+	bench_stress ("buildDigCmd_r", stress_buildDigCmd_r, BENCH_STRESS * scale);
+	bench_stress ("macForIP_r", stress_macForIP_r, BENCH_PINGS * scale);
+	if (devInfoAnswered) {
+		bench_stress ("deviceInfoForHost_r", stress_deviceInfoForHost_r, BENCH_PINGS * scale);
+	}
+	else if (bench_selected ("deviceInfoForHost_r")) {
+		fprintf (stderr, "deviceInfoForHost_r: no mDNS responder at %s, skipped\n", host);
+	}
+
+	if (!csvOutput) {
+		printf (resultCount > 0 ? "\n]\n" : "[]\n");
+	}
+	wol_pktcache_destroy (benchCache);
+
+	return (stressFailed);
+}
@@ -7,8 +7,8 @@
  * @brief Functions to support device information for a host.
  * @details dig (domain information groper) is a network administration command-line tool 
  * for querying Domain Name System (DNS) name servers. Needed to get device info for the 
- * host. These functions build the dig command string, send the command, read its results,
- * and extract the formatted model id of the specified host.
+ * host. These functions build the dig command string, and extract the formatted model id
+ * of the specified host. The query itself is sent in-process, see mdns.c.
  * 
  * @copyright Copyright 2011 Perry M. Spagnola. All rights reserved.
  *
@@ -27,22 +27,19 @@
  */
 
 #include "wol_lib.h"
+#include "wol_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define mDNS_BCAST_ADDRESS  "224.0.0.251"
-#define mDNS_PORT  "5353"
-#define mDNS_QUERY  "TXT"
-#define DEVICE_INFO_SERVICE  "_device-info._tcp"
-#define LOCAL_DOMAIN  "local"
-#define DOT_DELIMITER  "."
-#define SPACE  " "
+#define mDNS_TIMEOUT_MS  1000
 
 
 /**
  * Function to build the dig command. Used by the deviceInfoForHost() function
- * to build an mDNS query.
+ * to build an mDNS query. Wraps buildDigCmd_r(); the command buffer must hold
+ * at least WOL_DIGCMD_LEN bytes.
  *
  * @param server - the server address
  * @param hostName - the name of the host
@@ -50,203 +47,204 @@
  * @param serviceType - the type of the service
  * @param domain - the domain
  * @param query - the mDNS query
- * @param cmd - the command string that will be populated by the function
+ * @param cmd - the command string that will be populated by the function, WOL_DIGCMD_LEN bytes
  *
- * @return zero (0) if successful, there is no failure mode for this function
+ * @return the success or failure status of the function
  * @retval 0 - success
+ * @retval 1 - failure, the command is longer than WOL_DIGCMD_LEN. cmd is set to "".
  */
 int buildDigCmd(char *server, char *hostName, char *port, char *serviceType, char *domain, char *query, char *cmd)
 {
-    /**
-     * Initialize the dig comamnd string with the "dig" command.
-     */
-	strcpy(cmd, "dig @");
+	return buildDigCmd_r(server, hostName, port, serviceType, domain, query, cmd, WOL_DIGCMD_LEN);
+}
+
+
+/**
+ * Function to build the dig command, as for buildDigCmd(), into a buffer of
+ * known size. Reentrant.
+ *
+ * @param server - the server address, NULL or "" for the mDNS broadcast address
+ * @param hostName - the name of the host
+ * @param port - the network port
+ * @param serviceType - the type of the service
+ * @param domain - the domain
+ * @param query - the mDNS query
+ * @param cmd - the command string that will be populated by the function
+ * @param cmdLen - the size of the command buffer
+ *
+ * @return the success or failure status of the function
+ * @retval 0 - success
+ * @retval 1 - failure, the command does not fit. cmd is set to "".
+ */
+int buildDigCmd_r(const char *server, const char *hostName, const char *port, const char *serviceType,
+				  const char *domain, const char *query, char *cmd, size_t cmdLen)
+{
+	int len;
 	
+	if (cmdLen == 0) {
+		return 1;
+	}
 	if (server == NULL || strcmp(server, "") == 0) {
-        /** 
-         * If no server is specified, concatenate the mDNS broadcast address to
-         * the command string.
-         */
-		strcat(cmd, mDNS_BCAST_ADDRESS);
+		server = mDNS_BCAST_ADDRESS;
 	}
-	else {
-        /**
-         * Else, concatenate the server address.
-         */
-		strcat(cmd, server);
+	len = snprintf(cmd, cmdLen, "dig @%s -p%s %s.%s.%s %s", server, port, hostName, serviceType, domain, query);
+	if (len < 0 || (size_t)len >= cmdLen) {
+		cmd[0] = '\0';
+		return 1;
 	}
-	
-    /**
-     * Concatenate the rest of the command parameters to the command string.
-     */
-	strcat(cmd, SPACE);
-	strcat(cmd, "-p");
-	strcat(cmd, port);
-	strcat(cmd, SPACE);
-	strcat(cmd, hostName);
-	strcat(cmd, DOT_DELIMITER);
-	strcat(cmd, serviceType);
-	strcat(cmd, DOT_DELIMITER);
-	strcat(cmd, domain);
-	strcat(cmd, SPACE);
-	strcat(cmd, query);
-    
-    /**
-     * Reached the end of the function. There is no error condition for this
-     * function. Return zero (0) for success.
-     */
 	return 0;
 }
 
 
 /**
- * Function to format the argument specified host model identifier.
- * 
+ * Function to format the argument specified host model identifier: the value
+ * of its "model" key, e.g. <code>MacPro6,1</code> from <code>"model=MacPro6,1"</code>.
+ * Reentrant: the tokens are scanned in place, so the input is not modified and
+ * no tokenizer state is kept between calls.
+ *
  * @param unformattedModelID - pointer to the unformated model identifier string
  * @param formattedModelID - pointer to the string to put the formatted model identifier in
+ * @param len - the size of the formatted model identifier buffer
  * @return the success or failure status of the function
  * @retval 0 - success
- * @retval 1 - failure
+ * @retval 1 - failure, no model value, or the buffer is too small. formattedModelID is set to "".
  */
-int formatModelIdentifier(char *unformattedModelID, char *formattedModelID)
+int formatModelIdentifier_r(const char *unformattedModelID, char *formattedModelID, size_t len)
 {
-	int returnValue = 1; /** initialize to failure condition */
-	char delims[] = "\"=";  /** initialize the delimiters for parsing the model identifier from its label */
-	char *token = NULL;  /** initialize the current token */
+	const char *delims = "\"=";  /** the delimiters for parsing the model identifier from its label */
+	const char *p = unformattedModelID;
 	int modelLabel = 0;
 	
-    /** Tokenize the unformated model identifier string. */
-	token = strtok( unformattedModelID, delims );
+	if (len == 0) {
+		return 1;
+	}
+	formattedModelID[0] = '\0';
 	
-	while( token != NULL ) {
-        /**
-         * Iterate, tokenizing the unformatted model ID string, and extract the value 
-         * for the "model" key.
-         */
-		// DEBUG: printf( "result is \"%s\"\n", token );
-		if (strcmp(token, "model")) {
-            /** 
-             * If we found the "model" key, concatenate the model value to
-             * the formatted model ID string. Set the return value to 0 for
-             *  success, and break out of the loop.
-             */
-			if (modelLabel == 1) {
-				strcat(formattedModelID, token);
-				returnValue = 0;
-				break;
-			}
+	for (;;) {
+		size_t tokenLen;
+		
+		/** Skip the delimiters, then measure the token, as strtok() would. */
+		p += strspn(p, delims);
+		if (*p == '\0') {
+			return 1;
 		}
-		else {
+		tokenLen = strcspn(p, delims);
+		
+		if (tokenLen == 5 && strncmp(p, "model", 5) == 0) {
 			/* model label found */
 			modelLabel = 1;
 		}
-		
-		token = strtok( NULL, delims );
+		else if (modelLabel == 1) {
+			/** The value after the "model" key. Copy it, if it fits. */
+			if (tokenLen >= len) {
+				return 1;
+			}
+			memcpy(formattedModelID, p, tokenLen);
+			formattedModelID[tokenLen] = '\0';
+			return 0;
+		}
+		p += tokenLen;
 	}
-	
-    /** Retrun the success or error value. */
-	return returnValue;
+}
+
+
+/**
+ * Function to format the argument specified host model identifier, as for
+ * formatModelIdentifier_r(). The model is appended to formattedModelID.
+ * 
+ * @param unformattedModelID - pointer to the unformated model identifier string
+ * @param formattedModelID - pointer to the string to put the formatted model identifier in
+ * @return the success or failure status of the function
+ * @retval 0 - success
+ * @retval 1 - failure
+ */
+int formatModelIdentifier(char *unformattedModelID, char *formattedModelID)
+{
+	/**
+     * The model is a substring of the unformatted string, so it fits in as
+     * many bytes. The caller's buffer must hold it, as it always had to.
+     */
+	return formatModelIdentifier_r(unformattedModelID, formattedModelID + strlen(formattedModelID),
+								   strlen(unformattedModelID) + 1);
 }
 
 
 /**
  * Function to retrieve the device information for the argument specified
- * host. Retrieves device info for the specified host using a "dig" command.
+ * host, as for deviceInfoForHost(), into a buffer of known size. Reentrant:
+ * the query state is local to the call, and the inputs are not modified.
+ * When the lookup cache is on, a recent result for the host and address, or
+ * a recent failure, is returned without a query, see <code>wol_cache_enable()</code>.
  *
  * @param host - the host to retrieve the device info for
- * @param hostIP - the IP address of the host
+ * @param hostIP - the IP address of the host, NULL or "" for the mDNS multicast group
  * @param devInfo - the string populated with the retrieved device info
+ * @param devInfoLen - the size of the device info buffer
  *
  * @return the success or failure status of the function
  * @retval 0 - success
- * @retval 1 - failure
+ * @retval 1 - failure, or the device info does not fit. devInfo is set to "".
  */
-int deviceInfoForHost(char *host, char *hostIP, char *devInfo)
+int deviceInfoForHost_r(const char *host, const char *hostIP, char *devInfo, size_t devInfoLen)
 {
-	FILE *in;
-	extern FILE *popen();
-	char buff[512];
-	char address[512];
-	char command[1024] = "";
-	int returnValue = 0;
+	char info[WOL_DEVINFO_LEN];
+	char key[WOL_CACHE_KEY_LEN + 1];
+	char *hosts[1] = { (char *)host };
+	char *infos[1] = { info };
+	int status = 1;
 	
-	if (hostIP == NULL || strcmp(hostIP, "") == 0) {
-        /** Build host domain address. If IP missing or NULL set to NULL. */
-		strcpy(address, "");
-	}
-	else {
-        /** Else, use the host IP argument. */
-		strcpy(address, hostIP);
+	if (devInfoLen == 0) {
+		return 1;
 	}
-
-	
-	/** Build the host and service specific dig command. */
-	buildDigCmd(address, host, mDNS_PORT, DEVICE_INFO_SERVICE, LOCAL_DOMAIN, mDNS_QUERY, command);
+	devInfo[0] = '\0';
 	
-	// DEBUG: printf("dig command: %s\n", command);
-	
-	/** Open a pipe and execute the "dig" command. */
-	if (!(in = popen(command, "r"))) {
-        /** If the "dig" command fails, set the return value to 1. */
-		returnValue = 1;
+	/**
+     * The same name queried at different addresses may be different hosts,
+     * so the address is part of the key. A key too long for the cache is
+     * left at WOL_CACHE_KEY_LEN characters, which the cache refuses.
+     */
+	if (hostIP != NULL && hostIP[0] != '\0') {
+		snprintf(key, sizeof(key), "%s@%s", host, hostIP);
 	}
 	else {
-		/** Else, read the "dig" command output, one line at a time */
-		while (fgets(buff, sizeof(buff), in) != NULL ) {
-			// DEBUG: printf("Output: %s", buff);
-			
-			/**
-			 * Break the command output string into tokens separated
-			 * by white space.
-			 */
-			char *token;
-			token = strtok (buff, " ");
-			
-			/**
-			 * Search for the H/W model identifier. Look for the character 
-			 * "=" It will be the only instance of the sub-string token.
-			 */
-			char modelID[64] = "";
-			int found = 0;
-			while (token != NULL)
-			{
-				// DEBUG: printf ("%s\n",token);
-				if (strchr(token, '=') != 0) {
-					// DEBUG: printf ("found model=: %s\n",token);
-					/* found the H/W model identifier */
-					strcpy(modelID, token);
-					found = 1;
-					break;
-				}
-				token = strtok (NULL, " ");
-			}
-			
-			if (!found) {
-                /**
-                 * If the H/W model identifier is not found, assign an empty
-                 * string to the device info string, and return 1, an error.
-                 */
-				strcpy(devInfo, "");
-				returnValue = 1;
-			}
-			else {
-				/**
-				 * Else, found the model identifier. Call the formatModelIdentifier()
-                 * function, and break out of the loop. It will set the device info
-                 * string, and the return value.
-				 */
-				returnValue = formatModelIdentifier(modelID, devInfo);
-				break;
-			}
-		}
+		snprintf(key, sizeof(key), "%s", host);
+	}
+	if (wol_cache_get(WOL_CACHE_DEVINFO, key, devInfo, devInfoLen, &status) == 0) {
+		return status;
 	}
 	
-	/** Close the pipe. */
-	pclose(in);
+	/**
+     * Query the one host, and wait for its response. A host that did not
+     * answer is cached as a failure; a query that could not be sent is not.
+     */
+	if (deviceInfoForHosts(hosts, 1, (char *)hostIP, mDNS_TIMEOUT_MS, infos, &status) < 0) {
+		return 1;
+	}
+	wol_cache_put(WOL_CACHE_DEVINFO, key, status, info);
+	if (status != 0 || strlen(info) >= devInfoLen) {
+		return 1;
+	}
+	strcpy(devInfo, info);
 	
-    /** Return the success or error results. */
-	return returnValue;	
+	return 0;
 }
-	
 
 
+/**
+ * Function to retrieve the device information for the argument specified
+ * host. Retrieves device info for the specified host with an in-process mDNS
+ * TXT query, see <code>deviceInfoForHosts()</code>, or from the lookup cache,
+ * as for <code>deviceInfoForHost_r()</code>.
+ *
+ * @param host - the host to retrieve the device info for
+ * @param hostIP - the IP address of the host
+ * @param devInfo - the string, WOL_DEVINFO_LEN bytes, populated with the retrieved device info
+ *
+ * @return the success or failure status of the function
+ * @retval 0 - success
+ * @retval 1 - failure
+ */
+int deviceInfoForHost(char *host, char *hostIP, char *devInfo)
+{
+	return deviceInfoForHost_r(host, hostIP, devInfo, WOL_DEVINFO_LEN);
+}
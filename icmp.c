@@ -0,0 +1,384 @@
+/**
+ * @file icmp.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief In-process ICMP echo (ping) engine.
+ * @details Sends ICMP echo requests and matches the echo replies without
+ * invoking the "ping" command. An unprivileged <code>SOCK_DGRAM</code> ICMP
+ * socket is used where the system allows it, with a fallback to a raw socket.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+#include "icmp.h"
+#include "wol_stats.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define ICMP_ECHO_REPLY    0
+#define ICMP_ECHO_REQUEST  8
+#define ICMP_HEADER_LEN    8
+#define ICMP_PAYLOAD       "wol_lib."
+
+#if ICMP_ECHO_LEN != ICMP_HEADER_LEN + 8
+#error "ICMP_ECHO_LEN does not match the echo request layout"
+#endif
+
+
+/**
+ * Function to compute the Internet checksum of a buffer.
+ *
+ * @param buf - the buffer to checksum
+ * @param len - the length of the buffer in bytes
+ *
+ * @return the checksum, in network byte order
+ */
+static unsigned short icmp_checksum (const void *buf, int len)
+{
+	const unsigned char *ptr = buf;
+	unsigned long sum = 0;
+	
+	while (len > 1) {
+		sum += (ptr [0] << 8) | ptr [1];
+		ptr += 2;
+		len -= 2;
+	}
+	if (len == 1) {
+		sum += ptr [0] << 8;
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return htons((unsigned short)~sum);
+}
+
+
+/**
+ * Function to open an ICMP echo socket. Tries an unprivileged datagram socket
+ * first, then a raw socket. The socket is put in non-blocking mode.
+ *
+ * @param sock - the socket to populate
+ *
+ * @return success or failure opening the socket
+ * @retval 0 - success
+ * @retval -1 - failure, neither socket type is permitted
+ */
+int icmp_open (icmp_sock *sock)
+{
+	static unsigned short counter = 0;
+	
+	memset (sock, 0, sizeof (*sock));
+	
+	if ((sock->fd = socket (AF_INET, SOCK_DGRAM, IPPROTO_ICMP)) >= 0) {
+		sock->raw = 0;
+#if defined(__linux__)
+		/**
+		 * Linux replaces the echo identifier with the socket's port, and
+		 * only delivers the replies addressed to this socket.
+		 */
+		sock->matchId = 0;
+#else
+		sock->matchId = 1;
+#endif
+	}
+	else if ((sock->fd = socket (AF_INET, SOCK_RAW, IPPROTO_ICMP)) >= 0) {
+		sock->raw = 1;
+		sock->matchId = 1;
+	}
+	else {
+		return (-1);
+	}
+	
+	fcntl (sock->fd, F_SETFL, fcntl (sock->fd, F_GETFL, 0) | O_NONBLOCK);
+	/** The counter is shared by threads opening sockets at once. */
+	sock->id = (unsigned short)(getpid () ^ (__atomic_add_fetch (&counter, 1, __ATOMIC_RELAXED) << 8));
+	
+	return (0);
+}
+
+
+/**
+ * Function to close an ICMP echo socket.
+ *
+ * @param sock - the socket to close
+ */
+void icmp_close (icmp_sock *sock)
+{
+	if (sock->fd >= 0) {
+		close (sock->fd);
+		sock->fd = -1;
+	}
+}
+
+
+/**
+ * Function to build one ICMP echo request: type, code, checksum, identifier,
+ * sequence, and a short payload.
+ *
+ * @param sock - the open ICMP echo socket
+ * @param seq - the echo sequence number
+ * @param packet - the buffer to populate, at least ICMP_ECHO_LEN bytes
+ *
+ * @return the length of the echo request
+ */
+int icmp_build_echo (icmp_sock *sock, unsigned short seq, unsigned char *packet)
+{
+	unsigned short csum;
+	
+	memset (packet, 0, ICMP_ECHO_LEN);
+	packet [0] = ICMP_ECHO_REQUEST;
+	packet [4] = sock->id >> 8;
+	packet [5] = sock->id & 0xff;
+	packet [6] = seq >> 8;
+	packet [7] = seq & 0xff;
+	memcpy (packet + ICMP_HEADER_LEN, ICMP_PAYLOAD, sizeof (ICMP_PAYLOAD) - 1);
+	csum = icmp_checksum (packet, ICMP_ECHO_LEN);
+	memcpy (packet + 2, &csum, 2);
+	
+	return (ICMP_ECHO_LEN);
+}
+
+
+/**
+ * Function to send one ICMP echo request.
+ *
+ * @param sock - the open ICMP echo socket
+ * @param dst - the destination address
+ * @param seq - the echo sequence number
+ *
+ * @return success or failure of the send
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int icmp_send_echo (icmp_sock *sock, struct in_addr dst, unsigned short seq)
+{
+	unsigned char packet [ICMP_ECHO_LEN];
+	struct sockaddr_in sap;
+	int len = icmp_build_echo (sock, seq, packet);
+	
+	memset (&sap, 0, sizeof (sap));
+	sap.sin_family = AF_INET;
+	sap.sin_addr = dst;
+	
+	if (sendto (sock->fd, (char *)packet, len, 0, (struct sockaddr *)&sap, sizeof (sap)) < 0) {
+		return (-1);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to check whether a packet read from the ICMP echo socket is an
+ * echo reply to this socket.
+ *
+ * @param sock - the open ICMP echo socket
+ * @param buf - the packet
+ * @param len - the length of the packet
+ * @param seq - populated with the echo sequence number of the reply
+ *
+ * @return 1 if an echo reply for this socket, 0 if some other packet
+ */
+int icmp_parse_reply (icmp_sock *sock, const unsigned char *buf, int len, unsigned short *seq)
+{
+	const unsigned char *icmp = buf;
+	
+	/**
+	 * Raw sockets, and datagram sockets on some systems, deliver the IP
+	 * header in front of the ICMP message. An echo reply starts with a zero
+	 * type byte, an IPv4 header with version 4, so the two cannot be confused.
+	 */
+	if (len > 0 && (buf [0] >> 4) == 4) {
+		int ipLen = (buf [0] & 0x0f) * 4;
+		
+		if (len < ipLen) {
+			return (0);
+		}
+		icmp += ipLen;
+		len -= ipLen;
+	}
+	
+	if (len < ICMP_HEADER_LEN || icmp [0] != ICMP_ECHO_REPLY) {
+		return (0);
+	}
+	if (sock->matchId && ((icmp [4] << 8) | icmp [5]) != sock->id) {
+		return (0);
+	}
+	
+	*seq = (unsigned short)((icmp [6] << 8) | icmp [7]);
+	
+	return (1);
+}
+
+
+/**
+ * Function to read one packet from the ICMP echo socket, and check whether
+ * it is an echo reply to this socket.
+ *
+ * @param sock - the open ICMP echo socket
+ * @param from - populated with the address the reply came from
+ * @param seq - populated with the echo sequence number of the reply
+ *
+ * @return the result of the read
+ * @retval 1 - an echo reply for this socket was read
+ * @retval 0 - some other packet was read, and ignored
+ * @retval -1 - nothing to read, or a socket error
+ */
+int icmp_recv_reply (icmp_sock *sock, struct in_addr *from, unsigned short *seq)
+{
+	unsigned char buf [1500];
+	struct sockaddr_in sap;
+	socklen_t sapLen = sizeof (sap);
+	ssize_t len;
+	
+	if ((len = recvfrom (sock->fd, (char *)buf, sizeof (buf), 0, (struct sockaddr *)&sap, &sapLen)) < 0) {
+		return (-1);
+	}
+	
+	*from = sap.sin_addr;
+	
+	return (icmp_parse_reply (sock, buf, (int)len, seq));
+}
+
+
+/**
+ * Function to compute the time elapsed since a monotonic start time.
+ *
+ * @param start - the start time, from clock_gettime(CLOCK_MONOTONIC)
+ *
+ * @return the elapsed time in microseconds
+ */
+long icmp_elapsed_usec (const struct timespec *start)
+{
+	struct timespec now;
+	
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+
+/**
+ * Sends a single ICMP echo request to the specified IP address, and waits
+ * for the reply up to the specified timeout. No external command is invoked.
+ *
+ * @param ipAddr - the IP address to ping.
+ * @param timeoutMs - the time to wait for the reply, in milliseconds
+ * @param rttUsec - populated with the round trip time in microseconds, may be NULL
+ *
+ * @return the success or error of the ping.
+ * @retval 0 - success, a reply was received
+ * @retval 1 - error, no reply within the timeout, or the ping could not be sent
+ */
+int pingIPWithTimeout(char *ipAddr, int timeoutMs, long *rttUsec)
+{
+	icmp_sock sock;
+	struct in_addr dst;
+	struct addrinfo hints, *res;
+	struct timespec start;
+	unsigned short seq = 1;
+	int returnValue = 1;
+	
+	/**
+     * Resolve the IP address. A host name is accepted, as the ping command does.
+     */
+	if (inet_pton (AF_INET, ipAddr, &dst) != 1) {
+		memset (&hints, 0, sizeof (hints));
+		hints.ai_family = AF_INET;
+		if (getaddrinfo (ipAddr, NULL, &hints, &res) != 0) {
+			WOL_STATS_ERROR (WOL_STAGE_PARSE, EINVAL);
+			return 1;
+		}
+		dst = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+		freeaddrinfo (res);
+	}
+	
+	if (icmp_open (&sock) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_PING, errno);
+		return 1;
+	}
+	
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	if (icmp_send_echo (&sock, dst, seq) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_PING, errno);
+		icmp_close (&sock);
+		return 1;
+	}
+	WOL_STATS_COUNT (WOL_CTR_PROBES_SENT, 1);
+	
+	/**
+     * Wait for the matching reply, ignoring any other ICMP traffic, until the
+     * timeout expires.
+     */
+	for (;;) {
+		struct pollfd pfd;
+		struct in_addr from;
+		unsigned short replySeq;
+		long remaining = timeoutMs - icmp_elapsed_usec (&start) / 1000;
+		
+		if (remaining <= 0) {
+			break;
+		}
+		pfd.fd = sock.fd;
+		pfd.events = POLLIN;
+		if (poll (&pfd, 1, (int)remaining) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		
+		for (;;) {
+			int rc = icmp_recv_reply (&sock, &from, &replySeq);
+			
+			if (rc < 0) {
+				break;
+			}
+			/**
+			 * Only a 1 populates replySeq, other packets are skipped.
+			 */
+			if (rc == 1 && replySeq == seq && from.s_addr == dst.s_addr) {
+				long rtt = icmp_elapsed_usec (&start);
+				
+				if (rttUsec != NULL) {
+					*rttUsec = rtt;
+				}
+				WOL_STATS_LATENCY_NS (WOL_HIST_PING, (uint64_t)rtt * 1000);
+				returnValue = 0;
+				break;
+			}
+		}
+		if (returnValue == 0) {
+			break;
+		}
+	}
+	
+	icmp_close (&sock);
+	WOL_STATS_COUNT (returnValue == 0 ? WOL_CTR_PROBES_ANSWERED : WOL_CTR_PROBES_TIMEOUT, 1);
+	
+	return returnValue;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file icmp.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for icmp.c
+ * @details Provides the ICMP echo socket type and the function prototypes used
+ * by the library to send echo requests and match their replies in-process.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef ICMP_H
+#define ICMP_H
+
+#include <time.h>
+#include <netinet/in.h>
+
+/** The length of the echo requests built by icmp_build_echo(). */
+#define ICMP_ECHO_LEN  16
+
+/**
+ * An open ICMP echo socket. Unprivileged datagram sockets are preferred, raw
+ * sockets are the fallback.
+ */
+typedef struct icmp_sock {
+	int fd;              /**< the socket descriptor */
+	int raw;             /**< 1 if a raw socket, replies carry the IP header */
+	int matchId;         /**< 1 if replies for other sockets may be received */
+	unsigned short id;   /**< the echo identifier used by this socket */
+} icmp_sock;
+
+int icmp_open (icmp_sock *sock);
+void icmp_close (icmp_sock *sock);
+int icmp_build_echo (icmp_sock *sock, unsigned short seq, unsigned char *packet);
+int icmp_send_echo (icmp_sock *sock, struct in_addr dst, unsigned short seq);
+int icmp_parse_reply (icmp_sock *sock, const unsigned char *buf, int len, unsigned short *seq);
+int icmp_recv_reply (icmp_sock *sock, struct in_addr *from, unsigned short *seq);
+long icmp_elapsed_usec (const struct timespec *start);
+
+#endif /* ICMP_H */
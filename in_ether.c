@@ -24,6 +24,13 @@
 #include "in_ether.h"
 
 #include <ctype.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -140,3 +147,472 @@ int in_ether (char *macStr, unsigned char *hwAddr)
         return (0);
     }
 }
+
+
+
+/**
+ * Function to convert a MAC address string (xx:xx:xx:xx:xx:xx) to a packed
+ * wol_mac hardware address.
+ *
+ * @param macStr - the MAC address string to convert
+ * @param mac - populated with the packed hardware address
+ *
+ * @return success or error converting the MAC address string
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int in_ether_mac (char *macStr, wol_mac *mac)
+{
+    unsigned char hwAddr [8];
+    
+    if (in_ether (macStr, hwAddr) < 0) {
+        return (-1);
+    }
+    *mac = wol_mac_from_bytes (hwAddr);
+    
+    return (0);
+}
+
+/** White space trimmed from around each address by the bulk parser. */
+#define IS_BLANK(c)  ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+
+/**
+ * The MAC address notations recognized by the bulk parser, detected from the
+ * length and the delimiter positions of each address.
+ */
+enum {
+    NOTATION_COLON,     /**< xx:xx:xx:xx:xx:xx */
+    NOTATION_DASH,      /**< xx-xx-xx-xx-xx-xx */
+    NOTATION_DOTTED,    /**< xxxx.xxxx.xxxx, Cisco notation */
+    NOTATION_BARE       /**< xxxxxxxxxxxx */
+};
+
+
+/**
+ * Function to detect the notation of a MAC address string, and gather its
+ * 12 hex digits into a 16 byte block, padded with '0' characters.
+ *
+ * @param macStr - the MAC address string, not terminated
+ * @param len - the length of the MAC address string
+ * @param digits - the 16 byte block to populate
+ *
+ * @return the status of the gather
+ * @retval IN_ETHER_OK - success
+ * @retval IN_ETHER_ERR_LENGTH - the length matches no notation
+ * @retval IN_ETHER_ERR_DELIM - a delimiter is missing or misplaced
+ */
+static int in_ether_gather (const char *macStr, size_t len, char *digits)
+{
+    int i, notation;
+    
+    if (len == 17) {
+        notation = (macStr [2] == '-') ? NOTATION_DASH : NOTATION_COLON;
+    }
+    else if (len == 14) {
+        notation = NOTATION_DOTTED;
+    }
+    else if (len == 12) {
+        notation = NOTATION_BARE;
+    }
+    else {
+        return (IN_ETHER_ERR_LENGTH);
+    }
+    
+    memset (digits + 12, '0', 4);
+    
+    switch (notation) {
+        case NOTATION_COLON:
+        case NOTATION_DASH:
+            /**
+             * Every third character is the delimiter, a colon or a dash, the
+             * same one throughout.
+             */
+            if ((macStr [2] != ':' && macStr [2] != '-') ||
+                macStr [5] != macStr [2] || macStr [8] != macStr [2] ||
+                macStr [11] != macStr [2] || macStr [14] != macStr [2]) {
+                return (IN_ETHER_ERR_DELIM);
+            }
+            for (i = 0; i < 6; i++) {
+                memcpy (digits + i * 2, macStr + i * 3, 2);
+            }
+            break;
+        case NOTATION_DOTTED:
+            if (macStr [4] != '.' || macStr [9] != '.') {
+                return (IN_ETHER_ERR_DELIM);
+            }
+            memcpy (digits, macStr, 4);
+            memcpy (digits + 4, macStr + 5, 4);
+            memcpy (digits + 8, macStr + 10, 4);
+            break;
+        default:
+            memcpy (digits, macStr, 12);
+            break;
+    }
+    
+    return (IN_ETHER_OK);
+}
+
+
+/**
+ * Function to pack the 6 bytes of a hardware address into a wol_mac, the
+ * first octet most significant. An inline copy of wol_mac_from_bytes() for
+ * the bulk conversion loops.
+ */
+static inline wol_mac in_ether_pack (const unsigned char *bytes)
+{
+    return ((wol_mac)bytes [0] << 40) | ((wol_mac)bytes [1] << 32) | ((wol_mac)bytes [2] << 24) |
+           ((wol_mac)bytes [3] << 16) | ((wol_mac)bytes [4] << 8) | (wol_mac)bytes [5];
+}
+
+
+#if defined(__SSE2__)
+
+/**
+ * Function to decode 16 hex digit characters in one 128-bit vector: 8 bytes
+ * out, and a bit mask of the characters that are not hex digits.
+ */
+static inline __m128i in_ether_hex16 (__m128i v, int *badMask)
+{
+    const __m128i lower = _mm_or_si128 (v, _mm_set1_epi8 (0x20));
+    
+    /** Classify each character as a decimal digit, or a hex letter of either case. */
+    __m128i isDigit = _mm_and_si128 (_mm_cmpgt_epi8 (v, _mm_set1_epi8 ('0' - 1)),
+                                     _mm_cmplt_epi8 (v, _mm_set1_epi8 ('9' + 1)));
+    __m128i isAlpha = _mm_and_si128 (_mm_cmpgt_epi8 (lower, _mm_set1_epi8 ('a' - 1)),
+                                     _mm_cmplt_epi8 (lower, _mm_set1_epi8 ('f' + 1)));
+    
+    /** Convert each character to its nibble value. */
+    __m128i nib = _mm_or_si128 (_mm_and_si128 (isDigit, _mm_sub_epi8 (v, _mm_set1_epi8 ('0'))),
+                                _mm_and_si128 (isAlpha, _mm_sub_epi8 (lower, _mm_set1_epi8 ('a' - 10))));
+    
+    /**
+     * Combine each pair of nibbles into a byte. In each 16-bit lane the first
+     * digit is the low byte, and becomes the high nibble.
+     */
+    __m128i hi = _mm_and_si128 (_mm_slli_epi16 (nib, 4), _mm_set1_epi16 (0x00f0));
+    __m128i lo = _mm_srli_epi16 (nib, 8);
+    
+    *badMask = ~_mm_movemask_epi8 (_mm_or_si128 (isDigit, isAlpha)) & 0xffff;
+    
+    return _mm_packus_epi16 (_mm_or_si128 (hi, lo), _mm_setzero_si128 ());
+}
+
+#endif
+
+
+#if defined(__SSSE3__)
+
+/**
+ * Function to convert a colon or dash notation MAC address without the scalar
+ * gather: the 12 hex digits are shuffled out of two overlapping loads, and
+ * the delimiters are checked in the same vectors.
+ *
+ * @param macStr - the MAC address string, at least 17 readable bytes
+ * @param hwAddr - populated with the packed 48-bit hardware address
+ *
+ * @return IN_ETHER_OK, or an IN_ETHER_ERR_* code
+ */
+static int in_ether_decode17 (const char *macStr, wol_mac *hwAddr)
+{
+    unsigned char bytes [8];
+    int badMask;
+    __m128i v0 = _mm_loadu_si128 ((const __m128i *)macStr);
+    __m128i v1 = _mm_loadu_si128 ((const __m128i *)(macStr + 1));
+    __m128i digits = _mm_or_si128 (
+        _mm_shuffle_epi8 (v0, _mm_setr_epi8 (0, 1, 3, 4, 6, 7, 9, 10, 12, 13, 15, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8 (v1, _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1, -1, -1, -1)));
+    int delims = _mm_movemask_epi8 (_mm_cmpeq_epi8 (v0, _mm_set1_epi8 (macStr [2])));
+    
+    if ((delims & 0x4924) != 0x4924 || (macStr [2] != ':' && macStr [2] != '-')) {
+        return (IN_ETHER_ERR_DELIM);
+    }
+    _mm_storel_epi64 ((__m128i *)bytes, in_ether_hex16 (digits, &badMask));
+    if (badMask & 0x0fff) {
+        return (IN_ETHER_ERR_HEX);
+    }
+    *hwAddr = in_ether_pack (bytes);
+    
+    return (IN_ETHER_OK);
+}
+
+#endif
+
+
+#if defined(__AVX2__)
+
+static inline __m256i in_ether_hex32 (__m256i v, unsigned int *badMask);
+
+
+/**
+ * Function to convert two colon or dash notation MAC addresses at once, the
+ * AVX2 version of in_ether_decode17(). Each 128-bit lane holds one address.
+ *
+ * @param s0 - the first MAC address string, at least 17 readable bytes
+ * @param s1 - the second MAC address string, at least 17 readable bytes
+ * @param hwAddrs - populated with the two packed 48-bit hardware addresses
+ *
+ * @return IN_ETHER_OK if both converted, else IN_ETHER_ERR_HEX or IN_ETHER_ERR_DELIM
+ */
+static int in_ether_decode17x2 (const char *s0, const char *s1, wol_mac *hwAddrs)
+{
+    unsigned char bytes [32];
+    __m256i v0 = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)s0)),
+                                          _mm_loadu_si128 ((const __m128i *)s1), 1);
+    __m256i v1 = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *)(s0 + 1))),
+                                          _mm_loadu_si128 ((const __m128i *)(s1 + 1)), 1);
+    __m256i digits = _mm256_or_si256 (
+        _mm256_shuffle_epi8 (v0, _mm256_setr_epi8 (0, 1, 3, 4, 6, 7, 9, 10, 12, 13, 15, -1, -1, -1, -1, -1,
+                                                   0, 1, 3, 4, 6, 7, 9, 10, 12, 13, 15, -1, -1, -1, -1, -1)),
+        _mm256_shuffle_epi8 (v1, _mm256_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1, -1, -1, -1,
+                                                   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1, -1, -1, -1)));
+    __m256i delim = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_set1_epi8 (s0 [2])),
+                                             _mm_set1_epi8 (s1 [2]), 1);
+    unsigned int delims = (unsigned int)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v0, delim));
+    unsigned int badMask;
+    
+    if ((delims & 0x49244924) != 0x49244924 ||
+        (s0 [2] != ':' && s0 [2] != '-') || (s1 [2] != ':' && s1 [2] != '-')) {
+        return (IN_ETHER_ERR_DELIM);
+    }
+    _mm256_storeu_si256 ((__m256i *)bytes, in_ether_hex32 (digits, &badMask));
+    if (badMask & 0x0fff0fff) {
+        return (IN_ETHER_ERR_HEX);
+    }
+    hwAddrs [0] = in_ether_pack (bytes);
+    hwAddrs [1] = in_ether_pack (bytes + 16);
+    
+    return (IN_ETHER_OK);
+}
+
+
+/**
+ * Function to decode two blocks of 16 hex digit characters in one 256-bit
+ * vector, the AVX2 version of in_ether_hex16(). The 8 bytes of each block
+ * are in the low half of each 128-bit lane.
+ */
+static inline __m256i in_ether_hex32 (__m256i v, unsigned int *badMask)
+{
+    const __m256i lower = _mm256_or_si256 (v, _mm256_set1_epi8 (0x20));
+    __m256i isDigit = _mm256_and_si256 (_mm256_cmpgt_epi8 (v, _mm256_set1_epi8 ('0' - 1)),
+                                        _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('9' + 1), v));
+    __m256i isAlpha = _mm256_and_si256 (_mm256_cmpgt_epi8 (lower, _mm256_set1_epi8 ('a' - 1)),
+                                        _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('f' + 1), lower));
+    __m256i nib = _mm256_or_si256 (_mm256_and_si256 (isDigit, _mm256_sub_epi8 (v, _mm256_set1_epi8 ('0'))),
+                                   _mm256_and_si256 (isAlpha, _mm256_sub_epi8 (lower, _mm256_set1_epi8 ('a' - 10))));
+    __m256i hi = _mm256_and_si256 (_mm256_slli_epi16 (nib, 4), _mm256_set1_epi16 (0x00f0));
+    __m256i lo = _mm256_srli_epi16 (nib, 8);
+    
+    *badMask = ~(unsigned int)_mm256_movemask_epi8 (_mm256_or_si256 (isDigit, isAlpha));
+    
+    return _mm256_packus_epi16 (_mm256_or_si256 (hi, lo), _mm256_setzero_si256 ());
+}
+
+#endif
+
+
+#if !defined(__SSE2__)
+
+/**
+ * Scalar fallback: decode one hex digit character, or -1 if it is not one.
+ */
+static int in_ether_nibble (char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return (-1);
+}
+
+#endif
+
+
+/**
+ * Function to decode one gathered block of 12 hex digits to a packed
+ * hardware address.
+ *
+ * @param digits - the 16 byte block from in_ether_gather()
+ * @param hwAddr - populated with the packed 48-bit hardware address
+ *
+ * @return IN_ETHER_OK, or IN_ETHER_ERR_HEX if a digit is not hex
+ */
+static int in_ether_decode (const char *digits, wol_mac *hwAddr)
+{
+    unsigned char bytes [8];
+    
+#if defined(__SSE2__)
+    int badMask;
+    __m128i out = in_ether_hex16 (_mm_loadu_si128 ((const __m128i *)digits), &badMask);
+    
+    if (badMask & 0x0fff) {
+        return (IN_ETHER_ERR_HEX);
+    }
+    _mm_storel_epi64 ((__m128i *)bytes, out);
+#else
+    int i;
+    
+    for (i = 0; i < 6; i++) {
+        int hi = in_ether_nibble (digits [i * 2]);
+        int lo = in_ether_nibble (digits [i * 2 + 1]);
+        
+        if (hi < 0 || lo < 0) {
+            return (IN_ETHER_ERR_HEX);
+        }
+        bytes [i] = (unsigned char)((hi << 4) | lo);
+    }
+#endif
+    
+    *hwAddr = in_ether_pack (bytes);
+    return (IN_ETHER_OK);
+}
+
+
+/**
+ * Function to trim the white space from around a MAC address string.
+ *
+ * @param macStr - the MAC address string
+ * @param len - populated with the trimmed length
+ *
+ * @return the start of the trimmed string
+ */
+static const char *in_ether_trim (const char *macStr, size_t *len)
+{
+    size_t n;
+    
+    while (IS_BLANK(*macStr)) {
+        macStr++;
+    }
+    for (n = strlen (macStr); n > 0 && IS_BLANK(macStr [n - 1]); n--);
+    *len = n;
+    
+    return (macStr);
+}
+
+
+/**
+ * Function to convert one trimmed MAC address string, in any of the
+ * recognized notations, to a packed hardware address.
+ *
+ * @param macStr - the MAC address string, at least len readable bytes
+ * @param len - the length of the MAC address string
+ * @param hwAddr - populated with the packed hardware address, 0 on error
+ *
+ * @return IN_ETHER_OK, or an IN_ETHER_ERR_* code
+ */
+static int in_ether_one (const char *macStr, size_t len, wol_mac *hwAddr)
+{
+    char digits [16];
+    int status;
+    
+#if defined(__SSSE3__)
+    if (len == 17) {
+        status = in_ether_decode17 (macStr, hwAddr);
+    }
+    else
+#endif
+    if ((status = in_ether_gather (macStr, len, digits)) == IN_ETHER_OK) {
+        status = in_ether_decode (digits, hwAddr);
+    }
+    
+    if (status != IN_ETHER_OK) {
+        *hwAddr = 0;
+    }
+    return (status);
+}
+
+
+/**
+ * Function to convert a batch of MAC address strings to packed 48-bit
+ * hardware addresses. Each string may be in colon, dash, Cisco dotted, or
+ * bare 12 hex digit notation; the notation is detected per string. Leading
+ * and trailing white space is ignored.
+ * The hex digits are decoded with SSE2, SSSE3 or AVX2 vector instructions
+ * when the library is built for them, else with a scalar loop.
+ *
+ * @param macStrs - the MAC address strings to convert
+ * @param count - the number of MAC address strings
+ * @param hwAddrs - populated with the packed hardware addresses
+ * @param status - populated with the result for each string, IN_ETHER_OK or an IN_ETHER_ERR_* code
+ *
+ * @return the number of MAC address strings converted
+ */
+int in_ether_bulk (char **macStrs, int count, wol_mac *hwAddrs, int *status)
+{
+    int i = 0, converted = 0;
+    
+    while (i < count) {
+        size_t len;
+        const char *s = in_ether_trim (macStrs [i], &len);
+        
+#if defined(__AVX2__)
+        /**
+         * Convert two colon or dash notation addresses per iteration. If
+         * either has an error, fall back to one at a time, which reports the
+         * specific error.
+         */
+        if (len == 17 && i + 1 < count) {
+            size_t len1;
+            const char *s1 = in_ether_trim (macStrs [i + 1], &len1);
+            
+            if (len1 == 17 && in_ether_decode17x2 (s, s1, hwAddrs + i) == IN_ETHER_OK) {
+                status [i] = status [i + 1] = IN_ETHER_OK;
+                converted += 2;
+                i += 2;
+                continue;
+            }
+        }
+#endif
+        if ((status [i] = in_ether_one (s, len, &hwAddrs [i])) == IN_ETHER_OK) {
+            converted++;
+        }
+        i++;
+    }
+    
+    return (converted);
+}
+
+
+/**
+ * Function to convert a text buffer of MAC addresses, one per line, to packed
+ * 48-bit hardware addresses, as for in_ether_bulk(). Lines may end with
+ * "\n" or "\r\n". Blank lines are reported with IN_ETHER_ERR_LENGTH.
+ *
+ * @param text - the text buffer, not necessarily terminated
+ * @param len - the length of the text buffer
+ * @param hwAddrs - populated with the packed hardware address of each line
+ * @param status - populated with the result for each line
+ * @param maxLines - the size of the hwAddrs and status arrays
+ *
+ * @return the number of lines processed
+ */
+int in_ether_lines (const char *text, size_t len, wol_mac *hwAddrs, int *status, int maxLines)
+{
+    const char *end = text + len;
+    int line = 0;
+    
+    while (text < end && line < maxLines) {
+        const char *eol = memchr (text, '\n', end - text);
+        const char *s = text, *e = eol ? eol : end;
+        
+        while (s < e && IS_BLANK(*s)) {
+            s++;
+        }
+        while (e > s && IS_BLANK(e [-1])) {
+            e--;
+        }
+        
+        status [line] = in_ether_one (s, e - s, &hwAddrs [line]);
+        line++;
+        
+        if (eol == NULL) {
+            break;
+        }
+        text = eol + 1;
+    }
+    
+    return (line);
+}
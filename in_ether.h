@@ -7,6 +7,8 @@
  * @brief Header file for in_ether.c
  * @details Provides the function prototype for the in_ether() library function. 
  * The in_ether() function converts a MAC address string to a hardware address.
+ * The in_ether_bulk() and in_ether_lines() functions convert many MAC address
+ * strings, in mixed notations, to packed wol_mac hardware addresses.
  * @copyright Copyright 2011 Perry M. Spagnola. All rights reserved.
  *
  * @section LICENSE
@@ -23,4 +25,20 @@
  * http://www.gnu.org/copyleft/gpl.html
  */
 
-int in_ether (char *bufp, unsigned char *addr);
\ No newline at end of file
+#ifndef IN_ETHER_H
+#define IN_ETHER_H
+
+#include "wol_lib.h"
+
+/** Per address results of the bulk conversion functions. */
+#define IN_ETHER_OK          0
+#define IN_ETHER_ERR_LENGTH  -1   /**< the length matches no known notation */
+#define IN_ETHER_ERR_HEX     -2   /**< a digit is not a hex character */
+#define IN_ETHER_ERR_DELIM   -3   /**< a delimiter is missing or misplaced */
+
+int in_ether (char *bufp, unsigned char *addr);
+int in_ether_mac (char *macStr, wol_mac *mac);
+int in_ether_bulk (char **macStrs, int count, wol_mac *hwAddrs, int *status);
+int in_ether_lines (const char *text, size_t len, wol_mac *hwAddrs, int *status, int maxLines);
+
+#endif /* IN_ETHER_H */
\ No newline at end of file
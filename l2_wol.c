@@ -0,0 +1,393 @@
+/**
+ * @file l2_wol.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Functions to send Wake on LAN magic packets as raw Ethernet frames.
+ * @details The magic packets are sent as EtherType 0x0842 frames on a chosen
+ * interface, bypassing IP routing and the UDP/IP stack. The frames are queued
+ * in a memory-mapped PACKET_MMAP TX ring, and a whole ring of frames is handed
+ * to the kernel with a single sendto(). Only available on Linux.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+#include "in_ether.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#define WOL_ETHERTYPE      0x0842
+#define WOL_L2_FRAME_LEN   (ETH_HLEN + 102)  /**< Ethernet header, then the magic packet */
+#define WOL_L2_SLOT_SIZE   256               /**< the size of one TX ring frame slot */
+#define WOL_L2_DEF_FRAMES  1024
+
+
+/**
+ * A layer 2 wake channel. Owns the packet socket bound to the interface, and
+ * the memory-mapped TX ring.
+ */
+struct wol_l2 {
+	int fd;                          /**< the AF_PACKET socket */
+	unsigned char srcAddr [6];       /**< the interface hardware address */
+	unsigned char *ring;             /**< the mapped TX ring */
+	size_t ringSize;                 /**< the size of the mapping */
+	unsigned int frames;             /**< the number of frame slots */
+	unsigned int head;               /**< the next slot to fill */
+	unsigned int queued;             /**< slots filled since the last flush */
+	unsigned int dataOff;            /**< the offset of the frame data in a slot */
+};
+
+
+/**
+ * Function to open a layer 2 wake channel on an interface.
+ *
+ * @param ifName - the interface name, e.g. "eth0"
+ * @param ringFrames - the number of TX ring frame slots, 0 for the default
+ *
+ * @return the new channel, or NULL on failure. Needs CAP_NET_RAW.
+ */
+wol_l2 *wol_l2_open (const char *ifName, int ringFrames)
+{
+	wol_l2 *l2;
+	struct ifreq ifr;
+	struct tpacket_req req;
+	struct sockaddr_ll sll;
+	int version = TPACKET_V2;
+	unsigned int perBlock;
+	int pageSize = getpagesize ();
+	
+	if (ifName == NULL || strlen (ifName) >= IFNAMSIZ) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if ((l2 = calloc (1, sizeof (wol_l2))) == NULL) {
+		return (NULL);
+	}
+	
+	/**
+     * Protocol 0: the channel only sends, so no inbound frames are queued
+     * on the socket.
+     */
+	if ((l2->fd = socket (AF_PACKET, SOCK_RAW, 0)) < 0) {
+		free (l2);
+		return (NULL);
+	}
+	
+	/**
+     * Look up the interface index, and its hardware address for the frame
+     * source address.
+     */
+	memset (&ifr, 0, sizeof (ifr));
+	strcpy (ifr.ifr_name, ifName);
+	if (ioctl (l2->fd, SIOCGIFINDEX, &ifr) < 0) {
+		goto fail;
+	}
+	memset (&sll, 0, sizeof (sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = 0;
+	sll.sll_ifindex = ifr.ifr_ifindex;
+	if (ioctl (l2->fd, SIOCGIFHWADDR, &ifr) < 0) {
+		goto fail;
+	}
+	memcpy (l2->srcAddr, ifr.ifr_hwaddr.sa_data, 6);
+	
+	/**
+     * Set up the TX ring: one page per block, frame slots packed into the
+     * blocks, and the slot count rounded up to whole blocks.
+     */
+	if (setsockopt (l2->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) < 0) {
+		goto fail;
+	}
+	perBlock = pageSize / WOL_L2_SLOT_SIZE;
+	if (ringFrames <= 0) {
+		ringFrames = WOL_L2_DEF_FRAMES;
+	}
+	memset (&req, 0, sizeof (req));
+	req.tp_block_size = pageSize;
+	req.tp_frame_size = WOL_L2_SLOT_SIZE;
+	req.tp_block_nr = (ringFrames + perBlock - 1) / perBlock;
+	req.tp_frame_nr = req.tp_block_nr * perBlock;
+	if (setsockopt (l2->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof (req)) < 0) {
+		goto fail;
+	}
+	l2->frames = req.tp_frame_nr;
+	l2->ringSize = (size_t)req.tp_block_size * req.tp_block_nr;
+	l2->dataOff = TPACKET2_HDRLEN - sizeof (struct sockaddr_ll);
+	
+	l2->ring = mmap (NULL, l2->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, l2->fd, 0);
+	if (l2->ring == MAP_FAILED) {
+		goto fail;
+	}
+	
+	if (bind (l2->fd, (struct sockaddr *)&sll, sizeof (sll)) < 0) {
+		munmap (l2->ring, l2->ringSize);
+		goto fail;
+	}
+	
+	return (l2);
+	
+fail:
+	close (l2->fd);
+	free (l2);
+	return (NULL);
+}
+
+
+/**
+ * Function to close a layer 2 wake channel. Queued frames that were not
+ * flushed are discarded.
+ *
+ * @param l2 - the channel to close, may be NULL
+ */
+void wol_l2_close (wol_l2 *l2)
+{
+	if (l2 == NULL) {
+		return;
+	}
+	munmap (l2->ring, l2->ringSize);
+	close (l2->fd);
+	free (l2);
+}
+
+
+/**
+ * Function to hand every queued frame to the kernel with one sendto().
+ *
+ * @param l2 - the channel
+ *
+ * @return the number of frames sent, or -1 on failure
+ */
+int wol_l2_flush (wol_l2 *l2)
+{
+	ssize_t sent;
+	
+	if (l2->queued == 0) {
+		return (0);
+	}
+	
+	while ((sent = sendto (l2->fd, NULL, 0, 0, NULL, 0)) < 0) {
+		if (errno != EINTR) {
+			return (-1);
+		}
+	}
+	l2->queued = 0;
+	
+	return ((int)(sent / WOL_L2_FRAME_LEN));
+}
+
+
+/**
+ * Function to queue a magic packet frame in the TX ring. If the ring is full,
+ * the queued frames are flushed, and the call waits for a free slot.
+ *
+ * @param l2 - the channel
+ * @param hwAddr - the 6 byte hardware address to wake
+ * @param directed - 1 to address the frame to hwAddr, 0 to broadcast it
+ *
+ * @return success or failure queueing the frame
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_l2_queue (wol_l2 *l2, const unsigned char *hwAddr, int directed)
+{
+	struct tpacket2_hdr *hdr;
+	unsigned char *frame;
+	
+	hdr = (struct tpacket2_hdr *)(l2->ring + (size_t)l2->head * WOL_L2_SLOT_SIZE);
+	
+	/**
+     * Wait for the kernel to release the slot. It is only still in use when
+     * the whole ring has been queued, so flush first.
+     */
+	while (__atomic_load_n (&hdr->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE) {
+		struct pollfd pfd;
+		
+		if (hdr->tp_status == TP_STATUS_WRONG_FORMAT) {
+			hdr->tp_status = TP_STATUS_AVAILABLE;
+			break;
+		}
+		if (wol_l2_flush (l2) < 0) {
+			return (-1);
+		}
+		pfd.fd = l2->fd;
+		pfd.events = POLLOUT;
+		poll (&pfd, 1, 1);
+	}
+	
+	/**
+     * Build the frame in place: destination, source, EtherType, then the
+     * magic packet payload.
+     */
+	frame = (unsigned char *)hdr + l2->dataOff;
+	if (directed) {
+		memcpy (frame, hwAddr, 6);
+	}
+	else {
+		memset (frame, 0xff, 6);
+	}
+	memcpy (frame + 6, l2->srcAddr, 6);
+	frame [12] = WOL_ETHERTYPE >> 8;
+	frame [13] = WOL_ETHERTYPE & 0xff;
+	wol_build_magic (wol_mac_from_bytes (hwAddr), frame + ETH_HLEN);
+	
+	hdr->tp_len = WOL_L2_FRAME_LEN;
+	__atomic_store_n (&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+	
+	l2->head = (l2->head + 1) % l2->frames;
+	l2->queued++;
+	
+	return (0);
+}
+
+
+/**
+ * Function to send magic packet frames to a batch of hardware addresses.
+ * The frames are queued in the TX ring and flushed a ring at a time. A failed
+ * flush ends the batch: the addresses it held, and those not yet queued, are
+ * marked failed, and the frames sent before it are counted.
+ *
+ * @param l2 - the channel
+ * @param hwAddrs - the array of 6 byte hardware addresses
+ * @param count - the number of hardware addresses
+ * @param directed - 1 to address each frame to its hardware address, 0 to broadcast
+ * @param status - populated with the result for each address, 0 sent or -1 failed, may be NULL
+ *
+ * @return the number of frames sent
+ */
+int wol_l2_send_batch (wol_l2 *l2, unsigned char (*hwAddrs)[6], int count, int directed, int *status)
+{
+	int i, n, sent = 0, flushed = 0;
+	
+	for (i = 0; i < count; i++) {
+		if (l2->queued == l2->frames) {
+			if ((n = wol_l2_flush (l2)) < 0) {
+				break;
+			}
+			sent += n;
+			flushed = i;
+		}
+		n = wol_l2_queue (l2, hwAddrs [i], directed);
+		if (status != NULL) {
+			status [i] = n;
+		}
+	}
+	
+	if (i == count) {
+		if ((n = wol_l2_flush (l2)) >= 0) {
+			return (sent + n);
+		}
+	}
+	
+	/** Mark the unflushed and the unqueued addresses failed. */
+	if (status != NULL) {
+		for (i = flushed; i < count; i++) {
+			status [i] = -1;
+		}
+	}
+	
+	return (sent);
+}
+
+#else
+
+wol_l2 *wol_l2_open (const char *ifName, int ringFrames)
+{
+	(void)ifName;
+	(void)ringFrames;
+	errno = ENOSYS;
+	return (NULL);
+}
+
+void wol_l2_close (wol_l2 *l2)
+{
+	(void)l2;
+}
+
+int wol_l2_flush (wol_l2 *l2)
+{
+	(void)l2;
+	errno = ENOSYS;
+	return (-1);
+}
+
+int wol_l2_queue (wol_l2 *l2, const unsigned char *hwAddr, int directed)
+{
+	(void)l2;
+	(void)hwAddr;
+	(void)directed;
+	errno = ENOSYS;
+	return (-1);
+}
+
+int wol_l2_send_batch (wol_l2 *l2, unsigned char (*hwAddrs)[6], int count, int directed, int *status)
+{
+	(void)l2;
+	(void)hwAddrs;
+	(void)count;
+	(void)directed;
+	(void)status;
+	errno = ENOSYS;
+	return (-1);
+}
+
+#endif /* __linux__ */
+
+
+/**
+ * Function to send a magic packet as a broadcast Ethernet frame on the
+ * argument specified interface. The MAC address is a string in the format:
+ * <code>xx:xx:xx:xx:xx:xx</code>.
+ *
+ * @param ifName - the interface to send the frame on
+ * @param macAddr - the MAC address string to send the magic packet to
+ *
+ * @return success or failure of the send attempt
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int send_wol_l2 (char *ifName, char *macAddr)
+{
+	unsigned char ethaddr[8];
+	wol_l2 *l2;
+	int sent;
+	
+	if (in_ether (macAddr, ethaddr) < 0) {
+		return (-1);
+	}
+	if ((l2 = wol_l2_open (ifName, 1)) == NULL) {
+		return (-1);
+	}
+	sent = (wol_l2_queue (l2, ethaddr, 0) == 0) ? wol_l2_flush (l2) : -1;
+	wol_l2_close (l2);
+	
+	return (sent == 1) ? 0 : -1;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file mac_addr.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Functions for the packed 48-bit MAC address type.
+ * @details A wol_mac holds a MAC address in the low 48 bits of a 64-bit integer,
+ * the first octet most significant, so addresses compare, sort and hash as plain
+ * integers. These functions convert between the packed value, its 6 bytes, and
+ * its string forms. Parsing and formatting are table driven, write only into
+ * bounded caller buffers, and never allocate.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+
+
+/**
+ * The value of each hex digit character plus one. Zero marks a character
+ * that is not a hex digit.
+ */
+static const unsigned char hexValue [256] = {
+	['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+	['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+};
+
+/** The hex digit characters, lowercase then uppercase. */
+static const char hexDigits [2][16] = {
+	{ '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' },
+	{ '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' }
+};
+
+
+/**
+ * Function to pack 6 bytes into a MAC address value.
+ *
+ * @param bytes - the 6 byte hardware address
+ *
+ * @return the packed MAC address
+ */
+wol_mac wol_mac_from_bytes (const unsigned char *bytes)
+{
+	return ((wol_mac)bytes [0] << 40) | ((wol_mac)bytes [1] << 32) | ((wol_mac)bytes [2] << 24) |
+		   ((wol_mac)bytes [3] << 16) | ((wol_mac)bytes [4] << 8) | (wol_mac)bytes [5];
+}
+
+
+/**
+ * Function to unpack a MAC address value into 6 bytes.
+ *
+ * @param mac - the packed MAC address
+ * @param bytes - the 6 byte buffer to populate
+ */
+void wol_mac_to_bytes (wol_mac mac, unsigned char *bytes)
+{
+	int i;
+	
+	for (i = 5; i >= 0; i--) {
+		bytes [i] = (unsigned char)(mac & 0xff);
+		mac >>= 8;
+	}
+}
+
+
+/**
+ * Function to parse a MAC address string into a MAC address value. Accepts
+ * six octets of one or two hex digits separated by colons or dashes (the
+ * octets of "arp" output may lack their leading zero), Cisco dotted notation
+ * <code>xxxx.xxxx.xxxx</code>, and 12 bare hex digits. The string is not
+ * modified.
+ *
+ * @param macStr - the MAC address string
+ * @param mac - populated with the packed MAC address
+ *
+ * @return success or failure of the conversion
+ * @retval 0 - success
+ * @retval -1 - failure, the string is not a MAC address
+ */
+int wol_mac_parse (const char *macStr, wol_mac *mac)
+{
+	const unsigned char *ptr = (const unsigned char *)macStr;
+	wol_mac val = 0;
+	int digits, groups, groupLen;
+	unsigned char delim = 0;
+	
+	/**
+     * Read groups of hex digits separated by a single delimiter character.
+     * The delimiter, and the group lengths, determine the notation.
+     */
+	digits = 0;
+	groups = 0;
+	for (;;) {
+		wol_mac group = 0;
+		
+		groupLen = 0;
+		while (hexValue [*ptr] != 0 && groupLen <= 12) {
+			group = (group << 4) | (hexValue [*ptr] - 1);
+			ptr++;
+			groupLen++;
+		}
+		groups++;
+		
+		if (delim == 0 && (*ptr == ':' || *ptr == '-' || *ptr == '.')) {
+			delim = *ptr;
+		}
+		
+		if (delim == ':' || delim == '-') {
+			/**
+			 * An octet of one or two digits.
+			 */
+			if (groupLen < 1 || groupLen > 2) {
+				return (-1);
+			}
+			val = (val << 8) | group;
+			digits += 2;
+		}
+		else if (delim == '.') {
+			if (groupLen != 4) {
+				return (-1);
+			}
+			val = (val << 16) | group;
+			digits += 4;
+		}
+		else {
+			val = group;
+			digits += groupLen;
+		}
+		
+		if (*ptr == '\0' || *ptr != delim || digits > 12) {
+			break;
+		}
+		ptr++;
+	}
+	
+	if (*ptr != '\0' || digits != 12) {
+		return (-1);
+	}
+	if ((delim == ':' || delim == '-') ? groups != 6 : (delim == '.') ? groups != 3 : groups != 1) {
+		return (-1);
+	}
+	
+	*mac = val;
+	return (0);
+}
+
+
+/**
+ * Function to format a MAC address value as a string. The default form is
+ * six two hex digit lowercase octets separated by colons.
+ *
+ * @param mac - the packed MAC address
+ * @param style - WOL_MAC_LOWER, or any of WOL_MAC_UPPER and WOL_MAC_DASHED
+ * @param buf - the buffer to write the string into
+ * @param len - the size of the buffer, at least WOL_MAC_STRLEN
+ *
+ * @return success or failure of the conversion
+ * @retval 0 - success
+ * @retval -1 - failure, the buffer is too small
+ */
+int wol_mac_format (wol_mac mac, int style, char *buf, size_t len)
+{
+	const char *hex = hexDigits [(style & WOL_MAC_UPPER) ? 1 : 0];
+	char delim = (style & WOL_MAC_DASHED) ? '-' : ':';
+	int i, shift;
+	
+	if (len < WOL_MAC_STRLEN) {
+		if (len > 0) {
+			buf [0] = '\0';
+		}
+		return (-1);
+	}
+	
+	for (i = 0, shift = 40; i < 6; i++, shift -= 8) {
+		unsigned int octet = (unsigned int)(mac >> shift) & 0xff;
+		
+		buf [i * 3] = hex [octet >> 4];
+		buf [i * 3 + 1] = hex [octet & 0x0f];
+		buf [i * 3 + 2] = delim;
+	}
+	buf [17] = '\0';
+	
+	return (0);
+}
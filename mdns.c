@@ -0,0 +1,616 @@
+/**
+ * @file mdns.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief In-process mDNS querier for device information.
+ * @details Encodes mDNS TXT queries and decodes the responses in DNS wire format,
+ * replacing the "dig" command pipeline. Many host names are put into a single
+ * query packet, and the responses for all of them are collected in one timed
+ * receive window.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+#include "mdns.h"
+#include "icmp.h"
+#include "wol_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+
+/**
+ * Function to encode one DNS name, a host label followed by the service
+ * labels. The first encoded service suffix is remembered, and later names
+ * point back to it with a compression pointer.
+ *
+ * @param buf - the message buffer
+ * @param off - the offset to write the name at
+ * @param bufLen - the size of the message buffer
+ * @param host - the host name, may contain dots
+ * @param service - the service and domain name, e.g. "_device-info._tcp.local"
+ * @param suffixOff - the offset of the encoded service suffix, or 0 if not yet written
+ *
+ * @return the offset following the name, or -1 if it does not fit
+ */
+static int mdns_write_name (unsigned char *buf, int off, int bufLen, const char *host,
+							const char *service, int *suffixOff)
+{
+	const char *parts [2];
+	int p;
+	
+	parts [0] = host;
+	parts [1] = service;
+	
+	for (p = 0; p < 2; p++) {
+		const char *label = parts [p];
+		
+		if (p == 1 && *suffixOff != 0) {
+			/**
+			 * The suffix has been written before, point back to it.
+			 */
+			if (off + 2 > bufLen) {
+				return (-1);
+			}
+			buf [off++] = 0xc0 | (*suffixOff >> 8);
+			buf [off++] = *suffixOff & 0xff;
+			return (off);
+		}
+		if (p == 1) {
+			*suffixOff = off;
+		}
+		
+		while (*label != '\0') {
+			const char *dot = strchr (label, '.');
+			int len = dot ? (int)(dot - label) : (int)strlen (label);
+			
+			if (len == 0 || len > 63 || off + 1 + len > bufLen) {
+				return (-1);
+			}
+			buf [off++] = (unsigned char)len;
+			memcpy (buf + off, label, len);
+			off += len;
+			label += len;
+			if (*label == '.') {
+				label++;
+			}
+		}
+	}
+	
+	if (off + 1 > bufLen) {
+		return (-1);
+	}
+	buf [off++] = 0;
+	
+	return (off);
+}
+
+
+/**
+ * Function to build an mDNS query message with one question per host name.
+ * Questions are added until the buffer is full, so a long host list is sent
+ * as several messages.
+ *
+ * @param hosts - the host names to query
+ * @param count - the number of host names
+ * @param service - the service and domain appended to each host name
+ * @param qtype - the query type, e.g. DNS_TYPE_TXT
+ * @param buf - the message buffer
+ * @param bufLen - the size of the message buffer
+ * @param used - populated with the number of host names encoded
+ *
+ * @return the length of the message, or -1 if not even one question fits
+ */
+int mdns_build_query (char **hosts, int count, const char *service, unsigned short qtype,
+					  unsigned char *buf, int bufLen, int *used)
+{
+	int i, off = DNS_HEADER_LEN;
+	int suffixOff = 0;
+	
+	if (bufLen < DNS_HEADER_LEN) {
+		return (-1);
+	}
+	
+	/**
+     * The header: a zero id and flags, as for any mDNS query, and the
+     * question count filled in at the end.
+     */
+	memset (buf, 0, DNS_HEADER_LEN);
+	
+	for (i = 0; i < count && i < 0xffff; i++) {
+		int next = mdns_write_name (buf, off, bufLen, hosts [i], service, &suffixOff);
+		
+		if (next < 0 || next + 4 > bufLen) {
+			if (suffixOff >= off) {
+				suffixOff = 0;
+			}
+			break;
+		}
+		buf [next++] = qtype >> 8;
+		buf [next++] = qtype & 0xff;
+		buf [next++] = DNS_CLASS_IN >> 8;
+		buf [next++] = DNS_CLASS_IN & 0xff;
+		off = next;
+	}
+	
+	if (i == 0) {
+		return (-1);
+	}
+	buf [4] = i >> 8;
+	buf [5] = i & 0xff;
+	*used = i;
+	
+	return (off);
+}
+
+
+/**
+ * Function to decode a DNS name from a message, following compression pointers.
+ *
+ * @param msg - the message
+ * @param len - the length of the message
+ * @param off - the offset of the name
+ * @param name - populated with the dotted name
+ * @param nameLen - the size of the name buffer
+ *
+ * @return the offset following the name in the message, or -1 if malformed
+ */
+int mdns_read_name (const unsigned char *msg, int len, int off, char *name, int nameLen)
+{
+	int next = -1;
+	int jumps = 0;
+	int out = 0;
+	
+	for (;;) {
+		int labelLen;
+		
+		if (off >= len) {
+			return (-1);
+		}
+		labelLen = msg [off];
+		
+		if ((labelLen & 0xc0) == 0xc0) {
+			/**
+			 * A compression pointer. The name continues elsewhere in the
+			 * message. Guard against pointer loops.
+			 */
+			if (off + 1 >= len || ++jumps > 32) {
+				return (-1);
+			}
+			if (next < 0) {
+				next = off + 2;
+			}
+			off = ((labelLen & 0x3f) << 8) | msg [off + 1];
+			continue;
+		}
+		if (labelLen & 0xc0) {
+			return (-1);
+		}
+		
+		off++;
+		if (labelLen == 0) {
+			break;
+		}
+		if (off + labelLen > len || out + labelLen + 2 > nameLen) {
+			return (-1);
+		}
+		if (out > 0) {
+			name [out++] = '.';
+		}
+		memcpy (name + out, msg + off, labelLen);
+		out += labelLen;
+		off += labelLen;
+	}
+	
+	name [out] = '\0';
+	
+	return (next < 0) ? off : next;
+}
+
+
+/**
+ * Function to parse a DNS message, and invoke a callback for each answer,
+ * authority and additional resource record.
+ *
+ * @param msg - the message
+ * @param len - the length of the message
+ * @param cb - the callback for each resource record
+ * @param arg - the argument passed to the callback
+ *
+ * @return 0 if the message was parsed, -1 if it is malformed
+ */
+int mdns_parse (const unsigned char *msg, int len, mdns_rr_cb cb, void *arg)
+{
+	char name [MDNS_MAX_NAME];
+	int qdCount, rrCount, i, off;
+	
+	if (len < DNS_HEADER_LEN) {
+		return (-1);
+	}
+	qdCount = (msg [4] << 8) | msg [5];
+	rrCount = ((msg [6] << 8) | msg [7]) + ((msg [8] << 8) | msg [9]) + ((msg [10] << 8) | msg [11]);
+	off = DNS_HEADER_LEN;
+	
+	/** Skip over the questions. */
+	for (i = 0; i < qdCount; i++) {
+		if ((off = mdns_read_name (msg, len, off, name, sizeof (name))) < 0 || off + 4 > len) {
+			return (-1);
+		}
+		off += 4;
+	}
+	
+	for (i = 0; i < rrCount; i++) {
+		unsigned short type;
+		unsigned int ttl;
+		int rdLen;
+		
+		if ((off = mdns_read_name (msg, len, off, name, sizeof (name))) < 0 || off + 10 > len) {
+			return (-1);
+		}
+		type = (msg [off] << 8) | msg [off + 1];
+		ttl = ((unsigned int)msg [off + 4] << 24) | (msg [off + 5] << 16) | (msg [off + 6] << 8) | msg [off + 7];
+		rdLen = (msg [off + 8] << 8) | msg [off + 9];
+		off += 10;
+		if (off + rdLen > len) {
+			return (-1);
+		}
+		if (cb (arg, name, type, ttl, msg + off, rdLen) != 0) {
+			break;
+		}
+		off += rdLen;
+	}
+	
+	return (0);
+}
+
+
+/**
+ * Function to extract the model identifier from the data of a TXT record.
+ * Looks for the <code>model=</code> string, the key in any case as DNS-SD
+ * keys are case-insensitive, and copies its value.
+ *
+ * @param rdata - the TXT record data, a list of length prefixed strings
+ * @param rdLen - the length of the TXT record data
+ * @param model - populated with the model identifier
+ * @param modelLen - the size of the model buffer
+ *
+ * @return the success or failure status of the function
+ * @retval 0 - success
+ * @retval 1 - failure, no model in the record
+ */
+int mdns_txt_model (const unsigned char *rdata, int rdLen, char *model, int modelLen)
+{
+	int off = 0;
+	
+	while (off < rdLen) {
+		int len = rdata [off++];
+		
+		if (off + len > rdLen) {
+			break;
+		}
+		if (len > 6 && len - 6 < modelLen && strncasecmp ((const char *)rdata + off, "model=", 6) == 0) {
+			memcpy (model, rdata + off + 6, len - 6);
+			model [len - 6] = '\0';
+			return 0;
+		}
+		off += len;
+	}
+	
+	return 1;
+}
+
+
+/**
+ * The state of one batched device information query: the host names asked
+ * for, and a hash index from host name to request slot.
+ */
+struct mdns_query {
+	char **hosts;
+	char **devInfos;
+	int *status;
+	int count;
+	int remaining;
+	int *index;          /**< hash slots, holding request index + 1 */
+	unsigned int mask;
+	uint64_t start;      /**< when the queries were sent, monotonic ns */
+};
+
+
+/**
+ * Function to hash the first label of a host name, ignoring case.
+ *
+ * @param name - the name
+ * @param len - the length of the label
+ *
+ * @return the hash
+ */
+static unsigned int mdns_hash_label (const char *name, int len)
+{
+	unsigned int h = 2166136261u;
+	int i;
+	
+	for (i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)tolower ((unsigned char)name [i])) * 16777619u;
+	}
+	return (h);
+}
+
+
+/**
+ * Callback for mdns_parse(). Matches each device information TXT record
+ * to the request for its host, and records the model identifier.
+ */
+static int mdns_query_rr (void *arg, const char *name, unsigned short type,
+						  unsigned int ttl, const unsigned char *rdata, int rdLen)
+{
+	struct mdns_query *q = arg;
+	const char *suffix;
+	int hostLen;
+	unsigned int slot;
+	
+	(void)ttl;
+	
+	if (type != DNS_TYPE_TXT) {
+		return (0);
+	}
+	
+	/**
+     * The record name is "host._device-info._tcp.local". Split off the host part.
+     */
+	hostLen = (int)strlen (name) - (int)strlen (MDNS_DEVICE_INFO) - 1;
+	if (hostLen <= 0 || name [hostLen] != '.') {
+		return (0);
+	}
+	suffix = name + hostLen + 1;
+	if (strcasecmp (suffix, MDNS_DEVICE_INFO) != 0) {
+		return (0);
+	}
+	
+	/**
+     * Complete every request for the host, as a batch may name it twice.
+     */
+	slot = mdns_hash_label (name, hostLen) & q->mask;
+	while (q->index [slot] != 0) {
+		int i = q->index [slot] - 1;
+		
+		if ((int)strlen (q->hosts [i]) == hostLen && strncasecmp (q->hosts [i], name, hostLen) == 0) {
+			if (q->status [i] != 0 &&
+				mdns_txt_model (rdata, rdLen, q->devInfos [i], WOL_DEVINFO_LEN) == 0) {
+				q->status [i] = 0;
+				q->remaining--;
+				WOL_STATS_COUNT (WOL_CTR_MDNS_ANSWERS, 1);
+				WOL_STATS_LATENCY (WOL_HIST_MDNS, q->start);
+			}
+		}
+		slot = (slot + 1) & q->mask;
+	}
+	
+	return (0);
+}
+
+
+/**
+ * Function to query a batch of hosts for their device information with
+ * mDNS TXT queries for <code>host._device-info._tcp.local</code>. All of the
+ * host names are put into as few query packets as possible, and the responses
+ * are collected in a single receive window.
+ *
+ * @param hosts - the hosts to retrieve the device info for
+ * @param count - the number of hosts
+ * @param hostIP - the IP address to query, NULL or "" for the mDNS multicast group
+ * @param timeoutMs - the length of the receive window, in milliseconds
+ * @param devInfos - the buffers, WOL_DEVINFO_LEN bytes each, populated with the device info
+ * @param status - populated with the result for each host, 0 found or 1 not found
+ *
+ * @return the number of hosts found, or -1 if the queries could not be sent
+ */
+static int mdns_query_hosts (char **hosts, int count, char *hostIP, int timeoutMs, char **devInfos, int *status)
+{
+	struct mdns_query q;
+	struct sockaddr_in sap;
+	struct timespec start;
+	unsigned char buf [9000];
+	unsigned int slots = 16;
+	int i, fd, sent, skipped = 0;
+	
+	if (count <= 0) {
+		return (0);
+	}
+	
+	memset (&sap, 0, sizeof (sap));
+	sap.sin_family = AF_INET;
+	sap.sin_port = htons(MDNS_PORT);
+	if (hostIP == NULL || strcmp(hostIP, "") == 0) {
+		inet_pton (AF_INET, MDNS_GROUP, &sap.sin_addr);
+	}
+	else if (inet_pton (AF_INET, hostIP, &sap.sin_addr) != 1) {
+		return (-1);
+	}
+	
+	/**
+     * Index the requests by host name, so each response is matched in
+     * constant time.
+     */
+	while (slots < (unsigned int)count * 2) {
+		slots <<= 1;
+	}
+	memset (&q, 0, sizeof (q));
+	if ((q.index = calloc (slots, sizeof (int))) == NULL) {
+		return (-1);
+	}
+	q.mask = slots - 1;
+	q.hosts = hosts;
+	q.devInfos = devInfos;
+	q.status = status;
+	q.count = count;
+	q.remaining = count;
+	for (i = 0; i < count; i++) {
+		unsigned int slot = mdns_hash_label (hosts [i], (int)strlen (hosts [i])) & q.mask;
+		
+		while (q.index [slot] != 0) {
+			slot = (slot + 1) & q.mask;
+		}
+		q.index [slot] = i + 1;
+		status [i] = 1;
+		devInfos [i][0] = '\0';
+	}
+	
+	/**
+     * Query from an ephemeral port. Responders answer such "legacy unicast"
+     * queries directly to the querying port.
+     */
+	if ((fd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_MDNS, errno);
+		free (q.index);
+		return (-1);
+	}
+	
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	q.start = (uint64_t)start.tv_sec * 1000000000ULL + start.tv_nsec;
+	WOL_STATS_COUNT (WOL_CTR_MDNS_QUERIES, count);
+	for (i = 0; i < count; i += sent) {
+		int len = mdns_build_query (hosts + i, count - i, MDNS_DEVICE_INFO, DNS_TYPE_TXT,
+									buf, MDNS_MAX_PACKET, &sent);
+		
+		if (len < 0) {
+			/**
+			 * A host name that cannot be encoded, an empty label or one
+			 * longer than 63 characters, is not found. Query the rest.
+			 */
+			WOL_STATS_ERROR (WOL_STAGE_MDNS, EMSGSIZE);
+			skipped++;
+			sent = 1;
+			continue;
+		}
+		if (sendto (fd, (char *)buf, len, 0, (struct sockaddr *)&sap, sizeof (sap)) < 0) {
+			WOL_STATS_ERROR (WOL_STAGE_MDNS, errno);
+			close (fd);
+			free (q.index);
+			return (-1);
+		}
+	}
+	
+	/**
+     * Collect the responses until every host has answered, or the receive
+     * window closes.
+     */
+	while (q.remaining > skipped) {
+		struct pollfd pfd;
+		long remaining = timeoutMs - icmp_elapsed_usec (&start) / 1000;
+		ssize_t len;
+		
+		if (remaining <= 0) {
+			break;
+		}
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if ((len = poll (&pfd, 1, (int)remaining)) < 0 && errno == EINTR) {
+			continue;
+		}
+		if (len <= 0) {
+			break;
+		}
+		if ((len = recv (fd, (char *)buf, sizeof (buf), 0)) > 0) {
+			mdns_parse (buf, (int)len, mdns_query_rr, &q);
+		}
+	}
+	
+	close (fd);
+	free (q.index);
+	
+	return (count - q.remaining);
+}
+
+
+/**
+ * Function to retrieve the device information for a batch of hosts. The
+ * hosts in the passive listener's index are answered from it, see
+ * <code>wol_mdns_watch_start()</code>, and the rest are queried with
+ * mDNS TXT queries for <code>host._device-info._tcp.local</code>, all in a
+ * single receive window.
+ *
+ * @param hosts - the hosts to retrieve the device info for
+ * @param count - the number of hosts
+ * @param hostIP - the IP address to query, NULL or "" for the mDNS multicast group
+ * @param timeoutMs - the length of the receive window, in milliseconds
+ * @param devInfos - the buffers, WOL_DEVINFO_LEN bytes each, populated with the device info
+ * @param status - populated with the result for each host, 0 found or 1 not found
+ *
+ * @return the number of hosts found, or -1 if the queries could not be sent
+ */
+int deviceInfoForHosts(char **hosts, int count, char *hostIP, int timeoutMs, char **devInfos, int *status)
+{
+	char **askHosts, **askInfos;
+	int *askStatus, *askIndex;
+	int i, asked = 0, found = 0, rc;
+	
+	if (count <= 0) {
+		return (0);
+	}
+	if (wol_mdns_watch_lookup (hosts [0], devInfos [0], WOL_DEVINFO_LEN) < 0) {
+		return (mdns_query_hosts (hosts, count, hostIP, timeoutMs, devInfos, status));
+	}
+	
+	/**
+     * Answer what the index knows, and gather the rest into one query.
+     */
+	askHosts = malloc (count * sizeof (char *));
+	askInfos = malloc (count * sizeof (char *));
+	askStatus = malloc (count * sizeof (int));
+	askIndex = malloc (count * sizeof (int));
+	if (askHosts == NULL || askInfos == NULL || askStatus == NULL || askIndex == NULL) {
+		free (askHosts);
+		free (askInfos);
+		free (askStatus);
+		free (askIndex);
+		return (-1);
+	}
+	for (i = 0; i < count; i++) {
+		if (wol_mdns_watch_lookup (hosts [i], devInfos [i], WOL_DEVINFO_LEN) == 0) {
+			status [i] = 0;
+			found++;
+		}
+		else {
+			askHosts [asked] = hosts [i];
+			askInfos [asked] = devInfos [i];
+			askIndex [asked++] = i;
+		}
+	}
+	
+	rc = (asked > 0) ? mdns_query_hosts (askHosts, asked, hostIP, timeoutMs, askInfos, askStatus) : 0;
+	for (i = 0; i < asked; i++) {
+		status [askIndex [i]] = (rc < 0) ? 1 : askStatus [i];
+	}
+	
+	free (askHosts);
+	free (askInfos);
+	free (askStatus);
+	free (askIndex);
+	
+	return (rc < 0 ? -1 : found + rc);
+}
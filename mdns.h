@@ -0,0 +1,52 @@
+/**
+ * @file mdns.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for mdns.c
+ * @details Provides the constants and function prototypes used by the library to
+ * encode mDNS queries and decode mDNS responses in DNS wire format.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef MDNS_H
+#define MDNS_H
+
+#define MDNS_GROUP          "224.0.0.251"
+#define MDNS_PORT           5353
+#define MDNS_DEVICE_INFO    "_device-info._tcp.local"
+#define MDNS_MAX_PACKET     1440     /**< keeps a query within one Ethernet frame */
+#define MDNS_MAX_NAME       256
+
+#define DNS_TYPE_TXT        16
+#define DNS_CLASS_IN        1
+#define DNS_HEADER_LEN      12
+
+/**
+ * The callback invoked by mdns_parse() for each resource record of a message.
+ * Returns 0 to continue parsing, non-zero to stop.
+ */
+typedef int (*mdns_rr_cb) (void *arg, const char *name, unsigned short type,
+						   unsigned int ttl, const unsigned char *rdata, int rdLen);
+
+int mdns_build_query (char **hosts, int count, const char *service, unsigned short qtype,
+					  unsigned char *buf, int bufLen, int *used);
+int mdns_read_name (const unsigned char *msg, int len, int off, char *name, int nameLen);
+int mdns_parse (const unsigned char *msg, int len, mdns_rr_cb cb, void *arg);
+int mdns_txt_model (const unsigned char *rdata, int rdLen, char *model, int modelLen);
+
+#endif /* MDNS_H */
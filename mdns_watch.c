@@ -0,0 +1,466 @@
+/**
+ * @file mdns_watch.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Passive mDNS listener that indexes the device models announced on the segment.
+ * @details A background thread joins the mDNS group, and parses every
+ * announcement and response it hears. The <code>_device-info._tcp.local</code>
+ * TXT records are kept in a host name to model index, for as long as their
+ * TTL, and dropped on a goodbye. While the listener runs, deviceInfoForHost()
+ * answers from the index first, and only queries for the hosts not in it.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+#include "mdns.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MDNS_WATCH_BUCKETS       1024      /**< hash chains, a power of two */
+#define MDNS_WATCH_DEF_CAPACITY  4096
+#define MDNS_WATCH_PURGE_MS      1000      /**< how often expired entries are dropped */
+
+
+/**
+ * One host's announced model, and when its record expires.
+ */
+struct mdns_watch_entry {
+	struct mdns_watch_entry *next;
+	time_t expires;                      /**< monotonic seconds */
+	char model [WOL_DEVINFO_LEN];
+	char host [];                        /**< the host name, NUL terminated */
+};
+
+/**
+ * The listener. The index is a chained hash table keyed by the host name,
+ * ignoring case. The thread takes the write lock to update it, and lookups
+ * the read lock.
+ */
+struct mdns_watch {
+	pthread_rwlock_t lock;
+	struct mdns_watch_entry *buckets [MDNS_WATCH_BUCKETS];
+	unsigned int count;                  /**< entries in the index */
+	unsigned int capacity;               /**< the most entries held */
+	int fd;                              /**< the socket bound to the mDNS port */
+	int stopPipe [2];                    /**< written to stop the thread */
+	pthread_t thread;
+	wol_mdns_watch_stats stats;          /**< under the lock */
+};
+
+/** The running listener, or NULL. */
+static struct mdns_watch *mwatch;
+
+/** Serializes start and stop, and guards mwatch for lookups. */
+static pthread_mutex_t mwatchLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Function to read the monotonic clock in seconds.
+ */
+static time_t mdns_watch_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec);
+}
+
+
+/**
+ * Function to hash a host name, ignoring case.
+ *
+ * @param host - the host name
+ * @param len - the length of the host name
+ *
+ * @return the bucket
+ */
+static unsigned int mdns_watch_hash (const char *host, size_t len)
+{
+	unsigned int h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)tolower ((unsigned char)host [i])) * 16777619u;
+	}
+	return (h & (MDNS_WATCH_BUCKETS - 1));
+}
+
+
+/**
+ * Function to find the link pointing at a host's entry, or at the end of its
+ * chain. Called with the lock held.
+ */
+static struct mdns_watch_entry **mdns_watch_find (struct mdns_watch *w, const char *host, size_t len)
+{
+	struct mdns_watch_entry **link = &w->buckets [mdns_watch_hash (host, len)];
+
+	while (*link != NULL && (strlen ((*link)->host) != len || strncasecmp ((*link)->host, host, len) != 0)) {
+		link = &(*link)->next;
+	}
+	return (link);
+}
+
+
+/**
+ * Callback for mdns_parse(). Indexes each device information TXT record with
+ * a model, and drops the hosts that say goodbye with a zero TTL.
+ */
+static int mdns_watch_rr (void *arg, const char *name, unsigned short type,
+						  unsigned int ttl, const unsigned char *rdata, int rdLen)
+{
+	struct mdns_watch *w = arg;
+	struct mdns_watch_entry **link, *e;
+	char model [WOL_DEVINFO_LEN];
+	int hostLen;
+
+	if (type != DNS_TYPE_TXT) {
+		return (0);
+	}
+
+	/**
+     * The record name is "host._device-info._tcp.local". Split off the host part.
+     */
+	hostLen = (int)strlen (name) - (int)strlen (MDNS_DEVICE_INFO) - 1;
+	if (hostLen <= 0 || name [hostLen] != '.' || strcasecmp (name + hostLen + 1, MDNS_DEVICE_INFO) != 0) {
+		return (0);
+	}
+	if (ttl != 0 && mdns_txt_model (rdata, rdLen, model, sizeof (model)) != 0) {
+		return (0);
+	}
+
+	pthread_rwlock_wrlock (&w->lock);
+	w->stats.records++;
+	link = mdns_watch_find (w, name, hostLen);
+	if (ttl == 0) {
+		w->stats.goodbyes++;
+		if ((e = *link) != NULL) {
+			*link = e->next;
+			free (e);
+			w->count--;
+		}
+	}
+	else {
+		if ((e = *link) == NULL) {
+			if (w->count >= w->capacity || (e = malloc (sizeof (*e) + hostLen + 1)) == NULL) {
+				w->stats.full++;
+				pthread_rwlock_unlock (&w->lock);
+				return (0);
+			}
+			memcpy (e->host, name, hostLen);
+			e->host [hostLen] = '\0';
+			e->next = NULL;
+			*link = e;
+			w->count++;
+		}
+		strcpy (e->model, model);
+		e->expires = mdns_watch_now () + ttl;
+	}
+	pthread_rwlock_unlock (&w->lock);
+
+	return (0);
+}
+
+
+/**
+ * Function to drop the entries whose TTL has run out.
+ */
+static void mdns_watch_purge (struct mdns_watch *w)
+{
+	time_t now = mdns_watch_now ();
+	int i;
+
+	pthread_rwlock_wrlock (&w->lock);
+	for (i = 0; i < MDNS_WATCH_BUCKETS; i++) {
+		struct mdns_watch_entry **link = &w->buckets [i];
+
+		while (*link != NULL) {
+			struct mdns_watch_entry *e = *link;
+
+			if (e->expires <= now) {
+				*link = e->next;
+				free (e);
+				w->count--;
+				w->stats.expired++;
+			}
+			else {
+				link = &e->next;
+			}
+		}
+	}
+	pthread_rwlock_unlock (&w->lock);
+}
+
+
+/**
+ * The listener thread. Parses every mDNS message received until stopped, and
+ * drops the expired entries once a second.
+ */
+static void *mdns_watch_thread (void *arg)
+{
+	struct mdns_watch *w = arg;
+	struct pollfd pfd [2];
+	unsigned char buf [9000];
+	time_t lastPurge = mdns_watch_now ();
+
+	pfd [0].fd = w->fd;
+	pfd [0].events = POLLIN;
+	pfd [1].fd = w->stopPipe [0];
+	pfd [1].events = POLLIN;
+
+	for (;;) {
+		ssize_t len;
+		int ready = poll (pfd, 2, MDNS_WATCH_PURGE_MS);
+
+		if (ready < 0 && errno != EINTR) {
+			break;
+		}
+		if (ready > 0 && pfd [1].revents) {
+			break;
+		}
+		if (ready > 0 && pfd [0].revents) {
+			while ((len = recv (w->fd, (char *)buf, sizeof (buf), MSG_DONTWAIT)) > 0) {
+				pthread_rwlock_wrlock (&w->lock);
+				w->stats.packets++;
+				pthread_rwlock_unlock (&w->lock);
+				if (mdns_parse (buf, (int)len, mdns_watch_rr, w) < 0) {
+					pthread_rwlock_wrlock (&w->lock);
+					w->stats.malformed++;
+					pthread_rwlock_unlock (&w->lock);
+				}
+			}
+		}
+		if (mdns_watch_now () != lastPurge) {
+			mdns_watch_purge (w);
+			lastPurge = mdns_watch_now ();
+		}
+	}
+
+	return (NULL);
+}
+
+
+/**
+ * Function to release a listener's resources.
+ */
+static void mdns_watch_free (struct mdns_watch *w)
+{
+	int i;
+
+	for (i = 0; i < MDNS_WATCH_BUCKETS; i++) {
+		while (w->buckets [i] != NULL) {
+			struct mdns_watch_entry *e = w->buckets [i];
+
+			w->buckets [i] = e->next;
+			free (e);
+		}
+	}
+	if (w->fd >= 0) {
+		close (w->fd);
+	}
+	if (w->stopPipe [0] >= 0) {
+		close (w->stopPipe [0]);
+		close (w->stopPipe [1]);
+	}
+	pthread_rwlock_destroy (&w->lock);
+	free (w);
+}
+
+
+/**
+ * Function to start the passive mDNS listener. It shares the mDNS port with
+ * the system responder, joins the group, and indexes the device models heard
+ * until wol_mdns_watch_stop(). The index holds each model for its record's
+ * TTL.
+ *
+ * @param ifAddr - the IPv4 address of the interface to join the group on, NULL or "" for the default
+ * @param capacity - the most hosts held, 0 for the default 4096. Hosts beyond it are counted, not kept.
+ *
+ * @return 0 on success, or -1 with errno set. EBUSY if already running.
+ */
+int wol_mdns_watch_start (const char *ifAddr, int capacity)
+{
+	struct mdns_watch *w;
+	struct sockaddr_in sin;
+	struct ip_mreq mreq;
+	int optval = 1;
+
+	memset (&mreq, 0, sizeof (mreq));
+	inet_pton (AF_INET, MDNS_GROUP, &mreq.imr_multiaddr);
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	if (ifAddr != NULL && strcmp (ifAddr, "") != 0 && inet_pton (AF_INET, ifAddr, &mreq.imr_interface) != 1) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	pthread_mutex_lock (&mwatchLock);
+	if (mwatch != NULL) {
+		pthread_mutex_unlock (&mwatchLock);
+		errno = EBUSY;
+		return (-1);
+	}
+	if ((w = calloc (1, sizeof (struct mdns_watch))) == NULL) {
+		pthread_mutex_unlock (&mwatchLock);
+		return (-1);
+	}
+	w->fd = w->stopPipe [0] = w->stopPipe [1] = -1;
+	w->capacity = capacity > 0 ? capacity : MDNS_WATCH_DEF_CAPACITY;
+	pthread_rwlock_init (&w->lock, NULL);
+
+	/**
+     * Share the port with the system mDNS responder, and anyone else
+     * listening.
+     */
+	if (pipe (w->stopPipe) < 0 || (w->fd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+		goto fail;
+	}
+	setsockopt (w->fd, SOL_SOCKET, SO_REUSEADDR, (char *)&optval, sizeof (optval));
+#if defined(SO_REUSEPORT)
+	setsockopt (w->fd, SOL_SOCKET, SO_REUSEPORT, (char *)&optval, sizeof (optval));
+#endif
+	memset (&sin, 0, sizeof (sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(MDNS_PORT);
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind (w->fd, (struct sockaddr *)&sin, sizeof (sin)) < 0 ||
+		setsockopt (w->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *)&mreq, sizeof (mreq)) < 0) {
+		goto fail;
+	}
+
+	if ((errno = pthread_create (&w->thread, NULL, mdns_watch_thread, w)) != 0) {
+		goto fail;
+	}
+	mwatch = w;
+	pthread_mutex_unlock (&mwatchLock);
+
+	return (0);
+
+fail:
+	mdns_watch_free (w);
+	pthread_mutex_unlock (&mwatchLock);
+	return (-1);
+}
+
+
+/**
+ * Function to stop the passive mDNS listener, and release the index.
+ */
+void wol_mdns_watch_stop (void)
+{
+	struct mdns_watch *w;
+	char stop = 1;
+
+	pthread_mutex_lock (&mwatchLock);
+	if ((w = mwatch) != NULL) {
+		mwatch = NULL;
+
+		/**
+         * Without the stop signal the thread is still running on the index,
+         * so it is left allocated rather than freed under the thread.
+         */
+		while (write (w->stopPipe [1], &stop, 1) != 1) {
+			if (errno != EINTR) {
+				pthread_mutex_unlock (&mwatchLock);
+				return;
+			}
+		}
+		pthread_join (w->thread, NULL);
+
+		/** Wait out the lookups that already hold the read lock. */
+		pthread_rwlock_wrlock (&w->lock);
+		pthread_rwlock_unlock (&w->lock);
+		mdns_watch_free (w);
+	}
+	pthread_mutex_unlock (&mwatchLock);
+}
+
+
+/**
+ * Function to look up the model announced by a host.
+ *
+ * @param host - the host name, without the ".local" domain
+ * @param model - populated with the model identifier
+ * @param modelLen - the size of the model buffer, WOL_DEVINFO_LEN is enough
+ *
+ * @return 0 if found, 1 if not heard or expired, or -1 if the listener is not running
+ */
+int wol_mdns_watch_lookup (const char *host, char *model, size_t modelLen)
+{
+	struct mdns_watch_entry *e;
+	struct mdns_watch *w;
+	int rc = 1;
+
+	/**
+     * Readers hold the start and stop lock only long enough to take the
+     * index's read lock, so stop cannot free the index under them.
+     */
+	pthread_mutex_lock (&mwatchLock);
+	if ((w = mwatch) == NULL) {
+		pthread_mutex_unlock (&mwatchLock);
+		return (-1);
+	}
+	pthread_rwlock_rdlock (&w->lock);
+	pthread_mutex_unlock (&mwatchLock);
+
+	e = *mdns_watch_find (w, host, strlen (host));
+	if (e != NULL && e->expires > mdns_watch_now () && strlen (e->model) < modelLen) {
+		strcpy (model, e->model);
+		rc = 0;
+	}
+	pthread_rwlock_unlock (&w->lock);
+
+	return (rc);
+}
+
+
+/**
+ * Function to read the passive mDNS listener's totals.
+ *
+ * @param stats - populated with the totals, all zero if the listener is not running
+ *
+ * @return 0 on success, or -1 if the listener is not running
+ */
+int wol_mdns_watch_get_stats (wol_mdns_watch_stats *stats)
+{
+	struct mdns_watch *w;
+
+	memset (stats, 0, sizeof (*stats));
+	pthread_mutex_lock (&mwatchLock);
+	if ((w = mwatch) == NULL) {
+		pthread_mutex_unlock (&mwatchLock);
+		return (-1);
+	}
+	pthread_rwlock_rdlock (&w->lock);
+	*stats = w->stats;
+	stats->hosts = w->count;
+	pthread_rwlock_unlock (&w->lock);
+	pthread_mutex_unlock (&mwatchLock);
+
+	return (0);
+}
@@ -0,0 +1,502 @@
+/**
+ * @file neigh.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Reads the kernel neighbor (ARP) table, and indexes it by IP address.
+ * @details The neighbor table is fetched once with an rtnetlink RTM_GETNEIGH dump,
+ * or from <code>/proc/net/arp</code> if netlink is unavailable, and is loaded into
+ * an IP to MAC address hash index. Lookups are answered from that snapshot
+ * without invoking the "arp" command. Only available on Linux.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "neigh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#if defined(__linux__)
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+#endif
+
+#define NO_MAC_FOUND  "no MAC found"
+
+
+/**
+ * Function to hash an IPv4 address to a slot of the index.
+ *
+ * @param ip - the IPv4 address
+ * @param mask - the number of slots minus one
+ *
+ * @return the first slot to probe
+ */
+static unsigned int neigh_hash (uint32_t ip, unsigned int mask)
+{
+	uint32_t h = ip * 0x9e3779b1u;
+	
+	return (h ^ (h >> 16)) & mask;
+}
+
+
+/**
+ * Function to create an empty IP to MAC address index.
+ *
+ * @param sizeHint - the expected number of entries, or 0
+ *
+ * @return the new index, or NULL on failure to allocate
+ */
+wol_neigh_table *neigh_table_new (unsigned int sizeHint)
+{
+	wol_neigh_table *table;
+	unsigned int slots = 64;
+	
+	while (slots < sizeHint * 2) {
+		slots <<= 1;
+	}
+	
+	if ((table = calloc (1, sizeof (wol_neigh_table))) == NULL) {
+		return (NULL);
+	}
+	if ((table->slots = calloc (slots, sizeof (struct wol_neigh_entry))) == NULL) {
+		free (table);
+		return (NULL);
+	}
+	table->mask = slots - 1;
+	
+	return (table);
+}
+
+
+/**
+ * Function to double the number of slots of the index, and re-insert
+ * the entries.
+ *
+ * @param table - the index to grow
+ *
+ * @return 0 on success, -1 on failure to allocate
+ */
+static int neigh_table_grow (wol_neigh_table *table)
+{
+	struct wol_neigh_entry *old = table->slots;
+	unsigned int i, oldSlots = table->mask + 1;
+	unsigned int mask = oldSlots * 2 - 1;
+	
+	if ((table->slots = calloc (mask + 1, sizeof (struct wol_neigh_entry))) == NULL) {
+		table->slots = old;
+		return (-1);
+	}
+	table->mask = mask;
+	
+	for (i = 0; i < oldSlots; i++) {
+		if (old [i].used) {
+			unsigned int slot = neigh_hash (old [i].ip, mask);
+			
+			while (table->slots [slot].used) {
+				slot = (slot + 1) & mask;
+			}
+			table->slots [slot] = old [i];
+		}
+	}
+	free (old);
+	
+	return (0);
+}
+
+
+/**
+ * Function to add or replace the MAC address of an IPv4 address in the index.
+ *
+ * @param table - the index
+ * @param ip - the IPv4 address, network byte order
+ * @param mac - the hardware address
+ *
+ * @return 0 on success, -1 on failure to allocate
+ */
+int neigh_table_insert (wol_neigh_table *table, uint32_t ip, wol_mac mac)
+{
+	unsigned int slot;
+	
+	/**
+     * Keep the load factor at or below one half, so probe sequences stay short.
+     */
+	if ((table->count + 1) * 2 > table->mask + 1) {
+		if (neigh_table_grow (table) < 0) {
+			return (-1);
+		}
+	}
+	
+	slot = neigh_hash (ip, table->mask);
+	while (table->slots [slot].used && table->slots [slot].ip != ip) {
+		slot = (slot + 1) & table->mask;
+	}
+	if (!table->slots [slot].used) {
+		table->slots [slot].used = 1;
+		table->slots [slot].ip = ip;
+		table->count++;
+	}
+	table->slots [slot].mac = mac;
+	
+	return (0);
+}
+
+
+/**
+ * Function to find the MAC address of an IPv4 address in the index.
+ *
+ * @param table - the index
+ * @param ip - the IPv4 address, network byte order
+ * @param mac - populated with the hardware address
+ *
+ * @return 0 if found, -1 if not found
+ */
+int neigh_table_find (const wol_neigh_table *table, uint32_t ip, wol_mac *mac)
+{
+	unsigned int slot = neigh_hash (ip, table->mask);
+	
+	while (table->slots [slot].used) {
+		if (table->slots [slot].ip == ip) {
+			*mac = table->slots [slot].mac;
+			return (0);
+		}
+		slot = (slot + 1) & table->mask;
+	}
+	return (-1);
+}
+
+
+#if defined(__linux__)
+
+/**
+ * Function to load the neighbor table with an rtnetlink RTM_GETNEIGH dump.
+ * Incomplete and failed entries are skipped.
+ *
+ * @param table - the index to populate
+ *
+ * @return 0 on success, -1 if the dump could not be read
+ */
+static int neigh_load_netlink (wol_neigh_table *table)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct ndmsg ndm;
+	} req;
+	struct sockaddr_nl sanl;
+	char buf [16384];
+	int fd, done = 0;
+	
+	if ((fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0) {
+		return (-1);
+	}
+	
+	memset (&req, 0, sizeof (req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof (struct ndmsg));
+	req.nlh.nlmsg_type = RTM_GETNEIGH;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nlh.nlmsg_seq = 1;
+	req.ndm.ndm_family = AF_INET;
+	
+	memset (&sanl, 0, sizeof (sanl));
+	sanl.nl_family = AF_NETLINK;
+	
+	if (sendto (fd, &req, req.nlh.nlmsg_len, 0, (struct sockaddr *)&sanl, sizeof (sanl)) < 0) {
+		close (fd);
+		return (-1);
+	}
+	
+	/**
+     * Read the dump until the NLMSG_DONE message. Each RTM_NEWNEIGH message
+     * carries the IP address in NDA_DST, and the MAC address in NDA_LLADDR.
+     */
+	while (!done) {
+		struct nlmsghdr *nlh;
+		ssize_t len = recv (fd, buf, sizeof (buf), 0);
+		
+		if (len < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			close (fd);
+			return (-1);
+		}
+		
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+			struct ndmsg *ndm;
+			struct rtattr *rta;
+			int rtaLen;
+			uint32_t ip = 0;
+			const unsigned char *mac = NULL;
+			
+			if (nlh->nlmsg_type == NLMSG_DONE) {
+				done = 1;
+				break;
+			}
+			if (nlh->nlmsg_type == NLMSG_ERROR) {
+				close (fd);
+				return (-1);
+			}
+			if (nlh->nlmsg_type != RTM_NEWNEIGH) {
+				continue;
+			}
+			
+			ndm = NLMSG_DATA(nlh);
+			if (ndm->ndm_family != AF_INET || (ndm->ndm_state & (NUD_INCOMPLETE | NUD_FAILED))) {
+				continue;
+			}
+			
+			rtaLen = nlh->nlmsg_len - NLMSG_LENGTH(sizeof (struct ndmsg));
+			for (rta = (struct rtattr *)((char *)ndm + NLMSG_ALIGN(sizeof (struct ndmsg)));
+				 RTA_OK(rta, rtaLen); rta = RTA_NEXT(rta, rtaLen)) {
+				if (rta->rta_type == NDA_DST && RTA_PAYLOAD(rta) == 4) {
+					memcpy (&ip, RTA_DATA(rta), 4);
+				}
+				else if (rta->rta_type == NDA_LLADDR && RTA_PAYLOAD(rta) == 6) {
+					mac = RTA_DATA(rta);
+				}
+			}
+			
+			if (ip != 0 && mac != NULL && neigh_table_insert (table, ip, wol_mac_from_bytes (mac)) < 0) {
+				close (fd);
+				return (-1);
+			}
+		}
+	}
+	
+	close (fd);
+	return (0);
+}
+
+
+/**
+ * Function to load the neighbor table from <code>/proc/net/arp</code>.
+ * Entries without the complete flag are skipped.
+ *
+ * @param table - the index to populate
+ *
+ * @return 0 on success, -1 if the file could not be read
+ */
+static int neigh_load_proc (wol_neigh_table *table)
+{
+	FILE *in;
+	char buff [512];
+	
+	if ((in = fopen ("/proc/net/arp", "r")) == NULL) {
+		return (-1);
+	}
+	
+	/** Skip the column heading line. */
+	if (fgets (buff, sizeof (buff), in) == NULL) {
+		fclose (in);
+		return (-1);
+	}
+	
+	while (fgets (buff, sizeof (buff), in) != NULL) {
+		char ipStr [64], macStr [64];
+		unsigned int flags;
+		struct in_addr ip;
+		wol_mac mac;
+		
+		if (sscanf (buff, "%63s %*s %x %63s", ipStr, &flags, macStr) != 3) {
+			continue;
+		}
+		if (!(flags & 0x2) || inet_pton (AF_INET, ipStr, &ip) != 1 || wol_mac_parse (macStr, &mac) < 0) {
+			continue;
+		}
+		if (neigh_table_insert (table, ip.s_addr, mac) < 0) {
+			fclose (in);
+			return (-1);
+		}
+	}
+	
+	fclose (in);
+	return (0);
+}
+
+#endif /* __linux__ */
+
+
+/**
+ * Function to fetch a snapshot of the kernel neighbor table. Uses an rtnetlink
+ * dump, with a fallback to <code>/proc/net/arp</code>.
+ *
+ * @return the snapshot, or NULL on failure. Free with neighTableFree().
+ */
+wol_neigh_table *neighTableLoad(void)
+{
+#if defined(__linux__)
+	wol_neigh_table *table;
+	
+	if ((table = neigh_table_new (0)) == NULL) {
+		return (NULL);
+	}
+	if (neigh_load_netlink (table) == 0) {
+		return (table);
+	}
+	
+	/**
+     * The dump failed part way, so start over with an empty index.
+     */
+	neighTableFree (table);
+	if ((table = neigh_table_new (0)) == NULL) {
+		return (NULL);
+	}
+	if (neigh_load_proc (table) == 0) {
+		return (table);
+	}
+	neighTableFree (table);
+#else
+	errno = ENOSYS;
+#endif
+	return (NULL);
+}
+
+
+/**
+ * Function to release a neighbor table snapshot.
+ *
+ * @param table - the snapshot to release, may be NULL
+ */
+void neighTableFree(wol_neigh_table *table)
+{
+	if (table == NULL) {
+		return;
+	}
+	free (table->slots);
+	free (table);
+}
+
+
+/**
+ * Retrieves the MAC address for the specified IP address from a neighbor
+ * table snapshot. The MAC address is written as six two hex digit octets
+ * separated by colons.
+ *
+ * @param table - the neighbor table snapshot
+ * @param ipAddr - the IP address to retrieve the MAC address for.
+ * @param macAddr - a pointer to the buffer, at least 18 bytes, to write the MAC address into.
+ *
+ * @return the success or error of the lookup.
+ * @retval 0 - success
+ * @retval 1 - error, the IP address is invalid or not in the table. macAddr is set to "no MAC found".
+ */
+int neighTableLookup(wol_neigh_table *table, char *ipAddr, char *macAddr)
+{
+	struct in_addr ip;
+	wol_mac mac;
+	
+	if (inet_pton (AF_INET, ipAddr, &ip) != 1 || neigh_table_find (table, ip.s_addr, &mac) < 0) {
+		strcpy(macAddr, NO_MAC_FOUND);
+		return 1;
+	}
+	
+	wol_mac_format (mac, WOL_MAC_LOWER, macAddr, WOL_MAC_STRLEN);
+	return 0;
+}
+
+
+/**
+ * Retrieves the MAC addresses for a batch of IP addresses. The lookups are
+ * answered by the neighbor watcher when it is running, and otherwise the
+ * neighbor table is fetched once, and every lookup is answered from that
+ * snapshot.
+ *
+ * @param ipAddrs - the IP addresses to retrieve the MAC addresses for.
+ * @param count - the number of IP addresses
+ * @param macAddrs - the buffers, at least 18 bytes each, to write the MAC addresses into.
+ * @param status - populated with the result of each lookup, as for neighTableLookup()
+ *
+ * @return the number of MAC addresses found, or -1 if the neighbor table could not be read
+ */
+int macForIPBulk(char **ipAddrs, int count, char **macAddrs, int *status)
+{
+	wol_neigh_table *table = NULL;
+	int i, found = 0;
+	
+	for (i = 0; i < count; i++) {
+		struct in_addr ip;
+		wol_mac mac;
+		int rc = -1;
+		
+		if (inet_pton (AF_INET, ipAddrs [i], &ip) == 1 && (rc = wol_neigh_watch_lookup (ip.s_addr, &mac)) == 0) {
+			status [i] = 0;
+			wol_mac_format (mac, WOL_MAC_LOWER, macAddrs [i], WOL_MAC_STRLEN);
+		}
+		else if (rc > 0) {
+			status [i] = 1;
+			strcpy (macAddrs [i], NO_MAC_FOUND);
+		}
+		else {
+			if (table == NULL && (table = neighTableLoad ()) == NULL) {
+				return (-1);
+			}
+			status [i] = neighTableLookup (table, ipAddrs [i], macAddrs [i]);
+		}
+		if (status [i] == 0) {
+			found++;
+		}
+	}
+	
+	neighTableFree (table);
+	
+	return (found);
+}
+
+
+/**
+ * Function to count the entries of a neighbor table snapshot.
+ *
+ * @param table - the snapshot
+ *
+ * @return the number of IP addresses with a MAC address
+ */
+int neighTableCount(const wol_neigh_table *table)
+{
+	return ((int)table->count);
+}
+
+
+/**
+ * Function to walk the entries of a neighbor table snapshot, in no
+ * particular order.
+ *
+ * @param table - the snapshot
+ * @param cb - called with each IP address, network byte order, and its MAC address
+ * @param arg - passed to the callback
+ *
+ * @return 0 if every entry was visited, or the nonzero value that stopped the walk
+ */
+int neighTableForeach(const wol_neigh_table *table, wol_neigh_cb cb, void *arg)
+{
+	unsigned int i;
+	int rc;
+	
+	for (i = 0; i <= table->mask; i++) {
+		if (table->slots [i].used && (rc = cb (arg, table->slots [i].ip, table->slots [i].mac)) != 0) {
+			return (rc);
+		}
+	}
+	return (0);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file neigh.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for neigh.c
+ * @details Provides the in-memory IP to MAC address hash index, and the function
+ * prototypes used by the library to populate and search it.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef NEIGH_H
+#define NEIGH_H
+
+#include "wol_lib.h"
+
+#include <stdint.h>
+
+/**
+ * One slot of the IP to MAC address index. The IPv4 address is kept in
+ * network byte order.
+ */
+struct wol_neigh_entry {
+	wol_mac mac;              /**< the hardware address */
+	uint32_t ip;              /**< the IPv4 address, network byte order */
+	uint32_t used;            /**< 1 if the slot is occupied */
+};
+
+/**
+ * The IP to MAC address index, an open addressing hash table with linear
+ * probing. The number of slots is always a power of two.
+ */
+struct wol_neigh_table {
+	struct wol_neigh_entry *slots;   /**< the hash table slots */
+	unsigned int mask;               /**< the number of slots minus one */
+	unsigned int count;              /**< the number of occupied slots */
+};
+
+wol_neigh_table *neigh_table_new (unsigned int sizeHint);
+int neigh_table_insert (wol_neigh_table *table, uint32_t ip, wol_mac mac);
+int neigh_table_find (const wol_neigh_table *table, uint32_t ip, wol_mac *mac);
+
+#endif /* NEIGH_H */
@@ -0,0 +1,609 @@
+/**
+ * @file neigh_watch.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Keeps a live copy of the kernel neighbor (ARP) table.
+ * @details A background thread loads the neighbor table once, subscribes to
+ * the rtnetlink RTNLGRP_NEIGH group, and applies each RTM_NEWNEIGH and
+ * RTM_DELNEIGH event to an IP to MAC address map as it arrives. Readers look
+ * up the map under a sequence lock: they never block on the thread, and retry
+ * the rare lookup that overlapped an update. While the watcher runs,
+ * macForIP() is answered from the map. Only available on Linux.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "neigh.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+
+#define WATCH_DEF_CAPACITY  4096
+#define WATCH_RCVBUF        (1 << 20)
+#define WATCH_STRIPES       16          /**< reader count stripes, a power of two */
+
+
+/**
+ * The live map. An open addressing hash table with linear probing and
+ * backward-shift deletion, with a fixed number of slots, so readers never
+ * see it move. The slots are only written by the watcher thread, inside a
+ * sequence lock write section. Readers load them with relaxed atomics, and
+ * retry if the sequence changed, or was odd, meaning a write was underway.
+ */
+struct neigh_watch {
+	struct wol_neigh_entry *slots;   /**< the hash table slots */
+	unsigned int mask;               /**< the number of slots minus one */
+	unsigned int count;              /**< the number of occupied slots */
+	unsigned int capacity;           /**< the most entries held, half the slots */
+	unsigned int seq;                /**< the sequence lock, odd while writing */
+	int nlFd;                        /**< the subscribed netlink socket */
+	int stopFd;                      /**< an eventfd, to stop the thread */
+	pthread_t thread;
+	wol_neigh_watch_stats stats;     /**< updated by the thread, read with relaxed loads */
+};
+
+/** The running watcher, or NULL. Read only between watch_enter() and watch_leave(). */
+static struct neigh_watch *watch;
+
+/**
+ * The lookups in progress, per epoch, striped by thread so readers do not
+ * contend for one cache line. Stop moves readers to the other epoch, then
+ * waits for the old one to drain before freeing the map, so a steady stream
+ * of new lookups cannot hold it off.
+ */
+static struct {
+	unsigned int readers;
+	char pad [64 - sizeof (unsigned int)];
+} watchReaders [2][WATCH_STRIPES] __attribute__((aligned(64)));
+
+/** The epoch new readers count themselves in, 0 or 1. */
+static unsigned int watchEpoch;
+
+/** Serializes start and stop. */
+static pthread_mutex_t watchLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Function to hash an IPv4 address to a slot, as in neigh.c.
+ */
+static unsigned int watch_hash (uint32_t ip, unsigned int mask)
+{
+	uint32_t h = ip * 0x9e3779b1u;
+
+	return (h ^ (h >> 16)) & mask;
+}
+
+
+/**
+ * Functions to enter and leave a read of the running watcher. A reader is
+ * counted before it loads the pointer, and stop clears the pointer before
+ * it reads the counts, all sequentially consistent, so stop either sees
+ * the reader or the reader sees NULL. A reader that stalls between loading
+ * the epoch and counting itself may count in an epoch that has since been
+ * drained, so it rereads the epoch after counting and moves if it changed.
+ *
+ * @param slot - populated with the reader's count, to pass to watch_leave()
+ *
+ * @return the watcher, or NULL if not running
+ */
+static struct neigh_watch *watch_enter (unsigned int **slot)
+{
+	uint64_t h = (uint64_t)(uintptr_t)pthread_self () * 0x9e3779b97f4a7c15ull;
+	unsigned int stripe = (unsigned int)(h >> 32) & (WATCH_STRIPES - 1);
+	unsigned int epoch = __atomic_load_n (&watchEpoch, __ATOMIC_SEQ_CST);
+	unsigned int now;
+	struct neigh_watch *w;
+
+	for (;;) {
+		*slot = &watchReaders [epoch][stripe].readers;
+		__atomic_add_fetch (*slot, 1, __ATOMIC_SEQ_CST);
+		if ((now = __atomic_load_n (&watchEpoch, __ATOMIC_SEQ_CST)) == epoch) {
+			break;
+		}
+		__atomic_sub_fetch (*slot, 1, __ATOMIC_RELEASE);
+		epoch = now;
+	}
+	if ((w = __atomic_load_n (&watch, __ATOMIC_SEQ_CST)) == NULL) {
+		__atomic_sub_fetch (*slot, 1, __ATOMIC_RELEASE);
+	}
+	return (w);
+}
+
+static void watch_leave (unsigned int *slot)
+{
+	__atomic_sub_fetch (slot, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Functions to open and close a sequence lock write section. Only the
+ * watcher thread writes, so there is no writer to exclude.
+ */
+static void watch_write_begin (struct neigh_watch *w)
+{
+	__atomic_store_n (&w->seq, w->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static void watch_write_end (struct neigh_watch *w)
+{
+	__atomic_store_n (&w->seq, w->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Function to store a slot, for the readers' relaxed loads.
+ */
+static void watch_slot_store (struct wol_neigh_entry *slot, uint32_t ip, wol_mac mac, uint32_t used)
+{
+	__atomic_store_n (&slot->ip, ip, __ATOMIC_RELAXED);
+	__atomic_store_n (&slot->mac, mac, __ATOMIC_RELAXED);
+	__atomic_store_n (&slot->used, used, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * Function to add or replace the MAC address of an IPv4 address. Called
+ * inside a write section.
+ *
+ * @return 0 on success, -1 if the map is full
+ */
+static int watch_insert (struct neigh_watch *w, uint32_t ip, wol_mac mac)
+{
+	unsigned int slot = watch_hash (ip, w->mask);
+
+	while (w->slots [slot].used && w->slots [slot].ip != ip) {
+		slot = (slot + 1) & w->mask;
+	}
+	if (!w->slots [slot].used) {
+		if (w->count >= w->capacity) {
+			return (-1);
+		}
+		__atomic_store_n (&w->count, w->count + 1, __ATOMIC_RELAXED);
+	}
+	else if (w->slots [slot].mac == mac) {
+		return (0);
+	}
+	watch_slot_store (&w->slots [slot], ip, mac, 1);
+
+	return (0);
+}
+
+
+/**
+ * Function to remove an IPv4 address. The entries after it in its probe
+ * sequence are shifted back, so lookups need no tombstones. Called inside a
+ * write section.
+ *
+ * @return 0 if removed, -1 if not present
+ */
+static int watch_remove (struct neigh_watch *w, uint32_t ip)
+{
+	unsigned int slot = watch_hash (ip, w->mask), next;
+
+	while (w->slots [slot].used && w->slots [slot].ip != ip) {
+		slot = (slot + 1) & w->mask;
+	}
+	if (!w->slots [slot].used) {
+		return (-1);
+	}
+
+	for (next = (slot + 1) & w->mask; w->slots [next].used; next = (next + 1) & w->mask) {
+		unsigned int home = watch_hash (w->slots [next].ip, w->mask);
+
+		/**
+         * An entry moves back into the hole unless its home slot lies
+         * cyclically after the hole, and at or before its own slot.
+         */
+		if (((next - home) & w->mask) >= ((next - slot) & w->mask)) {
+			watch_slot_store (&w->slots [slot], w->slots [next].ip, w->slots [next].mac, 1);
+			slot = next;
+		}
+	}
+	watch_slot_store (&w->slots [slot], 0, 0, 0);
+	__atomic_store_n (&w->count, w->count - 1, __ATOMIC_RELAXED);
+
+	return (0);
+}
+
+
+/**
+ * Callback to copy a snapshot entry into the map.
+ */
+static int watch_load_entry (void *arg, uint32_t ip, wol_mac mac)
+{
+	struct neigh_watch *w = arg;
+
+	if (watch_insert (w, ip, mac) < 0) {
+		__atomic_add_fetch (&w->stats.full, 1, __ATOMIC_RELAXED);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to replace the map's contents with a fresh snapshot of the
+ * neighbor table. Events queued on the subscribed socket are applied after,
+ * in order, so the map ends up current.
+ *
+ * @return 0 on success, -1 if the table could not be read
+ */
+static int watch_resync (struct neigh_watch *w)
+{
+	wol_neigh_table *table;
+	unsigned int i;
+
+	if ((table = neighTableLoad ()) == NULL) {
+		return (-1);
+	}
+	watch_write_begin (w);
+	for (i = 0; i <= w->mask; i++) {
+		watch_slot_store (&w->slots [i], 0, 0, 0);
+	}
+	__atomic_store_n (&w->count, 0, __ATOMIC_RELAXED);
+	neighTableForeach (table, watch_load_entry, w);
+	watch_write_end (w);
+	neighTableFree (table);
+	__atomic_add_fetch (&w->stats.resyncs, 1, __ATOMIC_RELAXED);
+
+	return (0);
+}
+
+
+/**
+ * Function to apply one neighbor event to the map. Incomplete and failed
+ * entries are removed, as they are skipped by neighTableLoad().
+ */
+static void watch_apply (struct neigh_watch *w, struct nlmsghdr *nlh)
+{
+	struct ndmsg *ndm = NLMSG_DATA(nlh);
+	struct rtattr *rta;
+	int rtaLen, removed;
+	uint32_t ip = 0;
+	const unsigned char *mac = NULL;
+
+	if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof (struct ndmsg)) || ndm->ndm_family != AF_INET) {
+		return;
+	}
+	rtaLen = nlh->nlmsg_len - NLMSG_LENGTH(sizeof (struct ndmsg));
+	for (rta = (struct rtattr *)((char *)ndm + NLMSG_ALIGN(sizeof (struct ndmsg)));
+		 RTA_OK(rta, rtaLen); rta = RTA_NEXT(rta, rtaLen)) {
+		if (rta->rta_type == NDA_DST && RTA_PAYLOAD(rta) == 4) {
+			memcpy (&ip, RTA_DATA(rta), 4);
+		}
+		else if (rta->rta_type == NDA_LLADDR && RTA_PAYLOAD(rta) == 6) {
+			mac = RTA_DATA(rta);
+		}
+	}
+	if (ip == 0) {
+		return;
+	}
+
+	__atomic_add_fetch (&w->stats.events, 1, __ATOMIC_RELAXED);
+	watch_write_begin (w);
+	if (nlh->nlmsg_type == RTM_NEWNEIGH && mac != NULL && !(ndm->ndm_state & (NUD_INCOMPLETE | NUD_FAILED))) {
+		if (watch_insert (w, ip, wol_mac_from_bytes (mac)) < 0) {
+			__atomic_add_fetch (&w->stats.full, 1, __ATOMIC_RELAXED);
+		}
+		removed = 0;
+	}
+	else {
+		removed = (watch_remove (w, ip) == 0);
+	}
+	watch_write_end (w);
+
+	if (removed) {
+		__atomic_add_fetch (&w->stats.removed, 1, __ATOMIC_RELAXED);
+	}
+}
+
+
+/**
+ * The watcher thread. Reads neighbor events until stopped. If the socket
+ * overflowed, events were lost, so the map is loaded again.
+ */
+static void *watch_thread (void *arg)
+{
+	struct neigh_watch *w = arg;
+	struct pollfd pfd [2];
+	char buf [16384];
+
+	pfd [0].fd = w->nlFd;
+	pfd [0].events = POLLIN;
+	pfd [1].fd = w->stopFd;
+	pfd [1].events = POLLIN;
+
+	for (;;) {
+		struct nlmsghdr *nlh;
+		ssize_t len;
+
+		if (poll (pfd, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (pfd [1].revents) {
+			break;
+		}
+
+		while ((len = recv (w->nlFd, buf, sizeof (buf), MSG_DONTWAIT)) > 0) {
+			for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+				if (nlh->nlmsg_type == RTM_NEWNEIGH || nlh->nlmsg_type == RTM_DELNEIGH) {
+					watch_apply (w, nlh);
+				}
+			}
+		}
+		if (len < 0 && errno == ENOBUFS) {
+			__atomic_add_fetch (&w->stats.overruns, 1, __ATOMIC_RELAXED);
+			watch_resync (w);
+		}
+	}
+
+	return (NULL);
+}
+
+
+/**
+ * Function to release a watcher's resources.
+ */
+static void watch_free (struct neigh_watch *w)
+{
+	if (w->nlFd >= 0) {
+		close (w->nlFd);
+	}
+	if (w->stopFd >= 0) {
+		close (w->stopFd);
+	}
+	free (w->slots);
+	free (w);
+}
+
+#endif /* __linux__ */
+
+
+/**
+ * Function to start the neighbor watcher. The neighbor table is loaded, and
+ * a background thread keeps it current from the kernel's neighbor events.
+ * Until wol_neigh_watch_stop(), macForIP() and macForIPBulk() are answered
+ * from it, without reading the table.
+ *
+ * @param capacity - the most entries held, 0 for the default 4096. Entries beyond it are dropped, and counted.
+ *
+ * @return 0 on success, or -1 with errno set. EBUSY if already running.
+ */
+int wol_neigh_watch_start (int capacity)
+{
+#if defined(__linux__)
+	struct neigh_watch *w;
+	struct sockaddr_nl sanl;
+	unsigned int slots = 64;
+	int rcvBuf = WATCH_RCVBUF;
+
+	pthread_mutex_lock (&watchLock);
+	if (watch != NULL) {
+		pthread_mutex_unlock (&watchLock);
+		errno = EBUSY;
+		return (-1);
+	}
+	if (capacity <= 0) {
+		capacity = WATCH_DEF_CAPACITY;
+	}
+	while (slots < (unsigned int)capacity * 2) {
+		slots <<= 1;
+	}
+
+	if ((w = calloc (1, sizeof (struct neigh_watch))) == NULL) {
+		pthread_mutex_unlock (&watchLock);
+		return (-1);
+	}
+	w->nlFd = w->stopFd = -1;
+	w->mask = slots - 1;
+	w->capacity = capacity;
+	if ((w->slots = calloc (slots, sizeof (struct wol_neigh_entry))) == NULL) {
+		goto fail;
+	}
+
+	/**
+     * Subscribe before loading the table, so no change falls between the two.
+     */
+	if ((w->nlFd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0 ||
+		(w->stopFd = eventfd (0, EFD_CLOEXEC)) < 0) {
+		goto fail;
+	}
+	setsockopt (w->nlFd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof (rcvBuf));
+	memset (&sanl, 0, sizeof (sanl));
+	sanl.nl_family = AF_NETLINK;
+	sanl.nl_groups = RTMGRP_NEIGH;
+	if (bind (w->nlFd, (struct sockaddr *)&sanl, sizeof (sanl)) < 0 || watch_resync (w) < 0) {
+		goto fail;
+	}
+	w->stats.resyncs = 0;
+
+	if ((errno = pthread_create (&w->thread, NULL, watch_thread, w)) != 0) {
+		goto fail;
+	}
+	__atomic_store_n (&watch, w, __ATOMIC_RELEASE);
+	pthread_mutex_unlock (&watchLock);
+
+	return (0);
+
+fail:
+	watch_free (w);
+	pthread_mutex_unlock (&watchLock);
+	return (-1);
+#else
+	(void)capacity;
+	errno = ENOSYS;
+	return (-1);
+#endif
+}
+
+
+/**
+ * Function to stop the neighbor watcher, and release the map once the lookups
+ * running in other threads have finished. macForIP() goes back to reading
+ * the table.
+ */
+void wol_neigh_watch_stop (void)
+{
+#if defined(__linux__)
+	struct neigh_watch *w;
+	uint64_t one = 1;
+
+	unsigned int epoch, i;
+
+	pthread_mutex_lock (&watchLock);
+	if ((w = watch) != NULL) {
+		__atomic_store_n (&watch, NULL, __ATOMIC_SEQ_CST);
+
+		/**
+         * Without the stop signal the thread is still running on the map,
+         * so it is left allocated rather than freed under the thread.
+         */
+		while (write (w->stopFd, &one, sizeof (one)) != sizeof (one)) {
+			if (errno != EINTR) {
+				pthread_mutex_unlock (&watchLock);
+				return;
+			}
+		}
+		pthread_join (w->thread, NULL);
+
+		/**
+         * Wait out the lookups that may have loaded the pointer before it
+         * was cleared. They counted themselves in the old epoch; later ones
+         * count in the new epoch, and see NULL.
+         */
+		epoch = __atomic_fetch_xor (&watchEpoch, 1, __ATOMIC_SEQ_CST);
+		for (i = 0; i < WATCH_STRIPES; i++) {
+			while (__atomic_load_n (&watchReaders [epoch][i].readers, __ATOMIC_SEQ_CST) != 0) {
+				sched_yield ();
+			}
+		}
+		watch_free (w);
+	}
+	pthread_mutex_unlock (&watchLock);
+#endif
+}
+
+
+/**
+ * Function to look up the MAC address of an IPv4 address in the live map.
+ * Never blocks: a lookup that overlaps an update is retried.
+ *
+ * @param ip - the IPv4 address, network byte order
+ * @param mac - populated with the hardware address
+ *
+ * @return 0 if found, 1 if not found, or -1 if the watcher is not running
+ */
+int wol_neigh_watch_lookup (uint32_t ip, wol_mac *mac)
+{
+#if defined(__linux__)
+	unsigned int *reader;
+	struct neigh_watch *w = watch_enter (&reader);
+	unsigned int seq, slot, probes;
+	wol_mac found;
+	int rc;
+
+	if (w == NULL) {
+		return (-1);
+	}
+
+	for (;;) {
+		seq = __atomic_load_n (&w->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			sched_yield ();
+			continue;
+		}
+
+		/**
+         * The probe is bounded, as a torn read may see a table with no
+         * free slot on the way.
+         */
+		rc = 1;
+		found = 0;
+		slot = watch_hash (ip, w->mask);
+		for (probes = 0; probes <= w->mask && __atomic_load_n (&w->slots [slot].used, __ATOMIC_RELAXED); probes++) {
+			if (__atomic_load_n (&w->slots [slot].ip, __ATOMIC_RELAXED) == ip) {
+				found = __atomic_load_n (&w->slots [slot].mac, __ATOMIC_RELAXED);
+				rc = 0;
+				break;
+			}
+			slot = (slot + 1) & w->mask;
+		}
+
+		__atomic_thread_fence (__ATOMIC_ACQUIRE);
+		if (__atomic_load_n (&w->seq, __ATOMIC_RELAXED) == seq) {
+			break;
+		}
+	}
+	watch_leave (reader);
+	if (rc == 0) {
+		*mac = found;
+	}
+	return (rc);
+#else
+	(void)ip;
+	(void)mac;
+	return (-1);
+#endif
+}
+
+
+/**
+ * Function to read the neighbor watcher's totals.
+ *
+ * @param stats - populated with the totals, all zero if the watcher is not running
+ *
+ * @return 0 on success, or -1 if the watcher is not running
+ */
+int wol_neigh_watch_get_stats (wol_neigh_watch_stats *stats)
+{
+	memset (stats, 0, sizeof (*stats));
+#if defined(__linux__)
+	unsigned int *reader;
+	struct neigh_watch *w = watch_enter (&reader);
+
+	if (w == NULL) {
+		return (-1);
+	}
+	stats->entries = __atomic_load_n (&w->count, __ATOMIC_RELAXED);
+	stats->events = __atomic_load_n (&w->stats.events, __ATOMIC_RELAXED);
+	stats->removed = __atomic_load_n (&w->stats.removed, __ATOMIC_RELAXED);
+	stats->full = __atomic_load_n (&w->stats.full, __ATOMIC_RELAXED);
+	stats->overruns = __atomic_load_n (&w->stats.overruns, __ATOMIC_RELAXED);
+	stats->resyncs = __atomic_load_n (&w->stats.resyncs, __ATOMIC_RELAXED);
+	watch_leave (reader);
+	return (0);
+#else
+	return (-1);
+#endif
+}
@@ -0,0 +1,169 @@
+/**
+ * @file wol_relayd.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Wake relay daemon, for waking hosts across subnets.
+ * @details Runs a wol_relay on a host in each VLAN: wake requests from
+ * anywhere are accepted on a UDP port and, optionally, a unix domain socket,
+ * and broadcast on the local subnets. See wol_relay.h for the request format.
+ * The daemon runs in the foreground; SIGUSR1 writes the totals to stderr, and
+ * SIGINT or SIGTERM stops it.
+ *
+ * Build on Linux from this directory:
+ *
+ *     gcc -std=gnu99 -O2 -pthread -I.. -o wol_relayd wol_relayd.c ../ *.c
+ *
+ * (without the space in the last glob). Usage:
+ *
+ *     wol_relayd [-b addr] [-p port] [-u path] [-t subnet]... [-w ms] [-o port]
+ *
+ *     -b addr    the address to accept requests on, all by default
+ *     -p port    the UDP port to accept requests on, 9009 by default, 0 for none
+ *     -u path    also accept requests on a unix domain datagram socket
+ *     -t subnet  a target subnet, e.g. 10.1.2.0/24; may be repeated
+ *     -w ms      the coalescing window, 1000 by default, 0 not to coalesce
+ *     -o port    the destination port of the magic packets, 9 by default
+ *
+ * A request from a shell:
+ *
+ *     echo "00:1b:63:aa:bb:cc 10.1.2.0/24" | nc -u -w0 relay-host 9009
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_relay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define RELAYD_MAX_TARGETS  (WOL_RELAY_MAX_TARGETS - 1)
+
+static volatile int stop = 0;
+static volatile sig_atomic_t dumpStats = 0;
+
+
+static void relayd_signal (int sig)
+{
+	if (sig == SIGUSR1) {
+		dumpStats = 1;
+	}
+	else {
+		stop = 1;
+	}
+}
+
+
+static void relayd_report (const wol_relay *relay)
+{
+	wol_relay_stats stats;
+
+	wol_relay_get_stats (relay, &stats);
+	fprintf (stderr, "wol_relayd: requests %llu coalesced %llu rejected %llu sent %llu failed %llu\n",
+			 (unsigned long long)stats.requests, (unsigned long long)stats.coalesced,
+			 (unsigned long long)stats.rejected, (unsigned long long)stats.sent,
+			 (unsigned long long)stats.failed);
+}
+
+
+static void relayd_usage (void)
+{
+	fprintf (stderr, "usage: wol_relayd [-b addr] [-p port] [-u path] [-t subnet]... [-w ms] [-o port]\n");
+	exit (2);
+}
+
+
+int main (int argc, char **argv)
+{
+	struct sigaction sa;
+	wol_relay *relay;
+	const char *bindAddr = NULL, *unixPath = NULL;
+	const char *targets [RELAYD_MAX_TARGETS];
+	int targetCount = 0, port = WOL_RELAY_PORT, windowMs = WOL_RELAY_WINDOW_MS, outPort = 9;
+	int opt, i;
+
+	while ((opt = getopt (argc, argv, "b:p:u:t:w:o:")) != -1) {
+		switch (opt) {
+			case 'b': bindAddr = optarg; break;
+			case 'p': port = atoi (optarg); break;
+			case 'u': unixPath = optarg; break;
+			case 'w': windowMs = atoi (optarg); break;
+			case 'o': outPort = atoi (optarg); break;
+			case 't':
+				if (targetCount == RELAYD_MAX_TARGETS) {
+					fprintf (stderr, "wol_relayd: at most %d target subnets\n", RELAYD_MAX_TARGETS);
+					return (1);
+				}
+				targets [targetCount++] = optarg;
+				break;
+			default:
+				relayd_usage ();
+		}
+	}
+	if (optind != argc || windowMs < 0 || port < 0 || (port == 0 && unixPath == NULL)) {
+		relayd_usage ();
+	}
+
+	if ((relay = wol_relay_create (outPort, windowMs)) == NULL) {
+		fprintf (stderr, "wol_relayd: cannot create the relay: %s\n", strerror (errno));
+		return (1);
+	}
+	for (i = 0; i < targetCount; i++) {
+		if (wol_relay_add_target (relay, targets [i]) < 0) {
+			fprintf (stderr, "wol_relayd: bad target subnet %s\n", targets [i]);
+			wol_relay_destroy (relay);
+			return (1);
+		}
+	}
+	if ((port > 0 && wol_relay_listen_udp (relay, bindAddr, port) < 0) ||
+		(unixPath != NULL && wol_relay_listen_unix (relay, unixPath) < 0)) {
+		fprintf (stderr, "wol_relayd: cannot listen: %s\n", strerror (errno));
+		wol_relay_destroy (relay);
+		return (1);
+	}
+
+	/**
+     * No SA_RESTART, so a signal interrupts the event loop's wait.
+     */
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = relayd_signal;
+	sigemptyset (&sa.sa_mask);
+	sigaction (SIGINT, &sa, NULL);
+	sigaction (SIGTERM, &sa, NULL);
+	sigaction (SIGUSR1, &sa, NULL);
+	signal (SIGPIPE, SIG_IGN);
+
+	while (!stop) {
+		if (wol_relay_run_once (relay, 1000) < 0) {
+			fprintf (stderr, "wol_relayd: event loop failed: %s\n", strerror (errno));
+			break;
+		}
+		if (dumpStats) {
+			dumpStats = 0;
+			relayd_report (relay);
+		}
+	}
+
+	relayd_report (relay);
+	wol_relay_destroy (relay);
+
+	return (0);
+}
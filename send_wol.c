@@ -21,12 +21,245 @@
  * http://www.gnu.org/copyleft/gpl.html
 */
 
+#if defined(__linux__)
+#define _GNU_SOURCE  /* sendmmsg() */
+#endif
+
 #include "wol_lib.h"
 #include "in_ether.h"
+#include "wol_stats.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
+#include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
+
+/** The number of messages submitted to the kernel per sendmmsg() call. */
+#define WOL_BATCH_CHUNK  256
+
+/** The default destination of the magic packets: the limited broadcast address. */
+#define WOL_DEFAULT_ADDR  0xffffffff
+#define WOL_DEFAULT_PORT  60000
+
+
+/**
+ * The persistent wake context. Owns the open broadcast socket, the destination
+ * address, and the packet buffers reused by every send.
+ */
+struct wol_ctx {
+	int packet;                      /**< the open, broadcast enabled socket */
+	struct sockaddr_in sap;          /**< the destination address */
+	unsigned char packetBuf [128];   /**< single packet buffer */
+	unsigned char *batchBuf;         /**< batch packet buffer, grown on demand */
+	int batchCap;                    /**< the number of packets batchBuf holds */
+};
+
+
+/**
+ * Function to build a magic packet for a packed MAC address. The 16 copies
+ * of the address repeat every 24 bytes in 64-bit words, so the packet is
+ * written with 13 word stores instead of a byte loop.
+ *
+ * @param mac - the packed MAC address
+ * @param packetBuf - the buffer to populate, at least WOL_PACKET_LEN bytes
+ */
+void wol_build_magic (wol_mac mac, unsigned char *packetBuf)
+{
+	uint64_t words [3];
+	const uint64_t header = ~(uint64_t)0;
+	int i;
+	
+	/**
+     * Four copies of the address make a 24 byte pattern, three words long.
+     * On little endian systems the words are computed in registers, from the
+     * address byte swapped into memory order, m0..m5 then two zero bytes.
+     */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t x = __builtin_bswap64 (mac << 16);
+	
+	words [0] = x | (x << 48);
+	words [1] = (x >> 16) | (x << 32);
+	words [2] = (x >> 32) | (x << 16);
+#else
+	unsigned char pattern [24];
+	
+	for (i = 0; i < 24; i++) {
+		pattern [i] = (unsigned char)(mac >> (40 - (i % 6) * 8));
+	}
+	memcpy (words, pattern, sizeof (words));
+#endif
+	
+	/**
+     * The 6 x <code>0xff</code> header, then four repetitions of the pattern.
+     * The header word is overwritten by the first pattern word past byte 6.
+     */
+	memcpy (packetBuf, &header, 8);
+	for (i = 0; i < 4; i++) {
+		unsigned char *ptr = packetBuf + 6 + i * 24;
+		
+		memcpy (ptr, &words [0], 8);
+		memcpy (ptr + 8, &words [1], 8);
+		memcpy (ptr + 16, &words [2], 8);
+	}
+}
+
+
+/**
+ * Function to build a magic packet for the argument specified hardware address.
+ * The packet buffer is populated with 6 x <code>0xff</code> then 16 x the
+ * hardware address.
+ *
+ * @param hwAddr - the 6 byte hardware address
+ * @param packetBuf - the buffer to populate, at least WOL_PACKET_LEN bytes
+ */
+static void wol_build_packet (const unsigned char *hwAddr, unsigned char *packetBuf)
+{
+	wol_build_magic (wol_mac_from_bytes (hwAddr), packetBuf);
+}
+
+
+/**
+ * Function to open the UDP socket the magic packets are sent on, and enable
+ * broadcasting on it.
+ *
+ * @return the socket descriptor, or -1 on failure
+ */
+static int wol_open_socket (void)
+{
+	int packet;
+	int optval = 1;
+	
+	if ((packet = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_SOCKET, errno);
+		return (-1);
+	}
+	if (setsockopt (packet, SOL_SOCKET, SO_BROADCAST, (char *)&optval, sizeof (optval)) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_SETSOCKOPT, errno);
+		close (packet);
+		return (-1);
+	}
+	return (packet);
+}
+
+
+/**
+ * Function to send one magic packet on an open socket, recording the send's
+ * latency and result in the statistics.
+ *
+ * @param packet - the open, broadcast enabled socket
+ * @param sap - the destination address
+ * @param packetBuf - the WOL_PACKET_LEN byte magic packet
+ *
+ * @return 0 sent, or -1 failed
+ */
+static int wol_send_one (int packet, struct sockaddr_in *sap, const unsigned char *packetBuf)
+{
+	WOL_STATS_START (start);
+	
+	if (sendto (packet, (const char *)packetBuf, WOL_PACKET_LEN, 0, (struct sockaddr *)sap, sizeof (*sap)) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_SEND, errno);
+		WOL_STATS_COUNT (WOL_CTR_PACKETS_FAILED, 1);
+		return (-1);
+	}
+	WOL_STATS_LATENCY (WOL_HIST_SEND, start);
+	WOL_STATS_COUNT (WOL_CTR_PACKETS_SENT, 1);
+	return (0);
+}
+
+
+/**
+ * Function to send a run of magic packets on an open socket. On Linux the
+ * packets are submitted with sendmmsg() in chunks of WOL_BATCH_CHUNK messages,
+ * elsewhere with one sendto() per packet. The packets are either contiguous in
+ * one buffer, or scattered and listed in an array of pointers.
+ *
+ * @param packet - the open, broadcast enabled socket
+ * @param sap - the destination address
+ * @param packets - count x WOL_PACKET_LEN bytes of magic packets, if packetList is NULL
+ * @param packetList - count pointers to WOL_PACKET_LEN byte magic packets, or NULL
+ * @param count - the number of packets
+ * @param status - per packet result, 0 sent or -1 failed
+ *
+ * @return the number of packets sent
+ */
+static int wol_send_packets (int packet, struct sockaddr_in *sap, const unsigned char *packets,
+							 const unsigned char *const *packetList, int count, int *status)
+{
+	int sent = 0;
+	int i = 0;
+	WOL_STATS_START (start);
+	
+#if defined(__linux__)
+	struct mmsghdr msgs [WOL_BATCH_CHUNK];
+	struct iovec iovs [WOL_BATCH_CHUNK];
+	
+	while (i < count) {
+		int n, chunk = count - i;
+		
+		if (chunk > WOL_BATCH_CHUNK) {
+			chunk = WOL_BATCH_CHUNK;
+		}
+		
+		/**
+		 * Point one message header at each packet of the chunk. The packets
+		 * are already built, so no data is copied.
+		 */
+		memset (msgs, 0, chunk * sizeof (struct mmsghdr));
+		for (n = 0; n < chunk; n++) {
+			iovs [n].iov_base = (void *)(packetList ? packetList [i + n] : packets + (size_t)(i + n) * WOL_PACKET_LEN);
+			iovs [n].iov_len = WOL_PACKET_LEN;
+			msgs [n].msg_hdr.msg_name = sap;
+			msgs [n].msg_hdr.msg_namelen = sizeof (*sap);
+			msgs [n].msg_hdr.msg_iov = &iovs [n];
+			msgs [n].msg_hdr.msg_iovlen = 1;
+		}
+		
+		/**
+		 * sendmmsg() stops at the first message that fails, and reports the
+		 * number sent before it. The failing message is marked as an error
+		 * and skipped, and the rest of the chunk is resubmitted.
+		 */
+		n = sendmmsg (packet, msgs, chunk, 0);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			WOL_STATS_ERROR (WOL_STAGE_SEND, errno);
+			status [i++] = -1;
+			continue;
+		}
+		while (n-- > 0) {
+			status [i++] = 0;
+			sent++;
+		}
+	}
+#else
+	for (i = 0; i < count; i++) {
+		const unsigned char *ptr = packetList ? packetList [i] : packets + (size_t)i * WOL_PACKET_LEN;
+		
+		if (sendto (packet, (const char *)ptr, WOL_PACKET_LEN, 0,
+					(struct sockaddr *)sap, sizeof (*sap)) < 0) {
+			WOL_STATS_ERROR (WOL_STAGE_SEND, errno);
+			status [i] = -1;
+		}
+		else {
+			status [i] = 0;
+			sent++;
+		}
+	}
+#endif
+	
+	/** One latency sample per call, for the whole run. */
+	WOL_STATS_LATENCY (WOL_HIST_SEND, start);
+	WOL_STATS_COUNT (WOL_CTR_PACKETS_SENT, sent);
+	WOL_STATS_COUNT (WOL_CTR_PACKETS_FAILED, count - sent);
+	
+	return (sent);
+}
 
 
 /**
@@ -42,13 +275,10 @@
  */
 int send_wol (char *macAddr)
 {
-	int i, j;
 	int packet;
 	struct sockaddr_in sap;
 	unsigned char ethaddr[8];
-	unsigned char *ptr;
 	unsigned char packetBuf [128];
-	int optval = 1;
 	
 	/** 
      * Convert the MAC address to the hardware address. If the conversion
@@ -56,54 +286,37 @@ int send_wol (char *macAddr)
      */
 	if (in_ether (macAddr, ethaddr) < 0) {
 		//fprintf (stderr, "\r%s: invalid hardware address\n", Program);
+		WOL_STATS_ERROR (WOL_STAGE_PARSE, EINVAL);
 		return (-1);
 	}
 	
 	/**
-     * Setup the packet socket. If the socket creation fails exit the function,
-     * and return an error.
+     * Setup the packet socket, with broadcasting enabled. If the socket creation
+     * fails exit the function, and return an error.
      */
-	if ((packet = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+	if ((packet = wol_open_socket ()) < 0) {
 		//fprintf (stderr, "\r%s: socket failed\n", Program);
 		return (-1);
 	}
 	
-	/**
-     * Set socket options. If the operation fails, close the packet socket,
-     * exit the function, and return an error.
-     */
-	if (setsockopt (packet, SOL_SOCKET, SO_BROADCAST, (char *)&optval, sizeof (optval)) < 0) {
-		//fprintf (stderr, "\r%s: setsocket failed %s\n", Program, strerror (errno));
-		close (packet);
-		return (-1);
-	}
-	
 	/** 
      * Set up broadcast address <code>0xffffffff</code>. 
      */
 	sap.sin_family = AF_INET;
-	sap.sin_addr.s_addr = htonl(0xffffffff);
-	sap.sin_port = htons(60000);
+	sap.sin_addr.s_addr = htonl(WOL_DEFAULT_ADDR);
+	sap.sin_port = htons(WOL_DEFAULT_PORT);
 	
 	/** 
      * Build the message to send. Populate the packet buffer with:  
      * 6 x <code>0xff</code> then 16 x converted MAC address.
      */
-	ptr = packetBuf;
-	for (i = 0; i < 6; i++) {
-		*ptr++ = 0xff;
-    }
-	for (j = 0; j < 16; j++) {
-		for (i = 0; i < 6; i++) {
-			*ptr++ = ethaddr [i];
-        }
-    }
+	wol_build_packet (ethaddr, packetBuf);
 	
 	/**
      * Send the magic packet. If the sendto() fails, close the packet socket,
      * exit the function, and return an error.
      */
-	if (sendto (packet, (char *)packetBuf, 102, 0, (struct sockaddr *)&sap, sizeof (sap)) < 0) {
+	if (wol_send_one (packet, &sap, packetBuf) < 0) {
 		//fprintf (stderr, "\r%s: sendto failed, %s\n", Program, strerror(errno));
 		close (packet);
 		return (-1);
@@ -117,4 +330,300 @@ int send_wol (char *macAddr)
 	//fprintf (stderr, "\r%s: magic packet sent to %s %s\n", Program, mac, host);
 	
 	return (0);
-}
\ No newline at end of file
+}
+
+
+/**
+ * Function to send a "magic packet" to a packed MAC address.
+ *
+ * @param mac - the packed MAC address to send the magic packet to
+ *
+ * @return success or failure of the send attempt
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int send_wol_mac (wol_mac mac)
+{
+	unsigned char hwAddrs [1][6];
+	int status;
+	
+	wol_mac_to_bytes (mac, hwAddrs [0]);
+	
+	return (send_wol_batch_hw (hwAddrs, 1, &status) == 1) ? 0 : -1;
+}
+
+
+/**
+ * Function to send magic packets to a batch of already converted hardware
+ * addresses over a single socket. All of the packets are built into one
+ * contiguous buffer, and submitted to the kernel in chunks.
+ *
+ * @param hwAddrs - the array of 6 byte hardware addresses
+ * @param count - the number of hardware addresses
+ * @param status - populated with the result for each address, 0 sent or -1 failed
+ *
+ * @return the number of magic packets sent, or -1 if the socket could not be set up
+ */
+int send_wol_batch_hw (unsigned char (*hwAddrs)[6], int count, int *status)
+{
+	int sent;
+	wol_ctx *ctx;
+	
+	if (count <= 0) {
+		return (0);
+	}
+	
+	/**
+     * Setup the one socket the whole batch is sent on.
+     */
+	if ((ctx = wol_ctx_create (NULL, 0)) == NULL) {
+		return (-1);
+	}
+	
+	sent = wol_ctx_send_batch (ctx, hwAddrs, count, status);
+	
+	wol_ctx_destroy (ctx);
+	
+	return (sent);
+}
+
+
+/**
+ * Function to send magic packets to a batch of MAC address strings in the
+ * format: <code>xx:xx:xx:xx:xx:xx</code>. Invalid MAC address strings are
+ * reported in the status array, and the rest of the batch is still sent.
+ *
+ * @param macAddrs - the array of MAC address strings
+ * @param count - the number of MAC address strings
+ * @param status - populated with the result for each address, 0 sent or -1 failed
+ *
+ * @return the number of magic packets sent, or -1 if the socket could not be set up
+ */
+int send_wol_batch (char **macAddrs, int count, int *status)
+{
+	int i, valid, sent;
+	unsigned char (*hwAddrs)[6];
+	int *index, *validStatus;
+	
+	if (count <= 0) {
+		return (0);
+	}
+	
+	hwAddrs = malloc ((size_t)count * sizeof (*hwAddrs));
+	index = malloc ((size_t)count * sizeof (int));
+	validStatus = malloc ((size_t)count * sizeof (int));
+	if (hwAddrs == NULL || index == NULL || validStatus == NULL) {
+		free (hwAddrs);
+		free (index);
+		free (validStatus);
+		return (-1);
+	}
+	
+	/**
+     * Convert the MAC addresses, remembering where each valid one came from
+     * so its send result can be reported against the caller's entry.
+     */
+	valid = 0;
+	for (i = 0; i < count; i++) {
+		unsigned char ethaddr[8];
+		
+		if (in_ether (macAddrs [i], ethaddr) < 0) {
+			WOL_STATS_ERROR (WOL_STAGE_PARSE, EINVAL);
+			status [i] = -1;
+			continue;
+		}
+		memcpy (hwAddrs [valid], ethaddr, 6);
+		index [valid++] = i;
+	}
+	
+	sent = send_wol_batch_hw (hwAddrs, valid, validStatus);
+	for (i = 0; i < valid; i++) {
+		status [index [i]] = (sent < 0) ? -1 : validStatus [i];
+	}
+	
+	free (hwAddrs);
+	free (index);
+	free (validStatus);
+	
+	return (sent);
+}
+
+
+/**
+ * Function to create a persistent wake context. The context opens and
+ * configures its broadcast socket once, so each later send is a single
+ * sendto() system call.
+ * A context is not safe for concurrent sends from several threads, as the
+ * packet buffers are shared. It is cheap to create, so create one per thread.
+ *
+ * @param bcastAddr - the destination IPv4 address string, NULL or "" for 255.255.255.255
+ * @param port - the destination UDP port, 0 for the default port 60000
+ *
+ * @return the new context, or NULL on failure
+ */
+wol_ctx *wol_ctx_create (const char *bcastAddr, int port)
+{
+	wol_ctx *ctx;
+	
+	if ((ctx = calloc (1, sizeof (wol_ctx))) == NULL) {
+		return (NULL);
+	}
+	
+	/**
+     * Set up the destination address. If no address is specified, use the
+     * broadcast address <code>0xffffffff</code>.
+     */
+	ctx->sap.sin_family = AF_INET;
+	ctx->sap.sin_port = htons((port > 0) ? port : WOL_DEFAULT_PORT);
+	if (bcastAddr == NULL || bcastAddr [0] == '\0') {
+		ctx->sap.sin_addr.s_addr = htonl(WOL_DEFAULT_ADDR);
+	}
+	else if (inet_pton (AF_INET, bcastAddr, &ctx->sap.sin_addr) != 1) {
+		free (ctx);
+		return (NULL);
+	}
+	
+	if ((ctx->packet = wol_open_socket ()) < 0) {
+		free (ctx);
+		return (NULL);
+	}
+	
+	return (ctx);
+}
+
+
+/**
+ * Function to release a wake context, and close its socket.
+ *
+ * @param ctx - the context to release, may be NULL
+ */
+void wol_ctx_destroy (wol_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	close (ctx->packet);
+	free (ctx->batchBuf);
+	free (ctx);
+}
+
+
+/**
+ * Function to send a magic packet to a converted hardware address using
+ * the context's socket and destination.
+ *
+ * @param ctx - the wake context
+ * @param hwAddr - the 6 byte hardware address
+ *
+ * @return success or failure of the send attempt
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_ctx_send_hw (wol_ctx *ctx, const unsigned char *hwAddr)
+{
+	wol_build_packet (hwAddr, ctx->packetBuf);
+	
+	return (wol_send_one (ctx->packet, &ctx->sap, ctx->packetBuf));
+}
+
+
+/**
+ * Function to send a magic packet to a packed MAC address using the
+ * context's socket and destination.
+ *
+ * @param ctx - the wake context
+ * @param mac - the packed MAC address
+ *
+ * @return success or failure of the send attempt
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_ctx_send_mac (wol_ctx *ctx, wol_mac mac)
+{
+	wol_build_magic (mac, ctx->packetBuf);
+	
+	return (wol_send_one (ctx->packet, &ctx->sap, ctx->packetBuf));
+}
+
+
+/**
+ * Function to send a magic packet to the argument specified MAC address
+ * string, in the format: <code>xx:xx:xx:xx:xx:xx</code>, using the context's
+ * socket and destination.
+ *
+ * @param ctx - the wake context
+ * @param macAddr - the MAC address string to send the magic packet to
+ *
+ * @return success or failure of the send attempt
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_ctx_send (wol_ctx *ctx, char *macAddr)
+{
+	unsigned char ethaddr[8];
+	
+	if (in_ether (macAddr, ethaddr) < 0) {
+		WOL_STATS_ERROR (WOL_STAGE_PARSE, EINVAL);
+		return (-1);
+	}
+	return (wol_ctx_send_hw (ctx, ethaddr));
+}
+
+
+/**
+ * Function to send magic packets to a batch of converted hardware addresses
+ * using the context's socket and destination. The packets are built into the
+ * context's batch buffer, which is grown as needed and reused by later calls.
+ *
+ * @param ctx - the wake context
+ * @param hwAddrs - the array of 6 byte hardware addresses
+ * @param count - the number of hardware addresses
+ * @param status - populated with the result for each address, 0 sent or -1 failed
+ *
+ * @return the number of magic packets sent, or -1 on failure to allocate the buffer
+ */
+int wol_ctx_send_batch (wol_ctx *ctx, unsigned char (*hwAddrs)[6], int count, int *status)
+{
+	int i;
+	
+	if (count <= 0) {
+		return (0);
+	}
+	
+	if (count > ctx->batchCap) {
+		unsigned char *buf = realloc (ctx->batchBuf, (size_t)count * WOL_PACKET_LEN);
+		
+		if (buf == NULL) {
+			return (-1);
+		}
+		ctx->batchBuf = buf;
+		ctx->batchCap = count;
+	}
+	
+	for (i = 0; i < count; i++) {
+		wol_build_packet (hwAddrs [i], ctx->batchBuf + (size_t)i * WOL_PACKET_LEN);
+	}
+	
+	return (wol_send_packets (ctx->packet, &ctx->sap, ctx->batchBuf, NULL, count, status));
+}
+
+
+/**
+ * Function to send already built magic packets using the context's socket
+ * and destination. The packets are passed to the kernel where they are, for
+ * example slices of a wol_pktcache arena, with no per-send construction.
+ *
+ * @param ctx - the wake context
+ * @param packets - the WOL_PACKET_LEN byte magic packets
+ * @param count - the number of packets
+ * @param status - populated with the result for each packet, 0 sent or -1 failed
+ *
+ * @return the number of magic packets sent
+ */
+int wol_ctx_send_packets (wol_ctx *ctx, const unsigned char *const *packets, int count, int *status)
+{
+	if (count <= 0) {
+		return (0);
+	}
+	return (wol_send_packets (ctx->packet, &ctx->sap, NULL, packets, count, status));
+}
@@ -0,0 +1,1205 @@
+/**
+ * @file wol_async.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Asynchronous engine for wake sends, ICMP probes and mDNS queries.
+ * @details Thousands of operations can be outstanding on one thread. Each
+ * operation is submitted without blocking, and completes through a callback,
+ * or a result queue read with wol_async_reap(), from wol_async_poll().
+ * On Linux the sends and receives are io_uring submissions, completed through
+ * the one completion queue. Where io_uring is unavailable, the engine falls
+ * back to readiness polling of its three sockets.
+ * All probes share one ICMP socket, and are matched to their replies by
+ * echo sequence number. All queries share one mDNS socket, and are matched
+ * to their responses by host name. Timeouts are kept in a binary heap.
+ * An engine must only be used from one thread.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_async.h"
+#include "icmp.h"
+#include "mdns.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define WOL_HAVE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/** Operation states. */
+#define OP_FREE     0
+#define OP_SENDING  1   /**< waiting to be sent, or send in flight */
+#define OP_WAITING  2   /**< sent, waiting for the answer */
+#define OP_ZOMBIE   3   /**< completed, but its send is still in flight */
+
+/** io_uring user data kinds, in the upper 32 bits; the op slot in the lower. */
+#define UD_SEND       1ULL
+#define UD_RECV_ICMP  2ULL
+#define UD_RECV_MDNS  3ULL
+
+#define ASYNC_MAX_HOST    64
+#define ASYNC_QUERY_LEN   320
+#define ASYNC_RECV_LEN    9000
+#define WOL_PORT          60000
+
+
+/**
+ * One outstanding operation.
+ */
+struct async_op {
+	int type;                          /**< WOL_ASYNC_* */
+	int state;                         /**< OP_* */
+	int inflight;                      /**< 1 while an io_uring send is in flight */
+	int heapIdx;                       /**< position in the timeout heap, or -1 */
+	int next;                          /**< free list, or send queue link */
+	int hostNext;                      /**< mDNS host chain link */
+	long long start;                   /**< submission time, usec */
+	long long deadline;                /**< timeout, usec */
+	wol_async_cb cb;
+	void *arg;
+	struct sockaddr_in sap;            /**< the destination */
+	char host [ASYNC_MAX_HOST];        /**< mDNS: the host name */
+	unsigned int hostHash;
+	int len;                           /**< the length of buf */
+	unsigned char buf [ASYNC_QUERY_LEN]; /**< the packet to send */
+#if defined(WOL_HAVE_IO_URING)
+	struct msghdr msg;
+	struct iovec iov;
+#endif
+};
+
+
+/**
+ * A receive buffer, with the message header io_uring fills in.
+ */
+struct async_recv {
+	unsigned char buf [ASYNC_RECV_LEN];
+	struct sockaddr_in from;
+#if defined(WOL_HAVE_IO_URING)
+	struct msghdr msg;
+	struct iovec iov;
+#endif
+};
+
+
+/**
+ * The asynchronous engine.
+ */
+struct wol_async {
+	int backend;
+	int maxOps;
+	struct async_op *ops;
+	int freeList;
+	int pending;                       /**< operations not yet completed */
+	int delivered;                     /**< results delivered by the current poll */
+
+	int *heap;                         /**< timeout min-heap of op slots */
+	int heapLen;
+
+	int sendHead, sendTail;            /**< poll backend: ops waiting to be sent */
+
+	int *hostHead;                     /**< mDNS: host hash buckets of op slots */
+	unsigned int hostMask;
+
+	wol_async_result *results;         /**< results of ops without a callback */
+	int resHead, resCount;
+
+	icmp_sock icmp;
+	int wakeFd;
+	int mdnsFd;
+	struct async_recv *icmpRecv;
+	struct async_recv *mdnsRecv;
+
+#if defined(WOL_HAVE_IO_URING)
+	int ringFd;
+	unsigned int sqEntries;
+	unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned int *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqPtr, *cqPtr;
+	size_t sqSize, cqSize, sqesSize;
+	unsigned int toSubmit;
+#endif
+};
+
+
+/**
+ * Function to read the monotonic clock in microseconds.
+ */
+static long long async_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+}
+
+
+/**
+ * Function to hash a host name, ignoring case.
+ */
+static unsigned int async_hash_host (const char *name, int len)
+{
+	unsigned int h = 2166136261u;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)tolower ((unsigned char)name [i])) * 16777619u;
+	}
+	return (h);
+}
+
+
+/*
+ * The timeout heap, ordered by deadline.
+ */
+
+static void heap_swap (wol_async *eng, int a, int b)
+{
+	int t = eng->heap [a];
+
+	eng->heap [a] = eng->heap [b];
+	eng->heap [b] = t;
+	eng->ops [eng->heap [a]].heapIdx = a;
+	eng->ops [eng->heap [b]].heapIdx = b;
+}
+
+static void heap_up (wol_async *eng, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (eng->ops [eng->heap [parent]].deadline <= eng->ops [eng->heap [i]].deadline) {
+			break;
+		}
+		heap_swap (eng, i, parent);
+		i = parent;
+	}
+}
+
+static void heap_down (wol_async *eng, int i)
+{
+	for (;;) {
+		int l = i * 2 + 1, r = l + 1, min = i;
+
+		if (l < eng->heapLen && eng->ops [eng->heap [l]].deadline < eng->ops [eng->heap [min]].deadline) {
+			min = l;
+		}
+		if (r < eng->heapLen && eng->ops [eng->heap [r]].deadline < eng->ops [eng->heap [min]].deadline) {
+			min = r;
+		}
+		if (min == i) {
+			break;
+		}
+		heap_swap (eng, i, min);
+		i = min;
+	}
+}
+
+static void heap_push (wol_async *eng, int slot)
+{
+	eng->heap [eng->heapLen] = slot;
+	eng->ops [slot].heapIdx = eng->heapLen++;
+	heap_up (eng, eng->heapLen - 1);
+}
+
+static void heap_remove (wol_async *eng, int slot)
+{
+	int i = eng->ops [slot].heapIdx;
+
+	if (i < 0) {
+		return;
+	}
+	eng->ops [slot].heapIdx = -1;
+	if (--eng->heapLen == i) {
+		return;
+	}
+	eng->heap [i] = eng->heap [eng->heapLen];
+	eng->ops [eng->heap [i]].heapIdx = i;
+	heap_down (eng, i);
+	heap_up (eng, i);
+}
+
+
+/**
+ * Function to release an op slot to the free list.
+ */
+static void async_free_op (wol_async *eng, int slot)
+{
+	eng->ops [slot].state = OP_FREE;
+	eng->ops [slot].next = eng->freeList;
+	eng->freeList = slot;
+}
+
+
+/**
+ * Function to unlink an mDNS op from its host hash chain.
+ */
+static void async_unlink_host (wol_async *eng, int slot)
+{
+	int *link = &eng->hostHead [eng->ops [slot].hostHash & eng->hostMask];
+
+	while (*link >= 0) {
+		if (*link == slot) {
+			*link = eng->ops [slot].hostNext;
+			return;
+		}
+		link = &eng->ops [*link].hostNext;
+	}
+}
+
+
+/**
+ * Function to complete an operation: deliver its result through the callback
+ * or the result queue, and release its slot.
+ *
+ * @param eng - the engine
+ * @param slot - the op slot
+ * @param status - 0 success, 1 no answer in time, -1 failed to send
+ * @param devInfo - the device info of an mDNS query, or NULL
+ */
+static void async_complete (wol_async *eng, int slot, int status, const char *devInfo)
+{
+	struct async_op *op = &eng->ops [slot];
+	wol_async_result res;
+
+	memset (&res, 0, sizeof (res));
+	res.op = op->type;
+	res.status = status;
+	res.arg = op->arg;
+	if (status == 0 && op->type != WOL_ASYNC_WAKE) {
+		res.rttUsec = (long)(async_now () - op->start);
+	}
+	if (devInfo != NULL) {
+		strncpy (res.devInfo, devInfo, WOL_DEVINFO_LEN - 1);
+	}
+
+	heap_remove (eng, slot);
+	if (op->type == WOL_ASYNC_MDNS) {
+		async_unlink_host (eng, slot);
+	}
+	eng->pending--;
+	eng->delivered++;
+
+	/**
+     * Release the slot before the callback, so the callback may submit a
+     * new operation. A slot with a send still in flight is released when
+     * the send completes.
+     */
+	if (op->inflight) {
+		op->state = OP_ZOMBIE;
+	}
+	else {
+		async_free_op (eng, slot);
+	}
+
+	if (op->cb != NULL) {
+		op->cb (&res);
+	}
+	else {
+		eng->results [(eng->resHead + eng->resCount) % eng->maxOps] = res;
+		eng->resCount++;
+	}
+}
+
+
+/**
+ * Function to handle a finished send: a wake is complete, a probe or a query
+ * now waits for its answer.
+ */
+static void async_sent (wol_async *eng, int slot, int ok)
+{
+	struct async_op *op = &eng->ops [slot];
+
+	if (!ok) {
+		async_complete (eng, slot, -1, NULL);
+	}
+	else if (op->type == WOL_ASYNC_WAKE) {
+		async_complete (eng, slot, 0, NULL);
+	}
+	else {
+		op->state = OP_WAITING;
+	}
+}
+
+
+/**
+ * Function to get the socket an op is sent on.
+ */
+static int async_op_fd (wol_async *eng, struct async_op *op)
+{
+	switch (op->type) {
+		case WOL_ASYNC_WAKE:
+			return (eng->wakeFd);
+		case WOL_ASYNC_PROBE:
+			return (eng->icmp.fd);
+		default:
+			return (eng->mdnsFd);
+	}
+}
+
+
+#if defined(WOL_HAVE_IO_URING)
+
+/**
+ * Function to set up the io_uring submission and completion rings.
+ *
+ * @param eng - the engine
+ * @param entries - the number of submission queue entries
+ *
+ * @return 0 on success, -1 if io_uring is unavailable
+ */
+static int uring_setup (wol_async *eng, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset (&p, 0, sizeof (p));
+	if ((eng->ringFd = (int)syscall (__NR_io_uring_setup, entries, &p)) < 0) {
+		return (-1);
+	}
+
+	eng->sqSize = p.sq_off.array + p.sq_entries * sizeof (unsigned int);
+	eng->cqSize = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (eng->cqSize > eng->sqSize) {
+			eng->sqSize = eng->cqSize;
+		}
+		eng->cqSize = 0;
+	}
+
+	eng->sqPtr = mmap (NULL, eng->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					   eng->ringFd, IORING_OFF_SQ_RING);
+	if (eng->sqPtr == MAP_FAILED) {
+		close (eng->ringFd);
+		return (-1);
+	}
+	if (eng->cqSize == 0) {
+		eng->cqPtr = eng->sqPtr;
+	}
+	else {
+		eng->cqPtr = mmap (NULL, eng->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+						   eng->ringFd, IORING_OFF_CQ_RING);
+		if (eng->cqPtr == MAP_FAILED) {
+			munmap (eng->sqPtr, eng->sqSize);
+			close (eng->ringFd);
+			return (-1);
+		}
+	}
+	eng->sqesSize = p.sq_entries * sizeof (struct io_uring_sqe);
+	eng->sqes = mmap (NULL, eng->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					  eng->ringFd, IORING_OFF_SQES);
+	if (eng->sqes == MAP_FAILED) {
+		if (eng->cqSize != 0) {
+			munmap (eng->cqPtr, eng->cqSize);
+		}
+		munmap (eng->sqPtr, eng->sqSize);
+		close (eng->ringFd);
+		return (-1);
+	}
+
+	eng->sqEntries = p.sq_entries;
+	eng->sqHead = (unsigned int *)((char *)eng->sqPtr + p.sq_off.head);
+	eng->sqTail = (unsigned int *)((char *)eng->sqPtr + p.sq_off.tail);
+	eng->sqMask = (unsigned int *)((char *)eng->sqPtr + p.sq_off.ring_mask);
+	eng->sqArray = (unsigned int *)((char *)eng->sqPtr + p.sq_off.array);
+	eng->cqHead = (unsigned int *)((char *)eng->cqPtr + p.cq_off.head);
+	eng->cqTail = (unsigned int *)((char *)eng->cqPtr + p.cq_off.tail);
+	eng->cqMask = (unsigned int *)((char *)eng->cqPtr + p.cq_off.ring_mask);
+	eng->cqes = (struct io_uring_cqe *)((char *)eng->cqPtr + p.cq_off.cqes);
+
+	return (0);
+}
+
+
+/**
+ * Function to unmap the io_uring rings, and close the ring.
+ */
+static void uring_teardown (wol_async *eng)
+{
+	munmap (eng->sqes, eng->sqesSize);
+	if (eng->cqSize != 0) {
+		munmap (eng->cqPtr, eng->cqSize);
+	}
+	munmap (eng->sqPtr, eng->sqSize);
+	close (eng->ringFd);
+}
+
+
+/**
+ * Function to hand the queued submissions to the kernel.
+ */
+static int uring_submit (wol_async *eng)
+{
+	while (eng->toSubmit > 0) {
+		int n = (int)syscall (__NR_io_uring_enter, eng->ringFd, eng->toSubmit, 0, 0, NULL, 0);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return (-1);
+		}
+		eng->toSubmit -= n;
+	}
+	return (0);
+}
+
+
+/**
+ * Function to get the next free submission queue entry, submitting the
+ * queued entries first if the queue is full.
+ */
+static struct io_uring_sqe *uring_get_sqe (wol_async *eng)
+{
+	unsigned int tail = *eng->sqTail;
+	unsigned int head = __atomic_load_n (eng->sqHead, __ATOMIC_ACQUIRE);
+	struct io_uring_sqe *sqe;
+
+	if (tail - head >= eng->sqEntries) {
+		if (uring_submit (eng) < 0) {
+			return (NULL);
+		}
+		head = __atomic_load_n (eng->sqHead, __ATOMIC_ACQUIRE);
+		if (tail - head >= eng->sqEntries) {
+			return (NULL);
+		}
+	}
+	sqe = &eng->sqes [tail & *eng->sqMask];
+	memset (sqe, 0, sizeof (*sqe));
+
+	return (sqe);
+}
+
+
+/**
+ * Function to publish a filled submission queue entry.
+ */
+static void uring_push_sqe (wol_async *eng)
+{
+	unsigned int tail = *eng->sqTail;
+
+	eng->sqArray [tail & *eng->sqMask] = tail & *eng->sqMask;
+	__atomic_store_n (eng->sqTail, tail + 1, __ATOMIC_RELEASE);
+	eng->toSubmit++;
+}
+
+
+/**
+ * Function to queue a receive on one of the engine's sockets.
+ */
+static int uring_arm_recv (wol_async *eng, int fd, struct async_recv *rcv, unsigned long long kind)
+{
+	struct io_uring_sqe *sqe;
+
+	if ((sqe = uring_get_sqe (eng)) == NULL) {
+		return (-1);
+	}
+	rcv->iov.iov_base = rcv->buf;
+	rcv->iov.iov_len = sizeof (rcv->buf);
+	memset (&rcv->msg, 0, sizeof (rcv->msg));
+	rcv->msg.msg_name = &rcv->from;
+	rcv->msg.msg_namelen = sizeof (rcv->from);
+	rcv->msg.msg_iov = &rcv->iov;
+	rcv->msg.msg_iovlen = 1;
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long)&rcv->msg;
+	sqe->len = 1;
+	sqe->user_data = kind << 32;
+	uring_push_sqe (eng);
+
+	return (0);
+}
+
+#endif /* WOL_HAVE_IO_URING */
+
+
+/**
+ * Function to send an op's packet. With io_uring, a send submission is
+ * queued. Else the packet is sent now, or queued for retry if the socket
+ * buffer is full.
+ */
+static void async_send (wol_async *eng, int slot)
+{
+	struct async_op *op = &eng->ops [slot];
+
+#if defined(WOL_HAVE_IO_URING)
+	if (eng->backend == WOL_ASYNC_IO_URING) {
+		struct io_uring_sqe *sqe = uring_get_sqe (eng);
+
+		if (sqe == NULL) {
+			async_complete (eng, slot, -1, NULL);
+			return;
+		}
+		op->iov.iov_base = op->buf;
+		op->iov.iov_len = op->len;
+		memset (&op->msg, 0, sizeof (op->msg));
+		op->msg.msg_name = &op->sap;
+		op->msg.msg_namelen = sizeof (op->sap);
+		op->msg.msg_iov = &op->iov;
+		op->msg.msg_iovlen = 1;
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = async_op_fd (eng, op);
+		sqe->addr = (unsigned long)&op->msg;
+		sqe->len = 1;
+		sqe->user_data = (UD_SEND << 32) | (unsigned int)slot;
+		uring_push_sqe (eng);
+		op->inflight = 1;
+		return;
+	}
+#endif
+
+	if (sendto (async_op_fd (eng, op), (char *)op->buf, op->len, 0,
+				(struct sockaddr *)&op->sap, sizeof (op->sap)) >= 0) {
+		async_sent (eng, slot, 1);
+	}
+	else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+		/**
+		 * The socket buffer is full. Queue the op, and retry from the
+		 * next poll.
+		 */
+		op->next = -1;
+		if (eng->sendTail >= 0) {
+			eng->ops [eng->sendTail].next = slot;
+		}
+		else {
+			eng->sendHead = slot;
+		}
+		eng->sendTail = slot;
+	}
+	else {
+		async_sent (eng, slot, 0);
+	}
+}
+
+
+/**
+ * Function to retry the sends queued by async_send() in the poll backend.
+ */
+static void async_retry_sends (wol_async *eng)
+{
+	int slot = eng->sendHead;
+
+	eng->sendHead = eng->sendTail = -1;
+	while (slot >= 0) {
+		int next = eng->ops [slot].next;
+
+		if (eng->ops [slot].state == OP_SENDING) {
+			async_send (eng, slot);
+		}
+		slot = next;
+	}
+}
+
+
+/**
+ * Function to match an ICMP packet to the probe it answers. The echo
+ * sequence number is the probe's op slot.
+ */
+static void async_on_icmp (wol_async *eng, const unsigned char *buf, int len, struct in_addr from)
+{
+	unsigned short seq;
+	struct async_op *op;
+
+	if (!icmp_parse_reply (&eng->icmp, buf, len, &seq) || seq >= eng->maxOps) {
+		return;
+	}
+	op = &eng->ops [seq];
+	if (op->type == WOL_ASYNC_PROBE && (op->state == OP_SENDING || op->state == OP_WAITING) &&
+		op->sap.sin_addr.s_addr == from.s_addr) {
+		async_complete (eng, seq, 0, NULL);
+	}
+}
+
+
+/**
+ * Callback for mdns_parse(). Completes every query waiting for the host a
+ * device info TXT record names.
+ */
+static int async_on_mdns_rr (void *arg, const char *name, unsigned short type,
+							 unsigned int ttl, const unsigned char *rdata, int rdLen)
+{
+	wol_async *eng = arg;
+	char model [WOL_DEVINFO_LEN];
+	int hostLen, slot;
+
+	(void)ttl;
+
+	if (type != DNS_TYPE_TXT) {
+		return (0);
+	}
+	hostLen = (int)strlen (name) - (int)strlen (MDNS_DEVICE_INFO) - 1;
+	if (hostLen <= 0 || name [hostLen] != '.' || strcasecmp (name + hostLen + 1, MDNS_DEVICE_INFO) != 0) {
+		return (0);
+	}
+	if (mdns_txt_model (rdata, rdLen, model, sizeof (model)) != 0) {
+		return (0);
+	}
+
+	slot = eng->hostHead [async_hash_host (name, hostLen) & eng->hostMask];
+	while (slot >= 0) {
+		struct async_op *op = &eng->ops [slot];
+		int next = op->hostNext;
+
+		if ((int)strlen (op->host) == hostLen && strncasecmp (op->host, name, hostLen) == 0) {
+			async_complete (eng, slot, 0, model);
+		}
+		slot = next;
+	}
+
+	return (0);
+}
+
+
+/**
+ * Function to complete the operations whose deadline has passed.
+ */
+static void async_expire (wol_async *eng)
+{
+	long long now = async_now ();
+
+	while (eng->heapLen > 0 && eng->ops [eng->heap [0]].deadline <= now) {
+		async_complete (eng, eng->heap [0], 1, NULL);
+	}
+}
+
+
+/**
+ * Function to process everything that is ready now, without waiting.
+ */
+static void async_process (wol_async *eng)
+{
+#if defined(WOL_HAVE_IO_URING)
+	if (eng->backend == WOL_ASYNC_IO_URING) {
+		unsigned int head = *eng->cqHead;
+		unsigned int tail = __atomic_load_n (eng->cqTail, __ATOMIC_ACQUIRE);
+
+		while (head != tail) {
+			struct io_uring_cqe *cqe = &eng->cqes [head & *eng->cqMask];
+			unsigned long long kind = cqe->user_data >> 32;
+			int slot = (int)(cqe->user_data & 0xffffffffu);
+			int res = cqe->res;
+
+			head++;
+			__atomic_store_n (eng->cqHead, head, __ATOMIC_RELEASE);
+
+			if (kind == UD_SEND) {
+				eng->ops [slot].inflight = 0;
+				if (eng->ops [slot].state == OP_ZOMBIE) {
+					async_free_op (eng, slot);
+				}
+				else if (eng->ops [slot].state == OP_SENDING) {
+					async_sent (eng, slot, res >= 0);
+				}
+			}
+			else if (kind == UD_RECV_ICMP) {
+				if (res > 0) {
+					async_on_icmp (eng, eng->icmpRecv->buf, res, eng->icmpRecv->from.sin_addr);
+				}
+				uring_arm_recv (eng, eng->icmp.fd, eng->icmpRecv, UD_RECV_ICMP);
+			}
+			else if (kind == UD_RECV_MDNS) {
+				if (res > 0) {
+					mdns_parse (eng->mdnsRecv->buf, res, async_on_mdns_rr, eng);
+				}
+				uring_arm_recv (eng, eng->mdnsFd, eng->mdnsRecv, UD_RECV_MDNS);
+			}
+			tail = __atomic_load_n (eng->cqTail, __ATOMIC_ACQUIRE);
+		}
+		uring_submit (eng);
+		async_expire (eng);
+		return;
+	}
+#endif
+
+	for (;;) {
+		socklen_t fromLen = sizeof (eng->icmpRecv->from);
+		ssize_t len = recvfrom (eng->icmp.fd, (char *)eng->icmpRecv->buf, sizeof (eng->icmpRecv->buf), 0,
+								(struct sockaddr *)&eng->icmpRecv->from, &fromLen);
+
+		if (len < 0) {
+			break;
+		}
+		async_on_icmp (eng, eng->icmpRecv->buf, (int)len, eng->icmpRecv->from.sin_addr);
+	}
+	for (;;) {
+		ssize_t len = recv (eng->mdnsFd, (char *)eng->mdnsRecv->buf, sizeof (eng->mdnsRecv->buf), 0);
+
+		if (len < 0) {
+			break;
+		}
+		mdns_parse (eng->mdnsRecv->buf, (int)len, async_on_mdns_rr, eng);
+	}
+	async_retry_sends (eng);
+	async_expire (eng);
+}
+
+
+/**
+ * Function to wait until something may be ready, or the wait time passes.
+ */
+static void async_wait (wol_async *eng, int waitMs)
+{
+	struct pollfd pfd [2];
+	int n = 0;
+
+#if defined(WOL_HAVE_IO_URING)
+	if (eng->backend == WOL_ASYNC_IO_URING) {
+		/** The ring is readable while there are completions to reap. */
+		pfd [n].fd = eng->ringFd;
+		pfd [n++].events = POLLIN;
+	}
+	else
+#endif
+	{
+		pfd [n].fd = eng->icmp.fd;
+		pfd [n++].events = POLLIN;
+		pfd [n].fd = eng->mdnsFd;
+		pfd [n++].events = POLLIN;
+		if (eng->sendHead >= 0 && (waitMs < 0 || waitMs > 1)) {
+			waitMs = 1;
+		}
+	}
+	poll (pfd, n, waitMs);
+}
+
+
+/**
+ * Function to set a socket's blocking mode.
+ */
+static void async_set_nonblock (int fd, int on)
+{
+	int flags = fcntl (fd, F_GETFL, 0);
+
+	fcntl (fd, F_SETFL, on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+
+/**
+ * Function to create an asynchronous engine.
+ *
+ * @param maxOps - the maximum number of outstanding operations, at most 65536
+ * @param flags - WOL_ASYNC_POLL to force the poll backend, or 0 to use io_uring when available
+ *
+ * @return the new engine, or NULL on failure. Probes need an ICMP socket, see pingIPWithTimeout().
+ */
+wol_async *wol_async_create (int maxOps, int flags)
+{
+	wol_async *eng;
+	unsigned int buckets = 16;
+	int i, optval = 1;
+
+	if (maxOps <= 0 || maxOps > 65536) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if ((eng = calloc (1, sizeof (wol_async))) == NULL) {
+		return (NULL);
+	}
+	eng->maxOps = maxOps;
+	eng->wakeFd = eng->mdnsFd = eng->icmp.fd = -1;
+	eng->sendHead = eng->sendTail = -1;
+#if defined(WOL_HAVE_IO_URING)
+	eng->ringFd = -1;
+#endif
+
+	while (buckets < (unsigned int)maxOps) {
+		buckets <<= 1;
+	}
+	eng->hostMask = buckets - 1;
+
+	eng->ops = calloc (maxOps, sizeof (struct async_op));
+	eng->heap = malloc (maxOps * sizeof (int));
+	eng->hostHead = malloc (buckets * sizeof (int));
+	eng->results = malloc (maxOps * sizeof (wol_async_result));
+	eng->icmpRecv = malloc (sizeof (struct async_recv));
+	eng->mdnsRecv = malloc (sizeof (struct async_recv));
+	if (eng->ops == NULL || eng->heap == NULL || eng->hostHead == NULL || eng->results == NULL ||
+		eng->icmpRecv == NULL || eng->mdnsRecv == NULL) {
+		wol_async_destroy (eng);
+		return (NULL);
+	}
+	for (i = maxOps - 1; i >= 0; i--) {
+		eng->ops [i].heapIdx = -1;
+		async_free_op (eng, i);
+	}
+	memset (eng->hostHead, 0xff, buckets * sizeof (int));
+
+	/**
+     * Open the three sockets every operation shares: the wake broadcast
+     * socket, the ICMP echo socket, and the mDNS query socket.
+     */
+	if ((eng->wakeFd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0 ||
+		setsockopt (eng->wakeFd, SOL_SOCKET, SO_BROADCAST, (char *)&optval, sizeof (optval)) < 0 ||
+		(eng->mdnsFd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0 ||
+		icmp_open (&eng->icmp) < 0) {
+		wol_async_destroy (eng);
+		return (NULL);
+	}
+
+	eng->backend = WOL_ASYNC_POLL;
+#if defined(WOL_HAVE_IO_URING)
+	if (!(flags & WOL_ASYNC_POLL)) {
+		unsigned int entries = 8;
+
+		while (entries < (unsigned int)maxOps + 2 && entries < 32768) {
+			entries <<= 1;
+		}
+		if (uring_setup (eng, entries) == 0) {
+			eng->backend = WOL_ASYNC_IO_URING;
+		}
+		else {
+			eng->ringFd = -1;
+		}
+	}
+#else
+	(void)flags;
+#endif
+
+	/**
+     * The poll backend reads the sockets until they are empty, so they are
+     * non-blocking. io_uring waits on blocking sockets itself.
+     */
+	async_set_nonblock (eng->wakeFd, eng->backend == WOL_ASYNC_POLL);
+	async_set_nonblock (eng->mdnsFd, eng->backend == WOL_ASYNC_POLL);
+	async_set_nonblock (eng->icmp.fd, eng->backend == WOL_ASYNC_POLL);
+
+#if defined(WOL_HAVE_IO_URING)
+	if (eng->backend == WOL_ASYNC_IO_URING) {
+		if (uring_arm_recv (eng, eng->icmp.fd, eng->icmpRecv, UD_RECV_ICMP) < 0 ||
+			uring_arm_recv (eng, eng->mdnsFd, eng->mdnsRecv, UD_RECV_MDNS) < 0 ||
+			uring_submit (eng) < 0) {
+			wol_async_destroy (eng);
+			return (NULL);
+		}
+	}
+#endif
+
+	return (eng);
+}
+
+
+/**
+ * Function to release an asynchronous engine. Outstanding operations are
+ * abandoned without completing.
+ *
+ * @param eng - the engine to release, may be NULL
+ */
+void wol_async_destroy (wol_async *eng)
+{
+	if (eng == NULL) {
+		return;
+	}
+#if defined(WOL_HAVE_IO_URING)
+	/**
+     * Closing the ring cancels the in-flight requests before the buffers
+     * they point to are freed.
+     */
+	if (eng->ringFd >= 0) {
+		uring_teardown (eng);
+	}
+#endif
+	if (eng->wakeFd >= 0) {
+		close (eng->wakeFd);
+	}
+	if (eng->mdnsFd >= 0) {
+		close (eng->mdnsFd);
+	}
+	icmp_close (&eng->icmp);
+	free (eng->ops);
+	free (eng->heap);
+	free (eng->hostHead);
+	free (eng->results);
+	free (eng->icmpRecv);
+	free (eng->mdnsRecv);
+	free (eng);
+}
+
+
+/**
+ * Function to get the backend an engine uses.
+ *
+ * @param eng - the engine
+ *
+ * @return WOL_ASYNC_IO_URING or WOL_ASYNC_POLL
+ */
+int wol_async_backend (const wol_async *eng)
+{
+	return (eng->backend);
+}
+
+
+/**
+ * Function to get the number of operations that have not completed.
+ *
+ * @param eng - the engine
+ *
+ * @return the number of outstanding operations
+ */
+int wol_async_pending (const wol_async *eng)
+{
+	return (eng->pending);
+}
+
+
+/**
+ * Function to take a free op slot for a new operation. Fails when all
+ * slots are outstanding, or hold results waiting to be reaped.
+ */
+static int async_new_op (wol_async *eng, int type, wol_async_cb cb, void *arg)
+{
+	struct async_op *op;
+	int slot;
+
+	if (eng->freeList < 0 || eng->pending + eng->resCount >= eng->maxOps) {
+		errno = EAGAIN;
+		return (-1);
+	}
+	slot = eng->freeList;
+	op = &eng->ops [slot];
+	eng->freeList = op->next;
+
+	op->type = type;
+	op->state = OP_SENDING;
+	op->inflight = 0;
+	op->heapIdx = -1;
+	op->next = -1;
+	op->hostNext = -1;
+	op->cb = cb;
+	op->arg = arg;
+	op->start = async_now ();
+	memset (&op->sap, 0, sizeof (op->sap));
+	op->sap.sin_family = AF_INET;
+	eng->pending++;
+
+	return (slot);
+}
+
+
+/**
+ * Function to submit a magic packet send to a packed MAC address, to the
+ * broadcast address 255.255.255.255:60000 as send_wol() does.
+ *
+ * @param eng - the engine
+ * @param mac - the packed MAC address to wake
+ * @param cb - the completion callback, or NULL to queue the result for wol_async_reap()
+ * @param arg - the caller's argument, returned in the result
+ *
+ * @return 0 if submitted, -1 if the engine is full
+ */
+int wol_async_wake (wol_async *eng, wol_mac mac, wol_async_cb cb, void *arg)
+{
+	int slot = async_new_op (eng, WOL_ASYNC_WAKE, cb, arg);
+	struct async_op *op;
+
+	if (slot < 0) {
+		return (-1);
+	}
+	op = &eng->ops [slot];
+	op->sap.sin_addr.s_addr = htonl(0xffffffff);
+	op->sap.sin_port = htons(WOL_PORT);
+	wol_build_magic (mac, op->buf);
+	op->len = WOL_PACKET_LEN;
+
+	async_send (eng, slot);
+
+	return (0);
+}
+
+
+/**
+ * Function to submit an ICMP echo probe.
+ *
+ * @param eng - the engine
+ * @param ipAddr - the IP address to probe, in dotted decimal
+ * @param timeoutMs - the time to wait for the reply, in milliseconds
+ * @param cb - the completion callback, or NULL to queue the result for wol_async_reap()
+ * @param arg - the caller's argument, returned in the result
+ *
+ * @return 0 if submitted, -1 if the address is invalid or the engine is full
+ */
+int wol_async_probe (wol_async *eng, const char *ipAddr, int timeoutMs, wol_async_cb cb, void *arg)
+{
+	struct in_addr dst;
+	struct async_op *op;
+	int slot;
+
+	if (inet_pton (AF_INET, ipAddr, &dst) != 1) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((slot = async_new_op (eng, WOL_ASYNC_PROBE, cb, arg)) < 0) {
+		return (-1);
+	}
+	op = &eng->ops [slot];
+	op->sap.sin_addr = dst;
+	op->len = icmp_build_echo (&eng->icmp, (unsigned short)slot, op->buf);
+	op->deadline = op->start + (long long)timeoutMs * 1000;
+	heap_push (eng, slot);
+
+	async_send (eng, slot);
+
+	return (0);
+}
+
+
+/**
+ * Function to submit an mDNS device info query for a host, to the mDNS
+ * multicast group.
+ *
+ * @param eng - the engine
+ * @param host - the host name, without the service and domain
+ * @param timeoutMs - the time to wait for the response, in milliseconds
+ * @param cb - the completion callback, or NULL to queue the result for wol_async_reap()
+ * @param arg - the caller's argument, returned in the result
+ *
+ * @return 0 if submitted, -1 if the host name is invalid or the engine is full
+ */
+int wol_async_mdns (wol_async *eng, const char *host, int timeoutMs, wol_async_cb cb, void *arg)
+{
+	struct async_op *op;
+	unsigned int bucket;
+	char *hosts [1];
+	int slot, used, len;
+
+	if (strlen (host) >= ASYNC_MAX_HOST) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((slot = async_new_op (eng, WOL_ASYNC_MDNS, cb, arg)) < 0) {
+		return (-1);
+	}
+	op = &eng->ops [slot];
+	strcpy (op->host, host);
+	hosts [0] = op->host;
+
+	len = mdns_build_query (hosts, 1, MDNS_DEVICE_INFO, DNS_TYPE_TXT, op->buf, sizeof (op->buf), &used);
+	if (len < 0) {
+		eng->pending--;
+		async_free_op (eng, slot);
+		errno = EINVAL;
+		return (-1);
+	}
+	op->len = len;
+	inet_pton (AF_INET, MDNS_GROUP, &op->sap.sin_addr);
+	op->sap.sin_port = htons(MDNS_PORT);
+	op->deadline = op->start + (long long)timeoutMs * 1000;
+	heap_push (eng, slot);
+
+	op->hostHash = async_hash_host (host, (int)strlen (host));
+	bucket = op->hostHash & eng->hostMask;
+	op->hostNext = eng->hostHead [bucket];
+	eng->hostHead [bucket] = slot;
+
+	async_send (eng, slot);
+
+	return (0);
+}
+
+
+/**
+ * Function to drive the engine: hand the queued submissions to the kernel,
+ * process replies and completions, and expire timeouts. Waits up to the
+ * timeout for at least one operation to complete.
+ *
+ * @param eng - the engine
+ * @param timeoutMs - the longest time to wait, 0 to not wait, or -1 to wait
+ * until an operation completes
+ *
+ * @return the number of operations completed by this call
+ */
+int wol_async_poll (wol_async *eng, int timeoutMs)
+{
+	long long start = async_now ();
+
+	eng->delivered = 0;
+
+	for (;;) {
+		long long now;
+		int waitMs = timeoutMs;
+
+		async_process (eng);
+		if (eng->delivered > 0 || timeoutMs == 0 || eng->pending == 0) {
+			break;
+		}
+
+		/**
+		 * Wait no longer than the caller's timeout, nor past the earliest
+		 * operation deadline.
+		 */
+		now = async_now ();
+		if (timeoutMs > 0) {
+			waitMs = timeoutMs - (int)((now - start) / 1000);
+			if (waitMs <= 0) {
+				break;
+			}
+		}
+		if (eng->heapLen > 0) {
+			long long untilDeadline = (eng->ops [eng->heap [0]].deadline - now + 999) / 1000;
+
+			if (waitMs < 0 || untilDeadline < waitMs) {
+				waitMs = (int)untilDeadline;
+			}
+		}
+		async_wait (eng, waitMs);
+	}
+
+	return (eng->delivered);
+}
+
+
+/**
+ * Function to take the results of operations submitted without a callback.
+ *
+ * @param eng - the engine
+ * @param results - populated with the results
+ * @param max - the size of the results array
+ *
+ * @return the number of results taken
+ */
+int wol_async_reap (wol_async *eng, wol_async_result *results, int max)
+{
+	int n = 0;
+
+	while (n < max && eng->resCount > 0) {
+		results [n++] = eng->results [eng->resHead];
+		eng->resHead = (eng->resHead + 1) % eng->maxOps;
+		eng->resCount--;
+	}
+	return (n);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file wol_async.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_async.c
+ * @details Provides the types and function prototypes of the asynchronous engine.
+ * Wake sends, ICMP probes and mDNS device info queries are submitted without
+ * blocking, and complete through one completion path, on one thread.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_ASYNC_H
+#define WOL_ASYNC_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Operation types. */
+#define WOL_ASYNC_WAKE    1     /**< send a magic packet */
+#define WOL_ASYNC_PROBE   2     /**< ICMP echo, as pingIPWithTimeout() */
+#define WOL_ASYNC_MDNS    3     /**< device info query, as deviceInfoForHost() */
+
+/** Backends, for wol_async_create() flags and wol_async_backend(). */
+#define WOL_ASYNC_IO_URING  1   /**< io_uring, Linux 5.1 and later */
+#define WOL_ASYNC_POLL      2   /**< readiness polling, available everywhere */
+
+/**
+ * The result of a completed operation.
+ */
+typedef struct wol_async_result {
+	int op;                            /**< the operation type, WOL_ASYNC_* */
+	int status;                        /**< 0 success, 1 no answer in time, -1 failed to send */
+	long rttUsec;                      /**< probes and queries: time to the answer */
+	void *arg;                         /**< the caller's argument */
+	char devInfo [WOL_DEVINFO_LEN];    /**< queries: the device info */
+} wol_async_result;
+
+/**
+ * The completion callback. Invoked from wol_async_poll(), on the polling thread.
+ */
+typedef void (*wol_async_cb) (const wol_async_result *result);
+
+/** Opaque asynchronous engine. */
+typedef struct wol_async wol_async;
+
+wol_async *wol_async_create (int maxOps, int flags);
+void wol_async_destroy (wol_async *eng);
+int wol_async_backend (const wol_async *eng);
+int wol_async_wake (wol_async *eng, wol_mac mac, wol_async_cb cb, void *arg);
+int wol_async_probe (wol_async *eng, const char *ipAddr, int timeoutMs, wol_async_cb cb, void *arg);
+int wol_async_mdns (wol_async *eng, const char *host, int timeoutMs, wol_async_cb cb, void *arg);
+int wol_async_poll (wol_async *eng, int timeoutMs);
+int wol_async_reap (wol_async *eng, wol_async_result *results, int max);
+int wol_async_pending (const wol_async *eng);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_ASYNC_H */
@@ -0,0 +1,582 @@
+/**
+ * @file wol_cache.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Caches the results of the MAC address, ping and device information lookups.
+ * @details The cache is split into shards by the hash of the key, each an
+ * open addressing hash table under its own lock, so lookups from many
+ * threads rarely wait on each other. Each result is kept for the TTL of its
+ * kind, and failures, such as "no MAC found", for a shorter negative TTL.
+ * When a shard is full, expired results are dropped first, then the one
+ * closest to expiring. The cache is off until wol_cache_enable().
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_SHARDS        16         /**< a power of two */
+#define CACHE_DEF_CAPACITY  4096
+
+
+/**
+ * One cached result. The key and the value are NUL terminated.
+ */
+struct cache_entry {
+	int64_t expires;                   /**< monotonic milliseconds */
+	uint32_t hash;
+	uint8_t used;
+	uint8_t kind;
+	uint8_t status;                    /**< 0 a result, 1 a cached failure */
+	char key [WOL_CACHE_KEY_LEN];
+	char value [WOL_CACHE_VALUE_LEN];
+};
+
+/**
+ * A shard: an open addressing hash table with linear probing and
+ * backward-shift deletion, and its totals, all under one lock.
+ */
+struct cache_shard {
+	pthread_mutex_t lock;
+	struct cache_entry *slots;
+	unsigned int mask;                 /**< the number of slots minus one */
+	unsigned int count;
+	unsigned int capacity;             /**< the most entries held, half the slots */
+	uint64_t hits [WOL_CACHE_KINDS];
+	uint64_t negativeHits [WOL_CACHE_KINDS];
+	uint64_t misses [WOL_CACHE_KINDS];
+	uint64_t evictions;
+} __attribute__((aligned(64)));
+
+/** The TTLs, in milliseconds, of the results and the failures of each kind. */
+static int cacheTtl [WOL_CACHE_KINDS] = { 300000, 10000, 3600000 };
+static int cacheNegTtl [WOL_CACHE_KINDS] = { 30000, 5000, 60000 };
+
+/** The shards, or NULL while the cache is off. */
+static struct cache_shard *cacheShards;
+
+/**
+ * The shards once allocated. They are never freed, as a lookup in another
+ * thread may still hold them after the cache is turned off.
+ */
+static struct cache_shard *cacheStore;
+
+/** Serializes enabling and disabling. */
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Function to read a clock in milliseconds.
+ */
+static int64_t cache_now_ms (clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime (clock, &ts);
+	return ((int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+/**
+ * Function to hash a key of a kind.
+ */
+static uint32_t cache_hash (int kind, const char *key)
+{
+	uint32_t h = 2166136261u ^ (uint32_t)kind;
+
+	while (*key != '\0') {
+		h = (h ^ (unsigned char)*key++) * 16777619u;
+	}
+	return (h ^ (h >> 15));
+}
+
+
+/**
+ * Function to find a key's slot, or the empty slot ending its probe sequence.
+ * Called with the shard lock held.
+ */
+static unsigned int cache_find (struct cache_shard *shard, uint32_t hash, int kind, const char *key)
+{
+	unsigned int slot = (hash >> 4) & shard->mask;
+
+	while (shard->slots [slot].used &&
+		   (shard->slots [slot].hash != hash || shard->slots [slot].kind != kind ||
+			strcmp (shard->slots [slot].key, key) != 0)) {
+		slot = (slot + 1) & shard->mask;
+	}
+	return (slot);
+}
+
+
+/**
+ * Function to empty a slot, and shift the entries after it in its probe
+ * sequence back, so lookups need no tombstones. Called with the shard lock
+ * held.
+ */
+static void cache_remove (struct cache_shard *shard, unsigned int slot)
+{
+	unsigned int next;
+
+	for (next = (slot + 1) & shard->mask; shard->slots [next].used; next = (next + 1) & shard->mask) {
+		unsigned int home = (shard->slots [next].hash >> 4) & shard->mask;
+
+		if (((next - home) & shard->mask) >= ((next - slot) & shard->mask)) {
+			shard->slots [slot] = shard->slots [next];
+			slot = next;
+		}
+	}
+	shard->slots [slot].used = 0;
+	shard->count--;
+}
+
+
+/**
+ * Function to make room in a full shard: drop the expired entries, or if
+ * there are none, the entry closest to expiring. Called with the shard lock
+ * held.
+ */
+static void cache_make_room (struct cache_shard *shard, int64_t now)
+{
+	unsigned int slot, oldest = 0;
+	int64_t oldestExpires = INT64_MAX;
+	int dropped = 0;
+
+	/**
+     * Removal shifts entries back into the freed slot, so the slot is
+     * examined again before moving on.
+     */
+	for (slot = 0; slot <= shard->mask; ) {
+		if (shard->slots [slot].used && shard->slots [slot].expires <= now) {
+			cache_remove (shard, slot);
+			dropped++;
+			continue;
+		}
+		if (shard->slots [slot].used && shard->slots [slot].expires < oldestExpires) {
+			oldestExpires = shard->slots [slot].expires;
+			oldest = slot;
+		}
+		slot++;
+	}
+	if (dropped == 0 && shard->count > 0) {
+		cache_remove (shard, oldest);
+		shard->evictions++;
+	}
+}
+
+
+/**
+ * Function to store an entry. Called with the shard lock held.
+ */
+static void cache_store (struct cache_shard *shard, uint32_t hash, int kind, const char *key,
+						 int status, const char *value, int64_t expires)
+{
+	unsigned int slot = cache_find (shard, hash, kind, key);
+	struct cache_entry *e;
+
+	if (!shard->slots [slot].used) {
+		if (shard->count >= shard->capacity) {
+			cache_make_room (shard, cache_now_ms (CLOCK_MONOTONIC));
+			slot = cache_find (shard, hash, kind, key);
+		}
+		shard->count++;
+	}
+	e = &shard->slots [slot];
+	e->used = 1;
+	e->hash = hash;
+	e->kind = (uint8_t)kind;
+	e->status = (uint8_t)(status != 0);
+	e->expires = expires;
+	strcpy (e->key, key);
+	strncpy (e->value, value != NULL ? value : "", WOL_CACHE_VALUE_LEN - 1);
+	e->value [WOL_CACHE_VALUE_LEN - 1] = '\0';
+}
+
+
+/**
+ * Function to turn the cache on. The results of macForIP(), pingIP() and
+ * deviceInfoForHost() are kept from now on.
+ *
+ * @param capacity - the most results held, 0 for the default 4096. Only the
+ * first call sets it; turning the cache back on reuses the same shards.
+ *
+ * @return 0 on success, or -1 on failure to allocate. Enabling again keeps the cache.
+ */
+int wol_cache_enable (int capacity)
+{
+	struct cache_shard *shards;
+	unsigned int perShard, slots = 16;
+	int i;
+
+	pthread_mutex_lock (&cacheLock);
+	if (cacheShards != NULL) {
+		pthread_mutex_unlock (&cacheLock);
+		return (0);
+	}
+
+	/** Turned back on: start empty, with the totals reset. */
+	if ((shards = cacheStore) != NULL) {
+		for (i = 0; i < CACHE_SHARDS; i++) {
+			pthread_mutex_lock (&shards [i].lock);
+			memset (shards [i].slots, 0, (size_t)(shards [i].mask + 1) * sizeof (struct cache_entry));
+			shards [i].count = 0;
+			memset (shards [i].hits, 0, sizeof (shards [i].hits));
+			memset (shards [i].negativeHits, 0, sizeof (shards [i].negativeHits));
+			memset (shards [i].misses, 0, sizeof (shards [i].misses));
+			shards [i].evictions = 0;
+			pthread_mutex_unlock (&shards [i].lock);
+		}
+		__atomic_store_n (&cacheShards, shards, __ATOMIC_RELEASE);
+		pthread_mutex_unlock (&cacheLock);
+		return (0);
+	}
+	if (capacity <= 0) {
+		capacity = CACHE_DEF_CAPACITY;
+	}
+	perShard = (capacity + CACHE_SHARDS - 1) / CACHE_SHARDS;
+	while (slots < perShard * 2) {
+		slots <<= 1;
+	}
+
+	if (posix_memalign ((void **)&shards, 64, CACHE_SHARDS * sizeof (struct cache_shard)) != 0) {
+		pthread_mutex_unlock (&cacheLock);
+		return (-1);
+	}
+	memset (shards, 0, CACHE_SHARDS * sizeof (struct cache_shard));
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		if ((shards [i].slots = calloc (slots, sizeof (struct cache_entry))) == NULL) {
+			while (--i >= 0) {
+				free (shards [i].slots);
+			}
+			free (shards);
+			pthread_mutex_unlock (&cacheLock);
+			return (-1);
+		}
+		pthread_mutex_init (&shards [i].lock, NULL);
+		shards [i].mask = slots - 1;
+		shards [i].capacity = perShard;
+	}
+	cacheStore = shards;
+	__atomic_store_n (&cacheShards, shards, __ATOMIC_RELEASE);
+	pthread_mutex_unlock (&cacheLock);
+
+	return (0);
+}
+
+
+/**
+ * Function to turn the cache off. Lookups stop using it from now on; the
+ * ones already running in other threads finish on the shards, which are
+ * kept for when the cache is turned back on.
+ */
+void wol_cache_disable (void)
+{
+	pthread_mutex_lock (&cacheLock);
+	__atomic_store_n (&cacheShards, NULL, __ATOMIC_RELEASE);
+	pthread_mutex_unlock (&cacheLock);
+}
+
+
+/**
+ * Function to set the TTLs of a kind of lookup. They apply to the results
+ * stored from now on.
+ *
+ * @param kind - WOL_CACHE_MAC, WOL_CACHE_PING or WOL_CACHE_DEVINFO
+ * @param ttlMs - how long a result is kept, 0 not to cache them
+ * @param negativeTtlMs - how long a failure is kept, 0 not to cache them
+ *
+ * @return 0 on success, or -1 if the kind is not valid
+ */
+int wol_cache_set_ttl (int kind, int ttlMs, int negativeTtlMs)
+{
+	if (kind < 0 || kind >= WOL_CACHE_KINDS) {
+		errno = EINVAL;
+		return (-1);
+	}
+	__atomic_store_n (&cacheTtl [kind], ttlMs > 0 ? ttlMs : 0, __ATOMIC_RELAXED);
+	__atomic_store_n (&cacheNegTtl [kind], negativeTtlMs > 0 ? negativeTtlMs : 0, __ATOMIC_RELAXED);
+	return (0);
+}
+
+
+/**
+ * Function to look up a cached result.
+ *
+ * @param kind - WOL_CACHE_MAC, WOL_CACHE_PING or WOL_CACHE_DEVINFO
+ * @param key - the IP address or host name
+ * @param value - populated with the cached value, may be NULL
+ * @param len - the size of the value buffer
+ * @param status - populated with 0 for a result, or 1 for a cached failure
+ *
+ * @return 0 on a hit, or -1 on a miss, or if the cache is off
+ */
+int wol_cache_get (int kind, const char *key, char *value, size_t len, int *status)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE), *shard;
+	unsigned int slot;
+	uint32_t hash;
+	int rc = -1;
+
+	if (shards == NULL || kind < 0 || kind >= WOL_CACHE_KINDS || strlen (key) >= WOL_CACHE_KEY_LEN) {
+		return (-1);
+	}
+	hash = cache_hash (kind, key);
+	shard = &shards [hash & (CACHE_SHARDS - 1)];
+
+	pthread_mutex_lock (&shard->lock);
+	slot = cache_find (shard, hash, kind, key);
+	if (shard->slots [slot].used && shard->slots [slot].expires <= cache_now_ms (CLOCK_MONOTONIC)) {
+		cache_remove (shard, slot);
+	}
+	else if (shard->slots [slot].used && (value == NULL || strlen (shard->slots [slot].value) < len)) {
+		if (value != NULL) {
+			strcpy (value, shard->slots [slot].value);
+		}
+		*status = shard->slots [slot].status;
+		if (*status == 0) {
+			shard->hits [kind]++;
+		}
+		else {
+			shard->negativeHits [kind]++;
+		}
+		rc = 0;
+	}
+	if (rc != 0) {
+		shard->misses [kind]++;
+	}
+	pthread_mutex_unlock (&shard->lock);
+
+	return (rc);
+}
+
+
+/**
+ * Function to store a result, for the TTL of its kind.
+ *
+ * @param kind - WOL_CACHE_MAC, WOL_CACHE_PING or WOL_CACHE_DEVINFO
+ * @param key - the IP address or host name
+ * @param status - 0 for a result, or 1 for a failure, kept for the negative TTL
+ * @param value - the value, NULL or "" if there is none
+ */
+void wol_cache_put (int kind, const char *key, int status, const char *value)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE), *shard;
+	uint32_t hash;
+	int ttl;
+
+	if (shards == NULL || kind < 0 || kind >= WOL_CACHE_KINDS || strlen (key) >= WOL_CACHE_KEY_LEN) {
+		return;
+	}
+	ttl = __atomic_load_n (status == 0 ? &cacheTtl [kind] : &cacheNegTtl [kind], __ATOMIC_RELAXED);
+	if (ttl <= 0) {
+		return;
+	}
+	hash = cache_hash (kind, key);
+	shard = &shards [hash & (CACHE_SHARDS - 1)];
+
+	pthread_mutex_lock (&shard->lock);
+	cache_store (shard, hash, kind, key, status, value, cache_now_ms (CLOCK_MONOTONIC) + ttl);
+	pthread_mutex_unlock (&shard->lock);
+}
+
+
+/**
+ * Function to drop every cached result. The totals are kept.
+ */
+void wol_cache_clear (void)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE);
+	int i;
+
+	for (i = 0; shards != NULL && i < CACHE_SHARDS; i++) {
+		pthread_mutex_lock (&shards [i].lock);
+		memset (shards [i].slots, 0, (size_t)(shards [i].mask + 1) * sizeof (struct cache_entry));
+		shards [i].count = 0;
+		pthread_mutex_unlock (&shards [i].lock);
+	}
+}
+
+
+/**
+ * Function to read the cache's totals, summed over the shards.
+ *
+ * @param stats - populated with the totals, all zero if the cache is off
+ */
+void wol_cache_get_stats (wol_cache_stats *stats)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE);
+	int i, k;
+
+	memset (stats, 0, sizeof (*stats));
+	for (i = 0; shards != NULL && i < CACHE_SHARDS; i++) {
+		pthread_mutex_lock (&shards [i].lock);
+		for (k = 0; k < WOL_CACHE_KINDS; k++) {
+			stats->hits [k] += shards [i].hits [k];
+			stats->negativeHits [k] += shards [i].negativeHits [k];
+			stats->misses [k] += shards [i].misses [k];
+		}
+		stats->entries += shards [i].count;
+		stats->evictions += shards [i].evictions;
+		pthread_mutex_unlock (&shards [i].lock);
+	}
+}
+
+
+/**
+ * Function to save the unexpired results to a snapshot file. The file is
+ * written under a temporary name, and renamed over the path, so a reader
+ * never sees a partial file. Expiry times are saved as wall clock times.
+ *
+ * @param path - the snapshot file
+ *
+ * @return the number of results saved, or -1 on failure
+ */
+int wol_cache_save (const char *path)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE);
+	struct wol_cache_header hdr;
+	int64_t mono = cache_now_ms (CLOCK_MONOTONIC), wall = cache_now_ms (CLOCK_REALTIME);
+	char *tmpPath;
+	FILE *fp;
+	unsigned int slot;
+	int i, ok = 1;
+
+	if (shards == NULL) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((tmpPath = malloc (strlen (path) + 5)) == NULL) {
+		return (-1);
+	}
+	sprintf (tmpPath, "%s.tmp", path);
+	if ((fp = fopen (tmpPath, "wb")) == NULL) {
+		free (tmpPath);
+		return (-1);
+	}
+
+	/** The count is filled in once the records are written. */
+	memset (&hdr, 0, sizeof (hdr));
+	memcpy (hdr.magic, WOL_CACHE_MAGIC, sizeof (hdr.magic));
+	hdr.version = WOL_CACHE_VERSION;
+	hdr.byteOrder = WOL_CACHE_BYTEORDER;
+	ok = (fwrite (&hdr, sizeof (hdr), 1, fp) == 1);
+
+	for (i = 0; ok && i < CACHE_SHARDS; i++) {
+		pthread_mutex_lock (&shards [i].lock);
+		for (slot = 0; ok && slot <= shards [i].mask; slot++) {
+			struct cache_entry *e = &shards [i].slots [slot];
+			struct wol_cache_record rec;
+
+			if (!e->used || e->expires <= mono) {
+				continue;
+			}
+			memset (&rec, 0, sizeof (rec));
+			rec.expires = e->expires - mono + wall;
+			rec.kind = e->kind;
+			rec.status = e->status;
+			rec.keyLen = (uint8_t)strlen (e->key);
+			rec.valueLen = (uint8_t)strlen (e->value);
+			ok = (fwrite (&rec, sizeof (rec), 1, fp) == 1 &&
+				  fwrite (e->key, 1, rec.keyLen, fp) == rec.keyLen &&
+				  fwrite (e->value, 1, rec.valueLen, fp) == rec.valueLen);
+			hdr.count++;
+		}
+		pthread_mutex_unlock (&shards [i].lock);
+	}
+
+	if (!ok || fseek (fp, 0, SEEK_SET) != 0 || fwrite (&hdr, sizeof (hdr), 1, fp) != 1) {
+		ok = 0;
+	}
+	if (fclose (fp) != 0 || !ok || rename (tmpPath, path) != 0) {
+		unlink (tmpPath);
+		free (tmpPath);
+		return (-1);
+	}
+	free (tmpPath);
+
+	return ((int)hdr.count);
+}
+
+
+/**
+ * Function to load a snapshot file into the cache, so a restarted program
+ * starts warm. The results that expired since the file was saved are
+ * skipped. The cache must be enabled.
+ *
+ * @param path - the snapshot file, see wol_cache_save()
+ *
+ * @return the number of results loaded, or -1 if the file cannot be read or is not a snapshot
+ */
+int wol_cache_load (const char *path)
+{
+	struct cache_shard *shards = __atomic_load_n (&cacheShards, __ATOMIC_ACQUIRE);
+	struct wol_cache_header hdr;
+	int64_t mono = cache_now_ms (CLOCK_MONOTONIC), wall = cache_now_ms (CLOCK_REALTIME);
+	FILE *fp;
+	uint32_t i;
+	int loaded = 0;
+
+	if (shards == NULL) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((fp = fopen (path, "rb")) == NULL) {
+		return (-1);
+	}
+	if (fread (&hdr, sizeof (hdr), 1, fp) != 1 || memcmp (hdr.magic, WOL_CACHE_MAGIC, sizeof (hdr.magic)) != 0 ||
+		hdr.version != WOL_CACHE_VERSION || hdr.byteOrder != WOL_CACHE_BYTEORDER) {
+		fclose (fp);
+		errno = EINVAL;
+		return (-1);
+	}
+
+	for (i = 0; i < hdr.count; i++) {
+		struct wol_cache_record rec;
+		struct cache_shard *shard;
+		char key [WOL_CACHE_KEY_LEN], value [WOL_CACHE_VALUE_LEN];
+		uint32_t hash;
+
+		if (fread (&rec, sizeof (rec), 1, fp) != 1 || rec.kind >= WOL_CACHE_KINDS ||
+			rec.keyLen >= WOL_CACHE_KEY_LEN || rec.valueLen >= WOL_CACHE_VALUE_LEN ||
+			fread (key, 1, rec.keyLen, fp) != rec.keyLen || fread (value, 1, rec.valueLen, fp) != rec.valueLen) {
+			break;
+		}
+		key [rec.keyLen] = '\0';
+		value [rec.valueLen] = '\0';
+		if (rec.expires <= wall) {
+			continue;
+		}
+
+		hash = cache_hash (rec.kind, key);
+		shard = &shards [hash & (CACHE_SHARDS - 1)];
+		pthread_mutex_lock (&shard->lock);
+		cache_store (shard, hash, rec.kind, key, rec.status, value, rec.expires - wall + mono);
+		pthread_mutex_unlock (&shard->lock);
+		loaded++;
+	}
+	fclose (fp);
+
+	return (loaded);
+}
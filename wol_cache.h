@@ -0,0 +1,100 @@
+/**
+ * @file wol_cache.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_cache.c
+ * @details Provides the function prototypes of the lookup result cache. Once
+ * enabled, the results of macForIP(), pingIP() and deviceInfoForHost() are
+ * kept for a configurable TTL per kind of lookup, failures included, so
+ * repeated lookups of the same hosts are answered from memory. The cache can
+ * be saved to a compact snapshot file, and loaded at startup.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_CACHE_H
+#define WOL_CACHE_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The kinds of lookup cached. */
+#define WOL_CACHE_MAC        0   /**< macForIP(), keyed by IP address */
+#define WOL_CACHE_PING       1   /**< pingIP(), keyed by IP address */
+#define WOL_CACHE_DEVINFO    2   /**< deviceInfoForHost(), keyed by host name */
+#define WOL_CACHE_KINDS      3
+
+#define WOL_CACHE_KEY_LEN    64  /**< longer keys are not cached */
+#define WOL_CACHE_VALUE_LEN  WOL_DEVINFO_LEN
+
+#define WOL_CACHE_MAGIC      "WOLCACHE"
+#define WOL_CACHE_VERSION    1
+#define WOL_CACHE_BYTEORDER  0x01020304u
+
+/**
+ * The snapshot file header, followed by count records. Each record is a
+ * struct wol_cache_record, then the key and the value, not NUL terminated.
+ */
+struct wol_cache_header {
+	char magic [8];                    /**< WOL_CACHE_MAGIC */
+	uint32_t version;                  /**< WOL_CACHE_VERSION */
+	uint32_t byteOrder;                /**< WOL_CACHE_BYTEORDER, as written */
+	uint32_t count;                    /**< the number of records */
+	uint32_t reserved;
+};
+
+/**
+ * A snapshot record, 16 bytes.
+ */
+struct wol_cache_record {
+	int64_t expires;                   /**< milliseconds since the epoch */
+	uint8_t kind;                      /**< WOL_CACHE_MAC, ... */
+	uint8_t status;                    /**< 0 a result, 1 a cached failure */
+	uint8_t keyLen;
+	uint8_t valueLen;
+	uint32_t reserved;
+};
+
+/**
+ * The cache's totals. A negative hit is a hit on a cached failure.
+ */
+typedef struct wol_cache_stats {
+	uint64_t hits [WOL_CACHE_KINDS];
+	uint64_t negativeHits [WOL_CACHE_KINDS];
+	uint64_t misses [WOL_CACHE_KINDS];
+	uint64_t entries;                  /**< results held */
+	uint64_t evictions;                /**< results dropped to make room */
+} wol_cache_stats;
+
+int wol_cache_enable (int capacity);
+void wol_cache_disable (void);
+int wol_cache_set_ttl (int kind, int ttlMs, int negativeTtlMs);
+int wol_cache_get (int kind, const char *key, char *value, size_t len, int *status);
+void wol_cache_put (int kind, const char *key, int status, const char *value);
+void wol_cache_clear (void);
+void wol_cache_get_stats (wol_cache_stats *stats);
+int wol_cache_save (const char *path);
+int wol_cache_load (const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_CACHE_H */
@@ -0,0 +1,561 @@
+/**
+ * @file wol_fanout.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Subnet-directed broadcast fan-out across the local interfaces.
+ * @details send_wol() sends to 255.255.255.255, which only leaves through the
+ * default route's interface. The fan-out enumerates the IPv4 interface
+ * addresses once with getifaddrs(), and keeps a wake context per subnet,
+ * sending to the subnet broadcast address, so the kernel sends each packet
+ * out of the interface the subnet is on.
+ * Each MAC address is routed to the subnet of its IP address, found in an
+ * attached inventory, or in neighbor data learned from a neighbor table
+ * snapshot. MAC addresses with no known IP address, or one on no local
+ * subnet, are sent on every subnet unless WOL_FANOUT_NO_SPRAY is set.
+ * Each subnet has a worker thread, so the sends to all subnets run in
+ * parallel. A fan-out must only be used from one thread at a time.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_fanout.h"
+#include "neigh.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define FANOUT_CHUNK      256          /**< packets built and sent per send call */
+#define FANOUT_PORT       60000
+
+
+/**
+ * One local subnet, with its wake context and worker.
+ */
+struct fanout_subnet {
+	wol_fanout *fan;
+	char ifName [IF_NAMESIZE];
+	uint32_t addr;                     /**< the interface address, network byte order */
+	uint32_t mask;                     /**< the netmask, network byte order */
+	uint32_t bcast;                    /**< the broadcast address, network byte order */
+	wol_ctx *ctx;
+	pthread_t thread;
+	int started;
+
+	int *jobs;                         /**< indexes into the current send's MACs */
+	int jobCount;
+	int jobCap;
+	int *jobStatus;                    /**< the result of each job */
+	unsigned char (*packets) [WOL_PACKET_LEN];
+};
+
+
+/**
+ * The subnet fan-out.
+ */
+struct wol_fanout {
+	struct fanout_subnet *subnets;
+	int count;
+	int flags;
+
+	const wol_inventory *inv;
+	struct {                           /**< learned MAC to IP map, open addressing */
+		wol_mac *macs;
+		uint32_t *ips;                 /**< 0 if the slot is empty */
+		uint32_t mask;
+	} learned;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;               /**< signalled when a send starts, or on shutdown */
+	pthread_cond_t done;               /**< signalled when a worker finishes */
+	unsigned long generation;          /**< incremented for each send */
+	int busy;                          /**< workers still sending */
+	int shutdown;
+	const wol_mac *macs;               /**< the current send's MACs */
+};
+
+
+/**
+ * Function to send one subnet's jobs, in chunks of built packets.
+ */
+static void fanout_send_subnet (wol_fanout *fan, struct fanout_subnet *sub)
+{
+	const unsigned char *packets [FANOUT_CHUNK];
+	int i, j;
+
+	for (i = 0; i < sub->jobCount; i += FANOUT_CHUNK) {
+		int n = sub->jobCount - i;
+
+		if (n > FANOUT_CHUNK) {
+			n = FANOUT_CHUNK;
+		}
+		for (j = 0; j < n; j++) {
+			wol_build_magic (fan->macs [sub->jobs [i + j]], sub->packets [j]);
+			packets [j] = sub->packets [j];
+		}
+		wol_ctx_send_packets (sub->ctx, packets, n, sub->jobStatus + i);
+	}
+}
+
+
+/**
+ * A subnet's worker thread. Waits for a send, sends the subnet's jobs, and
+ * reports back.
+ */
+static void *fanout_worker (void *arg)
+{
+	struct fanout_subnet *sub = arg;
+	wol_fanout *fan = sub->fan;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock (&fan->lock);
+	for (;;) {
+		while (!fan->shutdown && fan->generation == seen) {
+			pthread_cond_wait (&fan->work, &fan->lock);
+		}
+		if (fan->shutdown) {
+			break;
+		}
+		seen = fan->generation;
+		pthread_mutex_unlock (&fan->lock);
+
+		fanout_send_subnet (fan, sub);
+
+		pthread_mutex_lock (&fan->lock);
+		if (--fan->busy == 0) {
+			pthread_cond_signal (&fan->done);
+		}
+	}
+	pthread_mutex_unlock (&fan->lock);
+
+	return (NULL);
+}
+
+
+/**
+ * Function to create a subnet fan-out: enumerate the IPv4 interface
+ * addresses that are up and support broadcast, and start a worker for each.
+ *
+ * @param port - the UDP port to send to, 0 for the default 60000
+ * @param flags - WOL_FANOUT_NO_SPRAY, or 0
+ *
+ * @return the new fan-out, or NULL if there is no broadcast subnet or on failure
+ */
+wol_fanout *wol_fanout_create (int port, int flags)
+{
+	struct ifaddrs *ifList, *ifa;
+	wol_fanout *fan;
+	int n = 0, i;
+
+	if (getifaddrs (&ifList) < 0) {
+		return (NULL);
+	}
+	for (ifa = ifList; ifa != NULL; ifa = ifa->ifa_next) {
+		if (ifa->ifa_addr != NULL && ifa->ifa_addr->sa_family == AF_INET) {
+			n++;
+		}
+	}
+	if ((fan = calloc (1, sizeof (wol_fanout))) == NULL ||
+		(n > 0 && (fan->subnets = calloc (n, sizeof (struct fanout_subnet))) == NULL)) {
+		free (fan);
+		freeifaddrs (ifList);
+		return (NULL);
+	}
+	fan->flags = flags;
+	pthread_mutex_init (&fan->lock, NULL);
+	pthread_cond_init (&fan->work, NULL);
+	pthread_cond_init (&fan->done, NULL);
+
+	for (ifa = ifList; ifa != NULL; ifa = ifa->ifa_next) {
+		struct fanout_subnet *sub;
+		char bcastAddr [INET_ADDRSTRLEN];
+
+		if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET ||
+			ifa->ifa_netmask == NULL || ifa->ifa_broadaddr == NULL ||
+			(ifa->ifa_flags & (IFF_UP | IFF_BROADCAST | IFF_LOOPBACK)) != (IFF_UP | IFF_BROADCAST)) {
+			continue;
+		}
+		sub = &fan->subnets [fan->count];
+		sub->fan = fan;
+		strncpy (sub->ifName, ifa->ifa_name, IF_NAMESIZE - 1);
+		sub->addr = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr;
+		sub->mask = ((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr.s_addr;
+		sub->bcast = ((struct sockaddr_in *)ifa->ifa_broadaddr)->sin_addr.s_addr;
+		inet_ntop (AF_INET, &sub->bcast, bcastAddr, sizeof (bcastAddr));
+
+		sub->packets = malloc (FANOUT_CHUNK * WOL_PACKET_LEN);
+		if (sub->packets == NULL ||
+			(sub->ctx = wol_ctx_create (bcastAddr, port > 0 ? port : FANOUT_PORT)) == NULL) {
+			free (sub->packets);
+			continue;
+		}
+		fan->count++;
+	}
+	freeifaddrs (ifList);
+
+	if (fan->count == 0) {
+		wol_fanout_destroy (fan);
+		errno = ENODEV;
+		return (NULL);
+	}
+	for (i = 0; i < fan->count; i++) {
+		if (pthread_create (&fan->subnets [i].thread, NULL, fanout_worker, &fan->subnets [i]) != 0) {
+			wol_fanout_destroy (fan);
+			return (NULL);
+		}
+		fan->subnets [i].started = 1;
+	}
+
+	return (fan);
+}
+
+
+/**
+ * Function to stop the workers and release a fan-out.
+ *
+ * @param fan - the fan-out to release, may be NULL
+ */
+void wol_fanout_destroy (wol_fanout *fan)
+{
+	int i;
+
+	if (fan == NULL) {
+		return;
+	}
+	pthread_mutex_lock (&fan->lock);
+	fan->shutdown = 1;
+	pthread_cond_broadcast (&fan->work);
+	pthread_mutex_unlock (&fan->lock);
+
+	for (i = 0; i < fan->count; i++) {
+		struct fanout_subnet *sub = &fan->subnets [i];
+
+		if (sub->started) {
+			pthread_join (sub->thread, NULL);
+		}
+		wol_ctx_destroy (sub->ctx);
+		free (sub->packets);
+		free (sub->jobs);
+		free (sub->jobStatus);
+	}
+	pthread_cond_destroy (&fan->done);
+	pthread_cond_destroy (&fan->work);
+	pthread_mutex_destroy (&fan->lock);
+	free (fan->learned.macs);
+	free (fan->learned.ips);
+	free (fan->subnets);
+	free (fan);
+}
+
+
+/**
+ * Function to get the number of subnets the fan-out sends to.
+ *
+ * @param fan - the fan-out
+ *
+ * @return the number of subnets
+ */
+int wol_fanout_count (const wol_fanout *fan)
+{
+	return (fan->count);
+}
+
+
+/**
+ * Function to describe one of the fan-out's subnets.
+ *
+ * @param fan - the fan-out
+ * @param index - the subnet, from 0 to wol_fanout_count() - 1
+ * @param ifName - populated with the interface name, IF_NAMESIZE bytes; may be NULL
+ * @param bcastAddr - populated with the broadcast address, 16 bytes; may be NULL
+ *
+ * @return 0 on success, -1 if the index is out of range
+ */
+int wol_fanout_subnet (const wol_fanout *fan, int index, char *ifName, char *bcastAddr)
+{
+	if (index < 0 || index >= fan->count) {
+		return (-1);
+	}
+	if (ifName != NULL) {
+		strcpy (ifName, fan->subnets [index].ifName);
+	}
+	if (bcastAddr != NULL) {
+		inet_ntop (AF_INET, &fan->subnets [index].bcast, bcastAddr, INET_ADDRSTRLEN);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to find the subnet an IP address is on, preferring the longest
+ * netmask where subnets overlap.
+ */
+static int fanout_route_ip (const wol_fanout *fan, uint32_t ip)
+{
+	uint32_t bestMask = 0;
+	int best = -1, i;
+
+	for (i = 0; i < fan->count; i++) {
+		const struct fanout_subnet *sub = &fan->subnets [i];
+
+		if ((ip & sub->mask) == (sub->addr & sub->mask) &&
+			(best < 0 || ntohl(sub->mask) > ntohl(bestMask))) {
+			best = i;
+			bestMask = sub->mask;
+		}
+	}
+	return (best);
+}
+
+
+/**
+ * Function to find the subnet an IP address is on.
+ *
+ * @param fan - the fan-out
+ * @param ipAddr - the IP address, in dotted decimal
+ *
+ * @return the subnet index, or -1 if the address is on no local subnet
+ */
+int wol_fanout_route (const wol_fanout *fan, const char *ipAddr)
+{
+	struct in_addr addr;
+
+	if (inet_pton (AF_INET, ipAddr, &addr) != 1) {
+		return (-1);
+	}
+	return (fanout_route_ip (fan, addr.s_addr));
+}
+
+
+/**
+ * Function to learn the IP address of each MAC address in a neighbor table
+ * snapshot, for routing. Replaces what was learned before.
+ *
+ * @param fan - the fan-out
+ * @param table - the snapshot, see neighTableLoad()
+ *
+ * @return the number of MAC addresses learned, or -1 on failure to allocate
+ */
+int wol_fanout_learn (wol_fanout *fan, const wol_neigh_table *table)
+{
+	uint32_t slots = 16, mask, i;
+	wol_mac *macs;
+	uint32_t *ips;
+	int learned = 0;
+
+	while (slots < table->count * 2) {
+		slots <<= 1;
+	}
+	mask = slots - 1;
+	macs = malloc (slots * sizeof (wol_mac));
+	ips = calloc (slots, sizeof (uint32_t));
+	if (macs == NULL || ips == NULL) {
+		free (macs);
+		free (ips);
+		return (-1);
+	}
+	for (i = 0; i <= table->mask; i++) {
+		const struct wol_neigh_entry *e = &table->slots [i];
+		uint32_t j;
+
+		if (!e->used || e->ip == 0) {
+			continue;
+		}
+		for (j = wol_mac_hash (e->mac) & mask; ips [j] != 0 && macs [j] != e->mac; j = (j + 1) & mask) {
+		}
+		if (ips [j] == 0) {
+			learned++;
+		}
+		macs [j] = e->mac;
+		ips [j] = e->ip;
+	}
+
+	free (fan->learned.macs);
+	free (fan->learned.ips);
+	fan->learned.macs = macs;
+	fan->learned.ips = ips;
+	fan->learned.mask = mask;
+
+	return (learned);
+}
+
+
+/**
+ * Function to attach an inventory, for routing. The inventory is consulted
+ * before the learned neighbor data, and must stay open while attached.
+ *
+ * @param fan - the fan-out
+ * @param inv - the inventory, or NULL to detach
+ */
+void wol_fanout_set_inventory (wol_fanout *fan, const wol_inventory *inv)
+{
+	fan->inv = inv;
+}
+
+
+/**
+ * Function to find the subnet for a MAC address, from its inventory or
+ * learned IP address.
+ */
+static int fanout_route_mac (const wol_fanout *fan, wol_mac mac)
+{
+	wol_host host;
+	uint32_t i;
+
+	if (fan->inv != NULL && wol_inventory_by_mac (fan->inv, mac, &host) == 0 && host.ip != 0) {
+		return (fanout_route_ip (fan, host.ip));
+	}
+	if (fan->learned.ips != NULL) {
+		for (i = wol_mac_hash (mac) & fan->learned.mask; fan->learned.ips [i] != 0;
+			 i = (i + 1) & fan->learned.mask) {
+			if (fan->learned.macs [i] == mac) {
+				return (fanout_route_ip (fan, fan->learned.ips [i]));
+			}
+		}
+	}
+	return (-1);
+}
+
+
+/**
+ * Function to add a job to a subnet's list for the current send.
+ */
+static int fanout_add_job (struct fanout_subnet *sub, int index)
+{
+	if (sub->jobCount == sub->jobCap) {
+		int cap = sub->jobCap ? sub->jobCap * 2 : 256;
+		int *jobs = realloc (sub->jobs, cap * sizeof (int));
+		int *jobStatus;
+
+		if (jobs == NULL) {
+			return (-1);
+		}
+		sub->jobs = jobs;
+		if ((jobStatus = realloc (sub->jobStatus, cap * sizeof (int))) == NULL) {
+			return (-1);
+		}
+		sub->jobStatus = jobStatus;
+		sub->jobCap = cap;
+	}
+	sub->jobs [sub->jobCount++] = index;
+
+	return (0);
+}
+
+
+/**
+ * Function to send magic packets, each to the broadcast address of the
+ * subnet its MAC address routes to, with the subnets sent in parallel.
+ * Unroutable MAC addresses are sent on every subnet, unless the fan-out was
+ * created with WOL_FANOUT_NO_SPRAY.
+ *
+ * @param fan - the fan-out
+ * @param macs - the packed MAC addresses
+ * @param count - the number of MAC addresses
+ * @param status - populated with the result for each MAC address, 0 sent on
+ * at least one subnet, or -1; may be NULL
+ *
+ * @return the number of MAC addresses sent, or -1 with errno ENOMEM if the
+ * jobs could not be allocated, and nothing was sent
+ */
+int wol_fanout_send (wol_fanout *fan, const wol_mac *macs, int count, int *status)
+{
+	int *result, i, j, sent = 0;
+
+	if (count <= 0) {
+		return (0);
+	}
+	if ((result = malloc (count * sizeof (int))) == NULL) {
+		errno = ENOMEM;
+		return (-1);
+	}
+
+	/** Route each MAC address to its subnet's job list. */
+	for (i = 0; i < fan->count; i++) {
+		fan->subnets [i].jobCount = 0;
+	}
+	for (i = 0; i < count; i++) {
+		int route = fanout_route_mac (fan, macs [i]);
+
+		result [i] = -1;
+		if (route >= 0) {
+			if (fanout_add_job (&fan->subnets [route], i) < 0) {
+				break;
+			}
+		}
+		else if (!(fan->flags & WOL_FANOUT_NO_SPRAY)) {
+			for (j = 0; j < fan->count; j++) {
+				if (fanout_add_job (&fan->subnets [j], i) < 0) {
+					break;
+				}
+			}
+			if (j < fan->count) {
+				break;
+			}
+		}
+	}
+	if (i < count) {
+		/** A job list could not grow: send nothing, rather than part of the batch. */
+		if (status != NULL) {
+			for (i = 0; i < count; i++) {
+				status [i] = -1;
+			}
+		}
+		free (result);
+		errno = ENOMEM;
+		return (-1);
+	}
+
+	/** Start every worker, and wait for all of them to finish. */
+	pthread_mutex_lock (&fan->lock);
+	fan->macs = macs;
+	fan->busy = fan->count;
+	fan->generation++;
+	pthread_cond_broadcast (&fan->work);
+	while (fan->busy > 0) {
+		pthread_cond_wait (&fan->done, &fan->lock);
+	}
+	fan->macs = NULL;
+	pthread_mutex_unlock (&fan->lock);
+
+	for (i = 0; i < fan->count; i++) {
+		struct fanout_subnet *sub = &fan->subnets [i];
+
+		for (j = 0; j < sub->jobCount; j++) {
+			if (sub->jobStatus [j] == 0) {
+				result [sub->jobs [j]] = 0;
+			}
+		}
+	}
+	for (i = 0; i < count; i++) {
+		if (result [i] == 0) {
+			sent++;
+		}
+		if (status != NULL) {
+			status [i] = result [i];
+		}
+	}
+	free (result);
+
+	return (sent);
+}
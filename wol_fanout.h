@@ -0,0 +1,57 @@
+/**
+ * @file wol_fanout.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_fanout.c
+ * @details Provides the function prototypes of the subnet-directed broadcast
+ * fan-out. Magic packets are routed to the local subnet each host is on,
+ * and sent to that subnet's broadcast address by one worker per interface
+ * address.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_FANOUT_H
+#define WOL_FANOUT_H
+
+#include "wol_lib.h"
+#include "wol_inventory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Flags for wol_fanout_create(). */
+#define WOL_FANOUT_NO_SPRAY   0x1   /**< do not send unroutable MACs on every subnet */
+
+/** Opaque subnet fan-out. */
+typedef struct wol_fanout wol_fanout;
+
+wol_fanout *wol_fanout_create (int port, int flags);
+void wol_fanout_destroy (wol_fanout *fan);
+int wol_fanout_count (const wol_fanout *fan);
+int wol_fanout_subnet (const wol_fanout *fan, int index, char *ifName, char *bcastAddr);
+int wol_fanout_route (const wol_fanout *fan, const char *ipAddr);
+int wol_fanout_learn (wol_fanout *fan, const wol_neigh_table *table);
+void wol_fanout_set_inventory (wol_fanout *fan, const wol_inventory *inv);
+int wol_fanout_send (wol_fanout *fan, const wol_mac *macs, int count, int *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_FANOUT_H */
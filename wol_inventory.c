@@ -0,0 +1,755 @@
+/**
+ * @file wol_inventory.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Memory-mapped binary host inventory.
+ * @details Opens inventory files read-only with mmap(), so opening costs the
+ * same for ten hosts or two hundred thousand, and lookups by MAC address, IP
+ * address or host name are one open addressing probe sequence over the
+ * mapped indexes. Nothing is parsed or copied at open; pages are read in as
+ * the lookups touch them.
+ * wol_inventory_build() converts a CSV or whitespace separated text inventory
+ * to the binary format. It writes a temporary file and renames it over the
+ * destination, so a controller may rebuild an inventory while another
+ * process has the old one mapped.
+ * An open inventory is read-only, so lookups may run concurrently.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_inventory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#define INV_MAX_FIELD   256
+#define INV_FIELDS      5
+
+/** Is the character a blank within a line? */
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+
+
+/**
+ * The memory-mapped inventory.
+ */
+struct wol_inventory {
+	void *map;                         /**< the mapped file */
+	size_t size;                       /**< the size of the mapping */
+	const struct wol_inv_record *records;
+	const uint32_t *macIndex;
+	const uint32_t *ipIndex;
+	const uint32_t *nameIndex;
+	const char *strings;
+	uint64_t stringsLen;
+	uint32_t count;
+	uint32_t mask;                     /**< the number of index slots minus one */
+};
+
+
+/**
+ * Function to hash an IPv4 address, for the IP index.
+ */
+static inline uint32_t inv_hash_ip (uint32_t ip)
+{
+	return (wol_mac_hash ((wol_mac)ip));
+}
+
+
+/**
+ * Function to hash a host name, ignoring case, for the name index.
+ */
+static uint32_t inv_hash_name (const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	while (*name != '\0') {
+		h = (h ^ (unsigned char)tolower ((unsigned char)*name++)) * 16777619u;
+	}
+	return (h);
+}
+
+
+/**
+ * Function to check that a region of the file lies within it.
+ */
+static int inv_region_ok (uint64_t off, uint64_t len, size_t size, uint64_t align)
+{
+	return (off % align == 0 && off <= size && len <= size - off);
+}
+
+
+/**
+ * Function to open a binary inventory file, and map it read-only.
+ *
+ * @param path - the path of the inventory file, as written by wol_inventory_build()
+ *
+ * @return the inventory, or NULL if the file cannot be read or is not a valid inventory
+ */
+wol_inventory *wol_inventory_open (const char *path)
+{
+	const struct wol_inv_header *hdr;
+	wol_inventory *inv;
+	struct stat st;
+	uint64_t indexLen;
+	void *map;
+	int fd;
+
+	if ((fd = open (path, O_RDONLY)) < 0) {
+		return (NULL);
+	}
+	if (fstat (fd, &st) < 0 || (size_t)st.st_size < sizeof (struct wol_inv_header)) {
+		close (fd);
+		errno = EINVAL;
+		return (NULL);
+	}
+	map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (map == MAP_FAILED) {
+		return (NULL);
+	}
+
+	/**
+     * Validate the header and the regions it describes, so a truncated or
+     * foreign file fails here rather than faulting in a lookup.
+     */
+	hdr = map;
+	indexLen = (uint64_t)hdr->indexSlots * sizeof (uint32_t);
+	if (memcmp (hdr->magic, WOL_INV_MAGIC, sizeof (hdr->magic)) != 0 ||
+		hdr->version != WOL_INV_VERSION || hdr->byteOrder != WOL_INV_BYTEORDER ||
+		hdr->indexSlots == 0 || (hdr->indexSlots & (hdr->indexSlots - 1)) != 0 ||
+		hdr->count >= hdr->indexSlots ||
+		!inv_region_ok (hdr->recordsOff, (uint64_t)hdr->count * sizeof (struct wol_inv_record), st.st_size, 8) ||
+		!inv_region_ok (hdr->macIndexOff, indexLen, st.st_size, 4) ||
+		!inv_region_ok (hdr->ipIndexOff, indexLen, st.st_size, 4) ||
+		!inv_region_ok (hdr->nameIndexOff, indexLen, st.st_size, 4) ||
+		!inv_region_ok (hdr->stringsOff, hdr->stringsLen, st.st_size, 1) ||
+		hdr->stringsLen == 0 || ((const char *)map) [hdr->stringsOff + hdr->stringsLen - 1] != '\0') {
+		munmap (map, st.st_size);
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	if ((inv = calloc (1, sizeof (wol_inventory))) == NULL) {
+		munmap (map, st.st_size);
+		return (NULL);
+	}
+	inv->map = map;
+	inv->size = st.st_size;
+	inv->records = (const struct wol_inv_record *)((const char *)map + hdr->recordsOff);
+	inv->macIndex = (const uint32_t *)((const char *)map + hdr->macIndexOff);
+	inv->ipIndex = (const uint32_t *)((const char *)map + hdr->ipIndexOff);
+	inv->nameIndex = (const uint32_t *)((const char *)map + hdr->nameIndexOff);
+	inv->strings = (const char *)map + hdr->stringsOff;
+	inv->stringsLen = hdr->stringsLen;
+	inv->count = hdr->count;
+	inv->mask = hdr->indexSlots - 1;
+
+	return (inv);
+}
+
+
+/**
+ * Function to unmap and release an inventory. The strings of the hosts
+ * returned by its lookups are no longer valid.
+ *
+ * @param inv - the inventory to release, may be NULL
+ */
+void wol_inventory_close (wol_inventory *inv)
+{
+	if (inv == NULL) {
+		return;
+	}
+	munmap (inv->map, inv->size);
+	free (inv);
+}
+
+
+/**
+ * Function to get the number of hosts in an inventory.
+ *
+ * @param inv - the inventory
+ *
+ * @return the number of host records
+ */
+int wol_inventory_count (const wol_inventory *inv)
+{
+	return ((int)inv->count);
+}
+
+
+/**
+ * Function to get a string from the string table, or the empty string if
+ * the offset is out of range.
+ */
+static const char *inv_string (const wol_inventory *inv, uint32_t off)
+{
+	return (off < inv->stringsLen ? inv->strings + off : inv->strings);
+}
+
+
+/**
+ * Function to populate a host from a record.
+ */
+static void inv_fill (const wol_inventory *inv, const struct wol_inv_record *rec, wol_host *host)
+{
+	host->mac = rec->mac;
+	host->ip = rec->ip;
+	host->hostname = inv_string (inv, rec->hostOff);
+	host->model = inv_string (inv, rec->modelOff);
+	host->lastSeen = rec->lastSeen;
+}
+
+
+/**
+ * Function to get a host by its position in the inventory, to iterate over
+ * all hosts.
+ *
+ * @param inv - the inventory
+ * @param index - the position, from 0 to wol_inventory_count() - 1
+ * @param host - populated with the host
+ *
+ * @return 0 on success, -1 if the index is out of range
+ */
+int wol_inventory_get (const wol_inventory *inv, int index, wol_host *host)
+{
+	if (index < 0 || (uint32_t)index >= inv->count) {
+		return (-1);
+	}
+	inv_fill (inv, &inv->records [index], host);
+
+	return (0);
+}
+
+
+/**
+ * Function to look up a host by MAC address.
+ *
+ * @param inv - the inventory
+ * @param mac - the packed MAC address
+ * @param host - populated with the host
+ *
+ * @return 0 if found, -1 if not
+ */
+int wol_inventory_by_mac (const wol_inventory *inv, wol_mac mac, wol_host *host)
+{
+	uint32_t i = wol_mac_hash (mac) & inv->mask;
+	uint32_t slot, probes;
+
+	/**
+     * The probe is bounded, as a corrupt file may have an index with no
+     * empty slot.
+     */
+	for (probes = 0; probes <= inv->mask && (slot = inv->macIndex [i]) != 0 && slot <= inv->count; probes++) {
+		if (inv->records [slot - 1].mac == mac) {
+			inv_fill (inv, &inv->records [slot - 1], host);
+			return (0);
+		}
+		i = (i + 1) & inv->mask;
+	}
+	return (-1);
+}
+
+
+/**
+ * Function to look up a host by IP address.
+ *
+ * @param inv - the inventory
+ * @param ipAddr - the IP address, in dotted decimal
+ * @param host - populated with the host
+ *
+ * @return 0 if found, -1 if not or if the address is invalid
+ */
+int wol_inventory_by_ip (const wol_inventory *inv, const char *ipAddr, wol_host *host)
+{
+	struct in_addr addr;
+	uint32_t i, slot, probes;
+
+	if (inet_pton (AF_INET, ipAddr, &addr) != 1 || addr.s_addr == 0) {
+		return (-1);
+	}
+	i = inv_hash_ip (addr.s_addr) & inv->mask;
+	for (probes = 0; probes <= inv->mask && (slot = inv->ipIndex [i]) != 0 && slot <= inv->count; probes++) {
+		if (inv->records [slot - 1].ip == addr.s_addr) {
+			inv_fill (inv, &inv->records [slot - 1], host);
+			return (0);
+		}
+		i = (i + 1) & inv->mask;
+	}
+	return (-1);
+}
+
+
+/**
+ * Function to look up a host by host name, ignoring case.
+ *
+ * @param inv - the inventory
+ * @param hostname - the host name
+ * @param host - populated with the host
+ *
+ * @return 0 if found, -1 if not
+ */
+int wol_inventory_by_name (const wol_inventory *inv, const char *hostname, wol_host *host)
+{
+	uint32_t hash = inv_hash_name (hostname);
+	uint32_t i = hash & inv->mask;
+	uint32_t slot, probes;
+
+	for (probes = 0; probes <= inv->mask && (slot = inv->nameIndex [i]) != 0 && slot <= inv->count; probes++) {
+		const struct wol_inv_record *rec = &inv->records [slot - 1];
+
+		if (rec->nameHash == hash && strcasecmp (inv_string (inv, rec->hostOff), hostname) == 0) {
+			inv_fill (inv, rec, host);
+			return (0);
+		}
+		i = (i + 1) & inv->mask;
+	}
+	return (-1);
+}
+
+
+/*
+ * The inventory builder.
+ */
+
+/**
+ * A growable buffer.
+ */
+struct inv_buf {
+	char *data;
+	size_t len;
+	size_t cap;
+};
+
+static int inv_buf_append (struct inv_buf *b, const void *data, size_t len)
+{
+	if (b->len + len > b->cap) {
+		size_t cap = b->cap ? b->cap : 4096;
+		char *p;
+
+		while (cap < b->len + len) {
+			cap *= 2;
+		}
+		if ((p = realloc (b->data, cap)) == NULL) {
+			return (-1);
+		}
+		b->data = p;
+		b->cap = cap;
+	}
+	memcpy (b->data + b->len, data, len);
+	b->len += len;
+
+	return (0);
+}
+
+
+/**
+ * The string table under construction. Model identifiers repeat across a
+ * fleet, so they are interned through a hash of their offsets.
+ */
+struct inv_strings {
+	struct inv_buf buf;
+	uint32_t *intern;                  /**< string offset + 1, 0 if empty */
+	uint32_t internMask;
+	uint32_t internCount;
+};
+
+static int inv_add_string (struct inv_strings *s, const char *str, int intern, uint32_t *off)
+{
+	size_t len = strlen (str);
+	uint32_t i = 0;
+
+	if (len == 0) {
+		*off = 0;
+		return (0);
+	}
+	if (intern) {
+		if (s->internCount * 2 >= s->internMask + 1) {
+			uint32_t slots = (s->internMask + 1) * 2, j, *grown;
+
+			if ((grown = calloc (slots, sizeof (uint32_t))) == NULL) {
+				return (-1);
+			}
+			for (j = 0; j <= s->internMask; j++) {
+				if (s->intern [j] != 0) {
+					uint32_t k = inv_hash_name (s->buf.data + s->intern [j] - 1) & (slots - 1);
+
+					while (grown [k] != 0) {
+						k = (k + 1) & (slots - 1);
+					}
+					grown [k] = s->intern [j];
+				}
+			}
+			free (s->intern);
+			s->intern = grown;
+			s->internMask = slots - 1;
+		}
+		i = inv_hash_name (str) & s->internMask;
+		while (s->intern [i] != 0) {
+			if (strcmp (s->buf.data + s->intern [i] - 1, str) == 0) {
+				*off = s->intern [i] - 1;
+				return (0);
+			}
+			i = (i + 1) & s->internMask;
+		}
+	}
+	if (s->buf.len + len + 1 > UINT32_MAX) {
+		return (-1);
+	}
+	*off = (uint32_t)s->buf.len;
+	if (inv_buf_append (&s->buf, str, len + 1) < 0) {
+		return (-1);
+	}
+	if (intern) {
+		s->intern [i] = *off + 1;
+		s->internCount++;
+	}
+	return (0);
+}
+
+
+/**
+ * Function to split one line of a text inventory into fields. Fields are
+ * separated by commas or tabs, or by blanks if the line has neither, and
+ * may be double quoted. Blanks around fields are dropped.
+ *
+ * @return the number of fields, or -1 if a field is too long
+ */
+static int inv_split (char *line, char fields [INV_FIELDS][INV_MAX_FIELD])
+{
+	int commaSep = (strpbrk (line, ",\t") != NULL);
+	int n = 0;
+	char *p = line;
+
+	while (n < INV_FIELDS) {
+		int len = 0, quoted = 0;
+
+		while (*p == ' ' || *p == '\r' || (!commaSep && *p == '\t')) {
+			p++;
+		}
+		if (*p == '\0' && (!commaSep || n == 0)) {
+			break;
+		}
+		if (*p == '"') {
+			quoted = 1;
+			p++;
+		}
+		while (*p != '\0') {
+			if (quoted) {
+				if (*p == '"') {
+					if (p [1] != '"') {
+						quoted = 0;
+						p++;
+						continue;
+					}
+					p++;
+				}
+			}
+			else if (commaSep ? (*p == ',' || *p == '\t') : IS_BLANK (*p)) {
+				break;
+			}
+			if (len == INV_MAX_FIELD - 1) {
+				return (-1);
+			}
+			fields [n][len++] = *p++;
+		}
+		while (len > 0 && IS_BLANK (fields [n][len - 1])) {
+			len--;
+		}
+		fields [n++][len] = '\0';
+		if (*p == '\0') {
+			break;
+		}
+		p++;
+	}
+	return (n);
+}
+
+
+/**
+ * Function to parse one line of a text inventory into a record.
+ *
+ * @return 0 on success, 1 if the line holds no host, -1 if it is invalid
+ */
+static int inv_parse_line (char *line, struct wol_inv_record *rec, struct inv_strings *strs)
+{
+	char fields [INV_FIELDS][INV_MAX_FIELD];
+	char model [INV_MAX_FIELD];
+	struct in_addr addr;
+	char *end;
+	int n;
+
+	while (IS_BLANK (*line)) {
+		line++;
+	}
+	if (*line == '\0' || *line == '#') {
+		return (1);
+	}
+	if ((n = inv_split (line, fields)) <= 0) {
+		return (-1);
+	}
+	for (; n < INV_FIELDS; n++) {
+		fields [n][0] = '\0';
+	}
+
+	memset (rec, 0, sizeof (*rec));
+	if (wol_mac_parse (fields [0], &rec->mac) != 0) {
+		return (-1);
+	}
+	if (fields [1][0] != '\0') {
+		if (inet_pton (AF_INET, fields [1], &addr) != 1) {
+			return (-1);
+		}
+		rec->ip = addr.s_addr;
+	}
+	if (fields [4][0] != '\0') {
+		rec->lastSeen = strtoll (fields [4], &end, 10);
+		if (*end != '\0') {
+			return (-1);
+		}
+	}
+
+	/**
+     * Model fields may be raw device info TXT data, e.g. "model=MacPro6,1",
+     * as dig and the mDNS responders return it. Store the identifier alone.
+     */
+	if (strstr (fields [3], "model") != NULL) {
+		if (formatModelIdentifier_r (fields [3], model, sizeof (model)) != 0) {
+			return (-1);
+		}
+	}
+	else {
+		strcpy (model, fields [3]);
+	}
+
+	rec->nameHash = inv_hash_name (fields [2]);
+	if (inv_add_string (strs, fields [2], 0, &rec->hostOff) < 0 ||
+		inv_add_string (strs, model, 1, &rec->modelOff) < 0) {
+		return (-1);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to insert a record into an index under construction.
+ */
+static void inv_index_insert (uint32_t *index, uint32_t mask, uint32_t hash, uint32_t slot)
+{
+	uint32_t i = hash & mask;
+
+	while (index [i] != 0) {
+		i = (i + 1) & mask;
+	}
+	index [i] = slot;
+}
+
+
+/**
+ * Function to round a file offset up to 8 bytes.
+ */
+static inline uint64_t inv_align8 (uint64_t off)
+{
+	return ((off + 7) & ~(uint64_t)7);
+}
+
+
+/**
+ * Function to build a binary inventory from a text inventory.
+ * Each line holds one host: MAC address, then optionally IP address, host
+ * name, model identifier and last seen time in seconds since the epoch.
+ * Fields are separated by commas, tabs or blanks, and may be empty.
+ * Blank lines, lines starting with '#', and a header line are skipped.
+ * Where hosts share a MAC address, IP address or host name, the lookup
+ * finds the first.
+ *
+ * @param textPath - the path of the text inventory
+ * @param invPath - the path of the binary inventory to write
+ * @param badLine - populated with the line number of an invalid line, or 0; may be NULL
+ *
+ * @return the number of hosts written, or -1 on failure
+ */
+int wol_inventory_build (const char *textPath, const char *invPath, int *badLine)
+{
+	struct inv_buf records = { NULL, 0, 0 };
+	struct inv_strings strs;
+	struct wol_inv_header hdr;
+	char *text = NULL, *line, *tmpPath = NULL;
+	uint32_t *indexes = NULL, slots = 16, count, i;
+	size_t textLen = 0, n;
+	int lineNo = 0, seenHost = 0, result = -1;
+	FILE *fp;
+
+	if (badLine != NULL) {
+		*badLine = 0;
+	}
+	memset (&strs, 0, sizeof (strs));
+	strs.internMask = 15;
+	if ((strs.intern = calloc (16, sizeof (uint32_t))) == NULL ||
+		inv_buf_append (&strs.buf, "", 1) < 0) {
+		goto done;
+	}
+
+	/** Read the whole text inventory. */
+	if ((fp = fopen (textPath, "r")) == NULL) {
+		goto done;
+	}
+	for (;;) {
+		char *p = realloc (text, textLen + 65536 + 1);
+
+		if (p == NULL) {
+			fclose (fp);
+			goto done;
+		}
+		text = p;
+		if ((n = fread (text + textLen, 1, 65536, fp)) == 0) {
+			break;
+		}
+		textLen += n;
+	}
+	fclose (fp);
+	text [textLen] = '\0';
+
+	/** Parse each line into a record. */
+	for (line = text; line != NULL && *line != '\0'; ) {
+		struct wol_inv_record rec;
+		char *eol = strchr (line, '\n');
+		int r;
+
+		if (eol != NULL) {
+			*eol = '\0';
+		}
+		lineNo++;
+		r = inv_parse_line (line, &rec, &strs);
+		if (r < 0 && !seenHost) {
+			/** The first line that is not a host may be a column header. */
+			seenHost = 1;
+		}
+		else if (r < 0) {
+			if (badLine != NULL) {
+				*badLine = lineNo;
+			}
+			errno = EINVAL;
+			goto done;
+		}
+		else if (r == 0) {
+			seenHost = 1;
+			if (records.len / sizeof (rec) >= UINT32_MAX / 4 ||
+				inv_buf_append (&records, &rec, sizeof (rec)) < 0) {
+				goto done;
+			}
+		}
+		line = (eol != NULL) ? eol + 1 : NULL;
+	}
+
+	/** Build the three indexes, at most half full. */
+	count = (uint32_t)(records.len / sizeof (struct wol_inv_record));
+	while (slots < count * 2) {
+		slots <<= 1;
+	}
+	if ((indexes = calloc ((size_t)slots * 3, sizeof (uint32_t))) == NULL) {
+		goto done;
+	}
+	for (i = 0; i < count; i++) {
+		const struct wol_inv_record *rec = (const struct wol_inv_record *)records.data + i;
+		uint32_t j;
+
+		/** Skip keys already indexed, so the first host wins. */
+		for (j = wol_mac_hash (rec->mac) & (slots - 1); indexes [j] != 0; j = (j + 1) & (slots - 1)) {
+			if (((const struct wol_inv_record *)records.data) [indexes [j] - 1].mac == rec->mac) {
+				break;
+			}
+		}
+		if (indexes [j] == 0) {
+			indexes [j] = i + 1;
+		}
+		if (rec->ip != 0) {
+			uint32_t *ipIndex = indexes + slots;
+
+			for (j = inv_hash_ip (rec->ip) & (slots - 1); ipIndex [j] != 0; j = (j + 1) & (slots - 1)) {
+				if (((const struct wol_inv_record *)records.data) [ipIndex [j] - 1].ip == rec->ip) {
+					break;
+				}
+			}
+			if (ipIndex [j] == 0) {
+				ipIndex [j] = i + 1;
+			}
+		}
+		if (rec->hostOff != 0) {
+			inv_index_insert (indexes + slots * 2, slots - 1, rec->nameHash, i + 1);
+		}
+	}
+
+	/** Lay out and write the file. */
+	memset (&hdr, 0, sizeof (hdr));
+	memcpy (hdr.magic, WOL_INV_MAGIC, sizeof (hdr.magic));
+	hdr.version = WOL_INV_VERSION;
+	hdr.byteOrder = WOL_INV_BYTEORDER;
+	hdr.count = count;
+	hdr.indexSlots = slots;
+	hdr.recordsOff = inv_align8 (sizeof (hdr));
+	hdr.macIndexOff = inv_align8 (hdr.recordsOff + records.len);
+	hdr.ipIndexOff = hdr.macIndexOff + (uint64_t)slots * sizeof (uint32_t);
+	hdr.nameIndexOff = hdr.ipIndexOff + (uint64_t)slots * sizeof (uint32_t);
+	hdr.stringsOff = hdr.nameIndexOff + (uint64_t)slots * sizeof (uint32_t);
+	hdr.stringsLen = strs.buf.len;
+
+	if ((tmpPath = malloc (strlen (invPath) + 5)) == NULL) {
+		goto done;
+	}
+	sprintf (tmpPath, "%s.tmp", invPath);
+	if ((fp = fopen (tmpPath, "wb")) == NULL) {
+		goto done;
+	}
+	{
+		static const char pad [8];
+
+		if (fwrite (&hdr, sizeof (hdr), 1, fp) != 1 ||
+			fwrite (pad, hdr.recordsOff - sizeof (hdr), 1, fp) > 1 ||
+			(records.len > 0 && fwrite (records.data, records.len, 1, fp) != 1) ||
+			fwrite (pad, hdr.macIndexOff - hdr.recordsOff - records.len, 1, fp) > 1 ||
+			fwrite (indexes, (size_t)slots * 3 * sizeof (uint32_t), 1, fp) != 1 ||
+			fwrite (strs.buf.data, strs.buf.len, 1, fp) != 1) {
+			fclose (fp);
+			unlink (tmpPath);
+			goto done;
+		}
+	}
+	if (fclose (fp) != 0 || rename (tmpPath, invPath) != 0) {
+		unlink (tmpPath);
+		goto done;
+	}
+	result = (int)count;
+
+done:
+	free (tmpPath);
+	free (indexes);
+	free (text);
+	free (records.data);
+	free (strs.buf.data);
+	free (strs.intern);
+
+	return (result);
+}
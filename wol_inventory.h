@@ -0,0 +1,100 @@
+/**
+ * @file wol_inventory.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_inventory.c
+ * @details Provides the on-disk layout, types and function prototypes of the
+ * binary host inventory. An inventory file holds fixed size host records, a
+ * string table, and open addressing indexes by MAC address, IP address and
+ * host name. It is memory-mapped read-only and used in place, without parsing.
+ * The layout is in host byte order; a file is only read on machines of the
+ * byte order that built it.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_INVENTORY_H
+#define WOL_INVENTORY_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WOL_INV_MAGIC     "WOLINV\0\0"
+#define WOL_INV_VERSION   1
+#define WOL_INV_BYTEORDER 0x01020304u
+
+/**
+ * The file header. Offsets are from the start of the file, and 8 byte aligned.
+ */
+struct wol_inv_header {
+	char magic [8];                    /**< WOL_INV_MAGIC */
+	uint32_t version;                  /**< WOL_INV_VERSION */
+	uint32_t byteOrder;                /**< WOL_INV_BYTEORDER, as written by the builder */
+	uint32_t count;                    /**< the number of host records */
+	uint32_t indexSlots;               /**< the number of slots of each index, a power of two */
+	uint64_t recordsOff;               /**< count x struct wol_inv_record */
+	uint64_t macIndexOff;              /**< indexSlots x uint32_t, record + 1, 0 if empty */
+	uint64_t ipIndexOff;               /**< indexSlots x uint32_t */
+	uint64_t nameIndexOff;             /**< indexSlots x uint32_t */
+	uint64_t stringsOff;               /**< NUL terminated strings; offset 0 is the empty string */
+	uint64_t stringsLen;
+};
+
+/**
+ * A host record, 32 bytes.
+ */
+struct wol_inv_record {
+	wol_mac mac;                       /**< the packed MAC address */
+	uint32_t ip;                       /**< the IPv4 address, network byte order, 0 if unknown */
+	uint32_t nameHash;                 /**< the case-insensitive hash of the host name */
+	uint32_t hostOff;                  /**< the host name, in the string table */
+	uint32_t modelOff;                 /**< the model identifier, in the string table */
+	int64_t lastSeen;                  /**< seconds since the epoch, 0 if never */
+};
+
+/**
+ * A host, as returned by the lookups. The strings point into the mapped
+ * file, and stay valid until the inventory is closed.
+ */
+typedef struct wol_host {
+	wol_mac mac;
+	uint32_t ip;                       /**< network byte order */
+	const char *hostname;
+	const char *model;
+	int64_t lastSeen;
+} wol_host;
+
+/** Opaque memory-mapped inventory. */
+typedef struct wol_inventory wol_inventory;
+
+wol_inventory *wol_inventory_open (const char *path);
+void wol_inventory_close (wol_inventory *inv);
+int wol_inventory_count (const wol_inventory *inv);
+int wol_inventory_get (const wol_inventory *inv, int index, wol_host *host);
+int wol_inventory_by_mac (const wol_inventory *inv, wol_mac mac, wol_host *host);
+int wol_inventory_by_ip (const wol_inventory *inv, const char *ipAddr, wol_host *host);
+int wol_inventory_by_name (const wol_inventory *inv, const char *hostname, wol_host *host);
+int wol_inventory_build (const char *textPath, const char *invPath, int *badLine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_INVENTORY_H */
@@ -23,8 +23,173 @@
  * http://www.gnu.org/copyleft/gpl.html
  */
 
+#ifndef WOL_LIB_H
+#define WOL_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The size of the device info buffers populated by deviceInfoForHost(). */
+#define WOL_DEVINFO_LEN  64
+
+/** The size of the command buffer populated by buildDigCmd(). */
+#define WOL_DIGCMD_LEN   256
+
+/**
+ * A MAC address packed into the low 48 bits, the first octet most significant.
+ * Compares and hashes as a plain integer. See mac_addr.c.
+ */
+typedef uint64_t wol_mac;
+
+/** The length of a magic packet: 6 x 0xff then 16 x the 6 byte MAC address. */
+#define WOL_PACKET_LEN  102
+
+/** The size of a buffer for a formatted MAC address, including the terminator. */
+#define WOL_MAC_STRLEN  18
+
+/** Styles for wol_mac_format(), may be combined. */
+#define WOL_MAC_LOWER   0x0     /**< 00:1b:63:aa:bb:cc */
+#define WOL_MAC_UPPER   0x1     /**< 00:1B:63:AA:BB:CC */
+#define WOL_MAC_DASHED  0x2     /**< 00-1b-63-aa-bb-cc */
+
+/**
+ * Function to hash a MAC address, for hash table indexes.
+ */
+static inline uint32_t wol_mac_hash (wol_mac mac)
+{
+	uint64_t h = mac * 0x9e3779b97f4a7c15ull;
+	
+	return (uint32_t)(h >> 32);
+}
+
+/**
+ * Function to compare two MAC addresses, for qsort() and bsearch().
+ */
+static inline int wol_mac_cmp (wol_mac a, wol_mac b)
+{
+	return (a > b) - (a < b);
+}
+
+/**
+ * Opaque persistent wake context. Holds a pre-opened broadcast socket, the
+ * destination address, and reusable packet buffers. See wol_ctx_create().
+ */
+typedef struct wol_ctx wol_ctx;
+
+/**
+ * Opaque magic packet cache. Keeps ready-to-send packets for known MAC
+ * addresses in one cache-aligned arena. See wol_pktcache_create().
+ */
+typedef struct wol_pktcache wol_pktcache;
+
+/**
+ * Opaque snapshot of the kernel neighbor (ARP) table, indexed by IP address.
+ * See neighTableLoad().
+ */
+typedef struct wol_neigh_table wol_neigh_table;
+
+/**
+ * Callback for neighTableForeach(). The IPv4 address is in network byte
+ * order. A nonzero return stops the walk.
+ */
+typedef int (*wol_neigh_cb) (void *arg, uint32_t ip, wol_mac mac);
+
+/**
+ * The neighbor watcher's totals. See wol_neigh_watch_start().
+ */
+typedef struct wol_neigh_watch_stats {
+	uint64_t entries;     /**< IP addresses in the live map */
+	uint64_t events;      /**< neighbor events applied */
+	uint64_t removed;     /**< entries removed by events */
+	uint64_t full;        /**< entries dropped, the map at capacity */
+	uint64_t overruns;    /**< times the event socket overflowed */
+	uint64_t resyncs;     /**< reloads of the table after an overrun */
+} wol_neigh_watch_stats;
+
+/**
+ * The passive mDNS listener's totals. See wol_mdns_watch_start().
+ */
+typedef struct wol_mdns_watch_stats {
+	uint64_t hosts;       /**< hosts in the model index */
+	uint64_t packets;     /**< mDNS messages received */
+	uint64_t malformed;   /**< messages that could not be parsed */
+	uint64_t records;     /**< device information records indexed */
+	uint64_t goodbyes;    /**< records withdrawn with a zero TTL */
+	uint64_t expired;     /**< entries dropped when their TTL ran out */
+	uint64_t full;        /**< hosts not kept, the index at capacity */
+} wol_mdns_watch_stats;
+
+/**
+ * Opaque layer 2 wake channel. Sends magic packets as raw EtherType 0x0842
+ * frames through a memory-mapped TX ring. See wol_l2_open().
+ */
+typedef struct wol_l2 wol_l2;
+
+wol_mac wol_mac_from_bytes (const unsigned char *bytes);
+void wol_mac_to_bytes (wol_mac mac, unsigned char *bytes);
+int wol_mac_parse (const char *macStr, wol_mac *mac);
+int wol_mac_format (wol_mac mac, int style, char *buf, size_t len);
+
+void wol_build_magic (wol_mac mac, unsigned char *packetBuf);
+wol_pktcache *wol_pktcache_create (int capacity);
+void wol_pktcache_destroy (wol_pktcache *cache);
+const unsigned char *wol_pktcache_get (wol_pktcache *cache, wol_mac mac);
+const unsigned char *wol_pktcache_find (const wol_pktcache *cache, wol_mac mac);
+int wol_pktcache_count (const wol_pktcache *cache);
+
 int send_wol (char *mac);
+int send_wol_mac (wol_mac mac);
+int send_wol_batch (char **macAddrs, int count, int *status);
+int send_wol_batch_hw (unsigned char (*hwAddrs)[6], int count, int *status);
+wol_ctx *wol_ctx_create (const char *bcastAddr, int port);
+void wol_ctx_destroy (wol_ctx *ctx);
+int wol_ctx_send (wol_ctx *ctx, char *macAddr);
+int wol_ctx_send_hw (wol_ctx *ctx, const unsigned char *hwAddr);
+int wol_ctx_send_mac (wol_ctx *ctx, wol_mac mac);
+int wol_ctx_send_batch (wol_ctx *ctx, unsigned char (*hwAddrs)[6], int count, int *status);
+int wol_ctx_send_packets (wol_ctx *ctx, const unsigned char *const *packets, int count, int *status);
+int send_wol_l2 (char *ifName, char *macAddr);
+wol_l2 *wol_l2_open (const char *ifName, int ringFrames);
+void wol_l2_close (wol_l2 *l2);
+int wol_l2_queue (wol_l2 *l2, const unsigned char *hwAddr, int directed);
+int wol_l2_flush (wol_l2 *l2);
+int wol_l2_send_batch (wol_l2 *l2, unsigned char (*hwAddrs)[6], int count, int directed, int *status);
 int pingIP(char *ipAddr);
+int pingIPWithTimeout(char *ipAddr, int timeoutMs, long *rttUsec);
 int macForIP(char *ipAddr, char *macAddr);
+int macForIP_r(const char *ipAddr, char *macAddr, size_t macLen);
+int macForIPAddr(char *ipAddr, wol_mac *mac);
+int macForIPBulk(char **ipAddrs, int count, char **macAddrs, int *status);
+wol_neigh_table *neighTableLoad(void);
+void neighTableFree(wol_neigh_table *table);
+int neighTableLookup(wol_neigh_table *table, char *ipAddr, char *macAddr);
+int neighTableCount(const wol_neigh_table *table);
+int neighTableForeach(const wol_neigh_table *table, wol_neigh_cb cb, void *arg);
+wol_neigh_table *wol_arp_sweep (const char *ifName, const char *cidr, int ratePps, int waitMs);
+int wol_neigh_watch_start (int capacity);
+void wol_neigh_watch_stop (void);
+int wol_neigh_watch_lookup (uint32_t ip, wol_mac *mac);
+int wol_neigh_watch_get_stats (wol_neigh_watch_stats *stats);
 int formatMAC(char *unformattedMAC, char *formattedMAC);
-int formatModelIdentifier(char *unformattedModelID, char *formattedModelID);
\ No newline at end of file
+int formatMAC_r(const char *unformattedMAC, char *formattedMAC, size_t len);
+int formatModelIdentifier(char *unformattedModelID, char *formattedModelID);
+int formatModelIdentifier_r(const char *unformattedModelID, char *formattedModelID, size_t len);
+int buildDigCmd_r(const char *server, const char *hostName, const char *port, const char *serviceType,
+				  const char *domain, const char *query, char *cmd, size_t cmdLen);
+int deviceInfoForHost(char *host, char *hostIP, char *devInfo);
+int deviceInfoForHost_r(const char *host, const char *hostIP, char *devInfo, size_t devInfoLen);
+int deviceInfoForHosts(char **hosts, int count, char *hostIP, int timeoutMs, char **devInfos, int *status);
+int wol_mdns_watch_start (const char *ifAddr, int capacity);
+void wol_mdns_watch_stop (void);
+int wol_mdns_watch_lookup (const char *host, char *model, size_t modelLen);
+int wol_mdns_watch_get_stats (wol_mdns_watch_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_LIB_H */
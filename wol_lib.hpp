@@ -0,0 +1,648 @@
+/**
+ * @file wol_lib.hpp
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header-only C++ interface to wol_lib
+ * @details Wraps the C library for C++17 and later. MAC address literals are
+ * parsed at compile time, so a malformed literal fails the build under C++20,
+ * or under C++17 where it is a constant expression, and magic packets for
+ * fixed MAC addresses are built at compile time as constant arrays. Wake
+ * contexts, submission queues and probe engines are owned by move-only
+ * objects that release them on destruction, and batch calls take spans of
+ * addresses or packets. Nothing here needs to be compiled into the
+ * library; link with the C objects as usual.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_LIB_HPP
+#define WOL_LIB_HPP
+
+#include "wol_lib.h"
+#include "wol_async.h"
+#include "wol_queue.h"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_span)
+#include <span>
+#endif
+
+/**
+ * MAC address literals are consteval where the language has it, so even a
+ * literal used at run time is checked by the compiler.
+ */
+#if defined(__cpp_consteval)
+#define WOL_CONSTEVAL consteval
+#else
+#define WOL_CONSTEVAL constexpr
+#endif
+
+namespace wol {
+
+#if defined(__cpp_lib_span)
+template <typename T>
+using span = std::span<T>;
+#else
+/**
+ * A minimal stand in for std::span before C++20: a pointer and a count,
+ * viewing an array, a std::array or a std::vector.
+ */
+template <typename T>
+class span {
+public:
+	constexpr span () noexcept : data_ (nullptr), size_ (0) {}
+	constexpr span (T *data, std::size_t size) noexcept : data_ (data), size_ (size) {}
+	template <std::size_t N>
+	constexpr span (T (&arr) [N]) noexcept : data_ (arr), size_ (N) {}
+	template <typename C, typename = std::enable_if_t<std::is_convertible_v<decltype (std::declval<C &> ().data ()), T *>>>
+	constexpr span (C &&c) noexcept : data_ (c.data ()), size_ (c.size ()) {}
+
+	constexpr T *data () const noexcept { return data_; }
+	constexpr std::size_t size () const noexcept { return size_; }
+	constexpr bool empty () const noexcept { return size_ == 0; }
+	constexpr T &operator[] (std::size_t i) const noexcept { return data_ [i]; }
+	constexpr T *begin () const noexcept { return data_; }
+	constexpr T *end () const noexcept { return data_ + size_; }
+
+private:
+	T *data_;
+	std::size_t size_;
+};
+#endif
+
+/** A magic packet: 6 x 0xff then 16 x the 6 byte MAC address. */
+using packet = std::array<std::byte, WOL_PACKET_LEN>;
+
+namespace detail {
+
+/**
+ * The value of a hex digit, or -1.
+ */
+constexpr int hex_value (char c) noexcept
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/**
+ * Throws the system error for errno. Used where a constructor cannot return
+ * the C library's failure.
+ */
+[[noreturn]] inline void throw_errno (const char *what)
+{
+	throw std::system_error (errno, std::generic_category (), what);
+}
+
+} // namespace detail
+
+/**
+ * A MAC address, the same packed 48 bit value as the C library's wol_mac,
+ * which it converts to implicitly. Usable in constant expressions.
+ */
+class mac {
+public:
+	constexpr mac () noexcept : value_ (0) {}
+	constexpr explicit mac (wol_mac value) noexcept : value_ (value & 0xffffffffffffull) {}
+
+	/**
+	 * Parses a MAC address string, accepting the same notations as
+	 * wol_mac_parse(): six octets of one or two hex digits separated by colons
+	 * or dashes, Cisco dotted notation xxxx.xxxx.xxxx, and 12 bare hex digits.
+	 *
+	 * @param str - the MAC address string
+	 *
+	 * @return the MAC address, or no value if the string is not a MAC address
+	 */
+	static constexpr std::optional<mac> from_string (std::string_view str) noexcept
+	{
+		wol_mac val = 0;
+		std::size_t i = 0;
+		int groups = 0;
+		char delim = 0;
+
+		for (;;) {
+			wol_mac group = 0;
+			int groupLen = 0;
+
+			while (i < str.size () && detail::hex_value (str [i]) >= 0 && groupLen <= 12) {
+				group = (group << 4) | (wol_mac)detail::hex_value (str [i]);
+				i++;
+				groupLen++;
+			}
+			groups++;
+
+			if (delim == 0 && i < str.size () && (str [i] == ':' || str [i] == '-' || str [i] == '.')) {
+				delim = str [i];
+			}
+
+			if (delim == ':' || delim == '-') {
+				if (groupLen < 1 || groupLen > 2) {
+					return std::nullopt;
+				}
+				val = (val << 8) | group;
+				if (groups == 6) {
+					break;
+				}
+			}
+			else if (delim == '.') {
+				if (groupLen != 4) {
+					return std::nullopt;
+				}
+				val = (val << 16) | group;
+				if (groups == 3) {
+					break;
+				}
+			}
+			else {
+				if (groupLen != 12) {
+					return std::nullopt;
+				}
+				val = group;
+				break;
+			}
+
+			if (i >= str.size () || str [i] != delim) {
+				return std::nullopt;
+			}
+			i++;
+		}
+
+		if (i != str.size ()) {
+			return std::nullopt;
+		}
+		return mac (val);
+	}
+
+	/**
+	 * Parses a MAC address string, as from_string().
+	 *
+	 * @throw std::invalid_argument if the string is not a MAC address. In a
+	 * constant expression, a malformed string is a compile error.
+	 */
+	static constexpr mac parse (std::string_view str)
+	{
+		std::optional<mac> m = from_string (str);
+
+		if (!m) {
+			throw std::invalid_argument ("wol::mac: not a MAC address");
+		}
+		return *m;
+	}
+
+	constexpr wol_mac value () const noexcept { return value_; }
+	constexpr operator wol_mac () const noexcept { return value_; }
+
+	/**
+	 * The 6 octets, the first octet first.
+	 */
+	constexpr std::array<std::byte, 6> bytes () const noexcept
+	{
+		std::array<std::byte, 6> out {};
+
+		for (int i = 0; i < 6; i++) {
+			out [i] = std::byte ((value_ >> (8 * (5 - i))) & 0xff);
+		}
+		return out;
+	}
+
+	/**
+	 * Formats the address with wol_mac_format().
+	 *
+	 * @param style - WOL_MAC_LOWER, or any of WOL_MAC_UPPER and WOL_MAC_DASHED
+	 */
+	std::string to_string (int style = WOL_MAC_LOWER) const
+	{
+		char buf [WOL_MAC_STRLEN];
+
+		wol_mac_format (value_, style, buf, sizeof (buf));
+		return std::string (buf);
+	}
+
+	friend constexpr bool operator== (mac a, mac b) noexcept { return a.value_ == b.value_; }
+	friend constexpr bool operator!= (mac a, mac b) noexcept { return a.value_ != b.value_; }
+	friend constexpr bool operator< (mac a, mac b) noexcept { return a.value_ < b.value_; }
+
+private:
+	wol_mac value_;
+};
+
+static_assert (sizeof (mac) == sizeof (wol_mac), "wol::mac must stay layout compatible with wol_mac");
+
+inline namespace literals {
+
+/**
+ * A MAC address literal, "00:1b:63:aa:bb:cc"_mac. Parsed by the compiler:
+ * a malformed literal does not compile under C++20. Under C++17 it does not
+ * compile in a constant expression, and throws std::invalid_argument elsewhere.
+ */
+WOL_CONSTEVAL mac operator""_mac (const char *str, std::size_t len)
+{
+	return mac::parse (std::string_view (str, len));
+}
+
+} // namespace literals
+
+/**
+ * Builds the magic packet for a MAC address, as wol_build_magic(). Usable in
+ * constant expressions.
+ */
+constexpr packet make_packet (mac m) noexcept
+{
+	packet out {};
+	std::array<std::byte, 6> hw = m.bytes ();
+
+	for (std::size_t i = 0; i < 6; i++) {
+		out [i] = std::byte (0xff);
+	}
+	for (std::size_t i = 6; i < WOL_PACKET_LEN; i++) {
+		out [i] = hw [(i - 6) % 6];
+	}
+	return out;
+}
+
+/**
+ * The magic packet for a MAC address fixed at compile time, built by the
+ * compiler into read-only data: magic_packet<"00:1b:63:aa:bb:cc"_mac>.
+ */
+template <wol_mac M>
+inline constexpr packet magic_packet = make_packet (mac (M));
+
+
+/**
+ * A wake context, owning a wol_ctx: one UDP socket and destination, reused
+ * for every send. Move-only.
+ */
+class context {
+public:
+	/**
+	 * @param bcastAddr - the destination IPv4 address string, NULL or "" for 255.255.255.255
+	 * @param port - the destination UDP port, 0 for the default port 60000
+	 *
+	 * @throw std::system_error if the socket cannot be created
+	 */
+	explicit context (const char *bcastAddr = nullptr, int port = 0)
+		: ctx_ (wol_ctx_create (bcastAddr, port))
+	{
+		if (ctx_ == nullptr) {
+			detail::throw_errno ("wol_ctx_create");
+		}
+	}
+
+	~context () { reset (); }
+
+	context (const context &) = delete;
+	context &operator= (const context &) = delete;
+	context (context &&other) noexcept : ctx_ (other.ctx_) { other.ctx_ = nullptr; }
+	context &operator= (context &&other) noexcept
+	{
+		if (this != &other) {
+			reset ();
+			ctx_ = other.ctx_;
+			other.ctx_ = nullptr;
+		}
+		return *this;
+	}
+
+	wol_ctx *get () const noexcept { return ctx_; }
+
+	/**
+	 * Sends the magic packet for one MAC address.
+	 *
+	 * @return true if sent
+	 */
+	bool send (mac m) const noexcept
+	{
+		return wol_ctx_send_mac (ctx_, m) == 0;
+	}
+
+	/**
+	 * Sends one prebuilt magic packet, from make_packet() or magic_packet.
+	 *
+	 * @return true if sent
+	 */
+	bool send (const packet &pkt) const noexcept
+	{
+		const unsigned char *ptr = reinterpret_cast<const unsigned char *> (pkt.data ());
+		int status;
+
+		return wol_ctx_send_packets (ctx_, &ptr, 1, &status) == 1;
+	}
+
+	/**
+	 * Sends the magic packets for a batch of MAC addresses, as
+	 * wol_ctx_send_batch().
+	 *
+	 * @param macs - the MAC addresses
+	 * @param status - empty, or populated with the result for each address, 0 sent or -1 failed
+	 *
+	 * @return the number of magic packets sent
+	 */
+	int send (span<const mac> macs, span<int> status = {}) const
+	{
+		std::vector<unsigned char> hw (macs.size () * 6);
+		std::vector<int> scratch;
+
+		for (std::size_t i = 0; i < macs.size (); i++) {
+			wol_mac_to_bytes (macs [i], &hw [i * 6]);
+		}
+		int *st = status_for (macs.size (), status, scratch);
+
+		return wol_ctx_send_batch (ctx_, reinterpret_cast<unsigned char (*) [6]> (hw.data ()), (int)macs.size (), st);
+	}
+
+	/**
+	 * Sends a batch of prebuilt magic packets, as wol_ctx_send_packets().
+	 *
+	 * @param packets - the magic packets
+	 * @param status - empty, or populated with the result for each packet, 0 sent or -1 failed
+	 *
+	 * @return the number of magic packets sent
+	 */
+	int send (span<const packet> packets, span<int> status = {}) const
+	{
+		std::vector<const unsigned char *> ptrs (packets.size ());
+		std::vector<int> scratch;
+
+		for (std::size_t i = 0; i < packets.size (); i++) {
+			ptrs [i] = reinterpret_cast<const unsigned char *> (packets [i].data ());
+		}
+		int *st = status_for (packets.size (), status, scratch);
+
+		return wol_ctx_send_packets (ctx_, ptrs.data (), (int)packets.size (), st);
+	}
+
+private:
+	void reset () noexcept
+	{
+		if (ctx_ != nullptr) {
+			wol_ctx_destroy (ctx_);
+			ctx_ = nullptr;
+		}
+	}
+
+	/**
+	 * The caller's status array, or scratch space when none was given.
+	 */
+	static int *status_for (std::size_t count, span<int> status, std::vector<int> &scratch)
+	{
+		if (status.empty ()) {
+			scratch.resize (count);
+			return scratch.data ();
+		}
+		if (status.size () < count) {
+			throw std::invalid_argument ("wol::context: status span shorter than the batch");
+		}
+		return status.data ();
+	}
+
+	wol_ctx *ctx_;
+};
+
+
+/**
+ * A wake submission queue, owning a wol_queue and its sender thread.
+ * Move-only. Destruction sends whatever is still queued.
+ */
+class queue {
+public:
+	/**
+	 * @param bcastAddr - the destination IPv4 address string, NULL or "" for 255.255.255.255
+	 * @param port - the destination UDP port, 0 for the default port 60000
+	 * @param size - the ring slots, 0 for WOL_QUEUE_DEF_SIZE
+	 *
+	 * @throw std::system_error if the queue cannot be created
+	 */
+	explicit queue (const char *bcastAddr = nullptr, int port = 0, int size = 0)
+		: q_ (wol_queue_create (bcastAddr, port, size))
+	{
+		if (q_ == nullptr) {
+			detail::throw_errno ("wol_queue_create");
+		}
+	}
+
+	~queue () { reset (); }
+
+	queue (const queue &) = delete;
+	queue &operator= (const queue &) = delete;
+	queue (queue &&other) noexcept : q_ (other.q_) { other.q_ = nullptr; }
+	queue &operator= (queue &&other) noexcept
+	{
+		if (this != &other) {
+			reset ();
+			q_ = other.q_;
+			other.q_ = nullptr;
+		}
+		return *this;
+	}
+
+	wol_queue *get () const noexcept { return q_; }
+
+	/**
+	 * Queues a wake. Safe from any thread.
+	 *
+	 * @param repeat - the number of copies of the magic packet, 1 to WOL_QUEUE_MAX_REPEAT
+	 *
+	 * @return true if queued, false with errno EAGAIN if the ring is full
+	 */
+	bool submit (mac m, int repeat = 1) const noexcept
+	{
+		return wol_queue_submit (q_, m, repeat) == 0;
+	}
+
+	/**
+	 * Queues a wake for each MAC address, stopping at the first refusal.
+	 *
+	 * @return the number queued
+	 */
+	std::size_t submit (span<const mac> macs, int repeat = 1) const noexcept
+	{
+		std::size_t i;
+
+		for (i = 0; i < macs.size (); i++) {
+			if (wol_queue_submit (q_, macs [i], repeat) != 0) {
+				break;
+			}
+		}
+		return i;
+	}
+
+	/**
+	 * Waits until everything queued so far has been sent.
+	 *
+	 * @return true if sent, false with errno ETIMEDOUT
+	 */
+	bool flush (int timeoutMs = -1) const noexcept
+	{
+		return wol_queue_flush (q_, timeoutMs) == 0;
+	}
+
+	wol_queue_stats stats () const noexcept
+	{
+		wol_queue_stats st;
+
+		wol_queue_get_stats (q_, &st);
+		return st;
+	}
+
+private:
+	void reset () noexcept
+	{
+		if (q_ != nullptr) {
+			wol_queue_destroy (q_);
+			q_ = nullptr;
+		}
+	}
+
+	wol_queue *q_;
+};
+
+
+/**
+ * The result of probing one host, as wol_async_result.
+ */
+struct probe_result {
+	int status = -1;      /**< 0 answered, 1 no answer in time, -1 failed to send */
+	long rttUsec = 0;     /**< the round trip time, when answered */
+};
+
+/**
+ * An asynchronous engine, owning a wol_async, for probing many hosts at once.
+ * Move-only.
+ */
+class prober {
+public:
+	/**
+	 * @param maxOps - the most probes outstanding, at most 65536
+	 * @param flags - WOL_ASYNC_POLL to force the poll backend, or 0
+	 *
+	 * @throw std::system_error if the engine cannot be created
+	 */
+	explicit prober (int maxOps = 1024, int flags = 0)
+		: eng_ (wol_async_create (maxOps, flags)), maxOps_ (maxOps)
+	{
+		if (eng_ == nullptr) {
+			detail::throw_errno ("wol_async_create");
+		}
+	}
+
+	~prober () { reset (); }
+
+	prober (const prober &) = delete;
+	prober &operator= (const prober &) = delete;
+	prober (prober &&other) noexcept : eng_ (other.eng_), maxOps_ (other.maxOps_) { other.eng_ = nullptr; }
+	prober &operator= (prober &&other) noexcept
+	{
+		if (this != &other) {
+			reset ();
+			eng_ = other.eng_;
+			maxOps_ = other.maxOps_;
+			other.eng_ = nullptr;
+		}
+		return *this;
+	}
+
+	wol_async *get () const noexcept { return eng_; }
+
+	/**
+	 * Probes each IP address with an ICMP echo request, keeping up to maxOps
+	 * outstanding, and waits for every answer or timeout.
+	 *
+	 * @param ipAddrs - the IP addresses, in dotted decimal
+	 * @param results - populated with the result for each address, at least as long as ipAddrs
+	 * @param timeoutMs - the time to wait for each reply
+	 *
+	 * @return the number of hosts that answered
+	 */
+	int probe (span<const char *const> ipAddrs, span<probe_result> results, int timeoutMs = 1000) const
+	{
+		std::size_t next = 0;
+		int answered = 0;
+
+		if (results.size () < ipAddrs.size ()) {
+			throw std::invalid_argument ("wol::prober: results span shorter than the batch");
+		}
+
+		/**
+		 * Keep the engine full, submitting more as probes complete.
+		 */
+		while (next < ipAddrs.size () || wol_async_pending (eng_) > 0) {
+			while (next < ipAddrs.size () && wol_async_pending (eng_) < maxOps_) {
+				results [next] = probe_result {};
+				if (wol_async_probe (eng_, ipAddrs [next], timeoutMs, on_probe, &results [next]) != 0) {
+					results [next].status = -1;
+				}
+				next++;
+			}
+			wol_async_poll (eng_, -1);
+		}
+
+		for (std::size_t i = 0; i < ipAddrs.size (); i++) {
+			if (results [i].status == 0) {
+				answered++;
+			}
+		}
+		return answered;
+	}
+
+private:
+	static void on_probe (const wol_async_result *result)
+	{
+		probe_result *out = static_cast<probe_result *> (result->arg);
+
+		out->status = result->status;
+		out->rttUsec = result->rttUsec;
+	}
+
+	void reset () noexcept
+	{
+		if (eng_ != nullptr) {
+			wol_async_destroy (eng_);
+			eng_ = nullptr;
+		}
+	}
+
+	wol_async *eng_;
+	int maxOps_;
+};
+
+} // namespace wol
+
+#endif /* WOL_LIB_HPP */
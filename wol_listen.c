@@ -0,0 +1,654 @@
+/**
+ * @file wol_listen.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Functions to receive, validate and count magic packets.
+ * @details The listener binds the UDP wake ports, 7, 9 and 60000 by default,
+ * and optionally an AF_PACKET socket for EtherType 0x0842 frames. On Linux the
+ * sockets are drained with recvmmsg(), a batch of datagrams per system call,
+ * and kernel drops are read from SO_MEMINFO and PACKET_STATISTICS. Each
+ * payload is checked for the layout send_wol() builds, and the deliveries
+ * are counted per MAC address in an open addressing hash table. Deliveries
+ * announced with wol_listen_expect() and not received are reported as lost.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* recvmmsg() */
+#endif
+
+#include "wol_listen.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#if defined(__linux__)
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/sock_diag.h>
+#endif
+
+#define WOL_LISTEN_BATCH    64          /**< datagrams per recvmmsg() call */
+#define WOL_LISTEN_BUF      128         /**< receive buffer per datagram, longer ones are invalid */
+#define WOL_LISTEN_DRAIN    64          /**< batches per socket per poll, so one busy socket cannot starve the rest */
+#define WOL_LISTEN_RCVBUF   (4 << 20)   /**< socket receive buffer size */
+#define WOL_LISTEN_EMPTY    (~(wol_mac)0)
+#define WOL_ETHERTYPE       0x0842
+
+static const int defaultPorts [WOL_LISTEN_DEF_PORTS] = { 7, 9, 60000 };
+
+
+/**
+ * The deliveries to one MAC address.
+ */
+struct listen_entry {
+	wol_mac mac;                     /**< WOL_LISTEN_EMPTY for a free slot */
+	uint64_t delivered;
+	uint64_t expected;
+};
+
+/**
+ * One receiving socket.
+ */
+struct listen_sock {
+	int fd;
+	int l2;                          /**< 1 for the AF_PACKET socket */
+	uint32_t drops;                  /**< the last SO_MEMINFO drop count seen */
+};
+
+/**
+ * The listener. Owns the sockets, the receive buffers and the per MAC table.
+ */
+struct wol_listener {
+	struct listen_sock *socks;
+	struct pollfd *pfds;
+	int sockCount;
+	struct listen_entry *table;
+	unsigned int mask;
+	unsigned int used;
+	wol_listen_stats totals;         /**< packets, valid, invalid, drops and macs */
+	struct timespec first;           /**< when the first valid packets arrived */
+	struct timespec last;            /**< when the last valid packets arrived */
+	uint64_t firstValid;             /**< the number of the first valid packets */
+	unsigned char bufs [WOL_LISTEN_BATCH][WOL_LISTEN_BUF];
+#if defined(__linux__)
+	struct mmsghdr msgs [WOL_LISTEN_BATCH];
+	struct iovec iovs [WOL_LISTEN_BATCH];
+	struct sockaddr_ll names [WOL_LISTEN_BATCH];
+#endif
+};
+
+
+/**
+ * Function to check a payload for the magic packet layout: 6 x 0xff, then
+ * 16 x a MAC address, optionally followed by a 4 or 6 byte SecureOn password.
+ *
+ * @param payload - the UDP payload, or the frame after the Ethernet header
+ * @param len - the length of the payload
+ * @param mac - populated with the MAC address, may be NULL
+ *
+ * @return success or failure of the validation
+ * @retval 0 - a magic packet
+ * @retval -1 - not a magic packet
+ */
+int wol_listen_valid (const unsigned char *payload, int len, wol_mac *mac)
+{
+	static const unsigned char sync [6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+	if (len != WOL_PACKET_LEN && len != WOL_PACKET_LEN + 4 && len != WOL_PACKET_LEN + 6) {
+		return (-1);
+	}
+
+	/**
+     * Comparing the copies with themselves shifted by one copy checks that
+     * all 16 are the same, in one memcmp().
+     */
+	if (memcmp (payload, sync, 6) != 0 || memcmp (payload + 12, payload + 6, WOL_PACKET_LEN - 12) != 0) {
+		return (-1);
+	}
+	if (mac != NULL) {
+		*mac = wol_mac_from_bytes (payload + 6);
+	}
+	return (0);
+}
+
+
+/**
+ * Function to find the table entry of a MAC address, optionally adding it.
+ * The table is doubled when it becomes half full.
+ *
+ * @return the entry, or NULL if not found, or the table could not be grown
+ */
+static struct listen_entry *listen_entry (wol_listener *lsn, wol_mac mac, int add)
+{
+	unsigned int slot = wol_mac_hash (mac) & lsn->mask;
+
+	while (lsn->table [slot].mac != WOL_LISTEN_EMPTY) {
+		if (lsn->table [slot].mac == mac) {
+			return (&lsn->table [slot]);
+		}
+		slot = (slot + 1) & lsn->mask;
+	}
+	if (!add) {
+		return (NULL);
+	}
+
+	if ((lsn->used + 1) * 2 > lsn->mask + 1) {
+		struct listen_entry *old = lsn->table;
+		unsigned int oldSize = lsn->mask + 1, i;
+		struct listen_entry *table = malloc ((size_t)oldSize * 2 * sizeof (struct listen_entry));
+
+		if (table == NULL) {
+			return (NULL);
+		}
+		for (i = 0; i < oldSize * 2; i++) {
+			table [i].mac = WOL_LISTEN_EMPTY;
+		}
+		lsn->table = table;
+		lsn->mask = oldSize * 2 - 1;
+		for (i = 0; i < oldSize; i++) {
+			if (old [i].mac != WOL_LISTEN_EMPTY) {
+				unsigned int s = wol_mac_hash (old [i].mac) & lsn->mask;
+
+				while (table [s].mac != WOL_LISTEN_EMPTY) {
+					s = (s + 1) & lsn->mask;
+				}
+				table [s] = old [i];
+			}
+		}
+		free (old);
+
+		slot = wol_mac_hash (mac) & lsn->mask;
+		while (table [slot].mac != WOL_LISTEN_EMPTY) {
+			slot = (slot + 1) & lsn->mask;
+		}
+	}
+
+	lsn->table [slot].mac = mac;
+	lsn->table [slot].delivered = 0;
+	lsn->table [slot].expected = 0;
+	lsn->used++;
+
+	return (&lsn->table [slot]);
+}
+
+
+/**
+ * Function to open a non-blocking UDP socket bound to a wake port, with a
+ * large receive buffer.
+ *
+ * @return the socket descriptor, or -1 on failure
+ */
+static int listen_open_udp (int port)
+{
+	struct sockaddr_in sap;
+	int fd, optval = 1, rcvBuf = WOL_LISTEN_RCVBUF;
+
+	if ((fd = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+		return (-1);
+	}
+	setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, (char *)&optval, sizeof (optval));
+#if defined(__linux__)
+	/**
+     * Past the rmem_max limit when privileged.
+     */
+	if (setsockopt (fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvBuf, sizeof (rcvBuf)) < 0) {
+		setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof (rcvBuf));
+	}
+#else
+	setsockopt (fd, SOL_SOCKET, SO_RCVBUF, (char *)&rcvBuf, sizeof (rcvBuf));
+#endif
+
+	memset (&sap, 0, sizeof (sap));
+	sap.sin_family = AF_INET;
+	sap.sin_addr.s_addr = htonl(INADDR_ANY);
+	sap.sin_port = htons(port);
+	if (bind (fd, (struct sockaddr *)&sap, sizeof (sap)) < 0 ||
+		fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) < 0) {
+		close (fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+
+#if defined(__linux__)
+/**
+ * Function to open a non-blocking packet socket receiving EtherType 0x0842
+ * frames, on one interface or on all of them.
+ *
+ * @return the socket descriptor, or -1 on failure. Needs CAP_NET_RAW.
+ */
+static int listen_open_l2 (const char *ifName)
+{
+	struct sockaddr_ll sll;
+	int fd, rcvBuf = WOL_LISTEN_RCVBUF;
+
+	/**
+     * A datagram packet socket delivers the frame payload, without the
+     * Ethernet header.
+     */
+	if ((fd = socket (AF_PACKET, SOCK_DGRAM, htons(WOL_ETHERTYPE))) < 0) {
+		return (-1);
+	}
+	if (setsockopt (fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvBuf, sizeof (rcvBuf)) < 0) {
+		setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof (rcvBuf));
+	}
+	if (ifName != NULL && strcmp (ifName, "") != 0) {
+		memset (&sll, 0, sizeof (sll));
+		sll.sll_family = AF_PACKET;
+		sll.sll_protocol = htons(WOL_ETHERTYPE);
+		if ((sll.sll_ifindex = (int)if_nametoindex (ifName)) == 0 ||
+			bind (fd, (struct sockaddr *)&sll, sizeof (sll)) < 0) {
+			close (fd);
+			return (-1);
+		}
+	}
+	if (fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) < 0) {
+		close (fd);
+		return (-1);
+	}
+	return (fd);
+}
+#endif
+
+
+/**
+ * Function to open a magic packet listener.
+ *
+ * @param ports - the UDP ports to listen on, NULL for 7, 9 and 60000
+ * @param portCount - the number of ports, 0 with a non-NULL ports for none
+ * @param ifName - the interface to capture frames on, NULL or "" for all
+ * @param flags - WOL_LISTEN_L2 to also capture EtherType 0x0842 frames
+ *
+ * @return the new listener, or NULL on failure. Ports below 1024 and frame
+ * capture need privileges.
+ */
+wol_listener *wol_listen_open (const int *ports, int portCount, const char *ifName, int flags)
+{
+	wol_listener *lsn;
+	unsigned int i;
+	int j;
+
+#if !defined(__linux__)
+	if (flags & WOL_LISTEN_L2) {
+		errno = ENOTSUP;
+		return (NULL);
+	}
+#endif
+	if (ports == NULL) {
+		ports = defaultPorts;
+		portCount = WOL_LISTEN_DEF_PORTS;
+	}
+	if (portCount < 0 || (portCount == 0 && !(flags & WOL_LISTEN_L2))) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	if ((lsn = calloc (1, sizeof (wol_listener))) == NULL) {
+		return (NULL);
+	}
+	lsn->socks = calloc (portCount + 1, sizeof (struct listen_sock));
+	lsn->pfds = calloc (portCount + 1, sizeof (struct pollfd));
+	lsn->mask = 1023;
+	lsn->table = malloc ((lsn->mask + 1) * sizeof (struct listen_entry));
+	if (lsn->socks == NULL || lsn->pfds == NULL || lsn->table == NULL) {
+		wol_listen_close (lsn);
+		return (NULL);
+	}
+	for (i = 0; i <= lsn->mask; i++) {
+		lsn->table [i].mac = WOL_LISTEN_EMPTY;
+	}
+
+	for (j = 0; j < portCount; j++) {
+		if ((lsn->socks [j].fd = listen_open_udp (ports [j])) < 0) {
+			wol_listen_close (lsn);
+			return (NULL);
+		}
+		lsn->sockCount++;
+	}
+#if defined(__linux__)
+	if (flags & WOL_LISTEN_L2) {
+		if ((lsn->socks [j].fd = listen_open_l2 (ifName)) < 0) {
+			wol_listen_close (lsn);
+			return (NULL);
+		}
+		lsn->socks [j].l2 = 1;
+		lsn->sockCount++;
+	}
+#else
+	(void)ifName;
+#endif
+
+	for (j = 0; j < lsn->sockCount; j++) {
+		lsn->pfds [j].fd = lsn->socks [j].fd;
+		lsn->pfds [j].events = POLLIN;
+	}
+
+	return (lsn);
+}
+
+
+/**
+ * Function to close a magic packet listener.
+ *
+ * @param lsn - the listener to close, may be NULL
+ */
+void wol_listen_close (wol_listener *lsn)
+{
+	int i;
+
+	if (lsn == NULL) {
+		return;
+	}
+	for (i = 0; i < lsn->sockCount; i++) {
+		close (lsn->socks [i].fd);
+	}
+	free (lsn->socks);
+	free (lsn->pfds);
+	free (lsn->table);
+	free (lsn);
+}
+
+
+/**
+ * Function to count one received payload.
+ *
+ * @return 1 if a magic packet, else 0
+ */
+static int listen_count (wol_listener *lsn, const unsigned char *payload, int len)
+{
+	struct listen_entry *entry;
+	wol_mac mac;
+
+	lsn->totals.packets++;
+	if (wol_listen_valid (payload, len, &mac) < 0) {
+		lsn->totals.invalid++;
+		return (0);
+	}
+	lsn->totals.valid++;
+	if ((entry = listen_entry (lsn, mac, 1)) != NULL) {
+		entry->delivered++;
+	}
+	return (1);
+}
+
+
+/**
+ * Function to drain one socket, up to WOL_LISTEN_DRAIN batches.
+ *
+ * @return the number of magic packets received
+ */
+static int listen_drain (wol_listener *lsn, struct listen_sock *sock)
+{
+	int valid = 0, batch, i, n;
+
+	for (batch = 0; batch < WOL_LISTEN_DRAIN; batch++) {
+#if defined(__linux__)
+		memset (lsn->msgs, 0, sizeof (lsn->msgs));
+		for (i = 0; i < WOL_LISTEN_BATCH; i++) {
+			lsn->iovs [i].iov_base = lsn->bufs [i];
+			lsn->iovs [i].iov_len = WOL_LISTEN_BUF;
+			lsn->msgs [i].msg_hdr.msg_iov = &lsn->iovs [i];
+			lsn->msgs [i].msg_hdr.msg_iovlen = 1;
+			if (sock->l2) {
+				lsn->msgs [i].msg_hdr.msg_name = &lsn->names [i];
+				lsn->msgs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_ll);
+			}
+		}
+		if ((n = recvmmsg (sock->fd, lsn->msgs, WOL_LISTEN_BATCH, MSG_DONTWAIT, NULL)) <= 0) {
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			struct msghdr *hdr = &lsn->msgs [i].msg_hdr;
+
+			/**
+             * The packet socket also sees this host's own outgoing frames.
+             */
+			if (sock->l2 && lsn->names [i].sll_pkttype == PACKET_OUTGOING) {
+				continue;
+			}
+			if (hdr->msg_flags & MSG_TRUNC) {
+				lsn->totals.packets++;
+				lsn->totals.invalid++;
+				continue;
+			}
+			valid += listen_count (lsn, lsn->bufs [i], (int)lsn->msgs [i].msg_len);
+		}
+#else
+		for (i = 0; i < WOL_LISTEN_BATCH; i++) {
+			ssize_t len = recv (sock->fd, (char *)lsn->bufs [0], WOL_LISTEN_BUF, 0);
+
+			if (len < 0) {
+				break;
+			}
+			valid += listen_count (lsn, lsn->bufs [0], (int)len);
+		}
+		n = i;
+#endif
+		if (n < WOL_LISTEN_BATCH) {
+			break;
+		}
+	}
+
+#if defined(__linux__)
+	if (sock->l2) {
+		struct tpacket_stats st;
+		socklen_t len = sizeof (st);
+
+		/**
+         * Reading the statistics resets them, so they are accumulated.
+         */
+		if (getsockopt (sock->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+			lsn->totals.drops += st.tp_drops;
+		}
+	}
+#if defined(SO_MEMINFO)
+	else {
+		uint32_t mem [SK_MEMINFO_VARS];
+		socklen_t len = sizeof (mem);
+
+		/**
+         * The socket's drop count is cumulative, so the increase is added.
+         */
+		if (getsockopt (sock->fd, SOL_SOCKET, SO_MEMINFO, mem, &len) == 0 && len > SK_MEMINFO_DROPS * sizeof (uint32_t)) {
+			lsn->totals.drops += (uint32_t)(mem [SK_MEMINFO_DROPS] - sock->drops);
+			sock->drops = mem [SK_MEMINFO_DROPS];
+		}
+	}
+#endif
+#endif
+
+	return (valid);
+}
+
+
+/**
+ * Function to wait for magic packets, and receive every one queued.
+ *
+ * @param lsn - the listener
+ * @param timeoutMs - how long to wait for the first, 0 not to wait, -1 to wait forever
+ *
+ * @return the number of magic packets received, or -1 on failure
+ */
+int wol_listen_poll (wol_listener *lsn, int timeoutMs)
+{
+	int i, n, valid = 0;
+
+	while ((n = poll (lsn->pfds, lsn->sockCount, timeoutMs)) < 0) {
+		if (errno != EINTR) {
+			return (-1);
+		}
+	}
+	if (n == 0) {
+		return (0);
+	}
+
+	for (i = 0; i < lsn->sockCount; i++) {
+		if (lsn->pfds [i].revents & POLLIN) {
+			valid += listen_drain (lsn, &lsn->socks [i]);
+		}
+	}
+
+	/**
+     * The clock is read once per poll, not per packet.
+     */
+	if (valid > 0) {
+		clock_gettime (CLOCK_MONOTONIC, &lsn->last);
+		if (lsn->totals.valid == (uint64_t)valid) {
+			lsn->first = lsn->last;
+			lsn->firstValid = valid;
+		}
+	}
+
+	return (valid);
+}
+
+
+/**
+ * Function to get the number of magic packets received for a MAC address.
+ *
+ * @param lsn - the listener
+ * @param mac - the MAC address
+ *
+ * @return the number of deliveries
+ */
+uint64_t wol_listen_count (const wol_listener *lsn, wol_mac mac)
+{
+	struct listen_entry *entry = listen_entry ((wol_listener *)lsn, mac, 0);
+
+	return (entry != NULL ? entry->delivered : 0);
+}
+
+
+/**
+ * Function to announce deliveries to a MAC address, for the loss count.
+ * Typically called with the number of packets a sender is about to send.
+ *
+ * @param lsn - the listener
+ * @param mac - the MAC address
+ * @param count - the number of deliveries to add to those expected
+ *
+ * @return success or failure
+ * @retval 0 - success
+ * @retval -1 - failure to grow the table
+ */
+int wol_listen_expect (wol_listener *lsn, wol_mac mac, uint64_t count)
+{
+	struct listen_entry *entry = listen_entry (lsn, mac, 1);
+
+	if (entry == NULL) {
+		return (-1);
+	}
+	entry->expected += count;
+	return (0);
+}
+
+
+/**
+ * Function to get the listener's totals. The loss is computed per MAC
+ * address, so duplicates to one address do not hide loss to another.
+ *
+ * @param lsn - the listener
+ * @param stats - populated with the totals
+ */
+void wol_listen_get_stats (const wol_listener *lsn, wol_listen_stats *stats)
+{
+	unsigned int i;
+	double elapsed;
+
+	*stats = lsn->totals;
+	for (i = 0; i <= lsn->mask; i++) {
+		const struct listen_entry *entry = &lsn->table [i];
+
+		if (entry->mac == WOL_LISTEN_EMPTY) {
+			continue;
+		}
+		if (entry->delivered > 0) {
+			stats->macs++;
+		}
+		stats->expected += entry->expected;
+		if (entry->expected > entry->delivered) {
+			stats->lost += entry->expected - entry->delivered;
+		}
+	}
+
+	elapsed = (lsn->last.tv_sec - lsn->first.tv_sec) + (lsn->last.tv_nsec - lsn->first.tv_nsec) / 1e9;
+	stats->rate = (elapsed > 0) ? (stats->valid - lsn->firstValid) / elapsed : 0;
+}
+
+
+/**
+ * Function to walk the per MAC address counts, in no particular order.
+ *
+ * @param lsn - the listener
+ * @param cb - called for each MAC address received or expected
+ * @param arg - passed to the callback
+ *
+ * @return the callback's nonzero return if it stopped the walk, else 0
+ */
+int wol_listen_foreach (const wol_listener *lsn, wol_listen_cb cb, void *arg)
+{
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i <= lsn->mask; i++) {
+		const struct listen_entry *entry = &lsn->table [i];
+
+		if (entry->mac != WOL_LISTEN_EMPTY &&
+			(rc = cb (arg, entry->mac, entry->delivered, entry->expected)) != 0) {
+			return (rc);
+		}
+	}
+	return (0);
+}
+
+
+/**
+ * Function to clear the listener's counts, and the expected deliveries.
+ *
+ * @param lsn - the listener
+ */
+void wol_listen_reset (wol_listener *lsn)
+{
+	unsigned int i;
+
+	for (i = 0; i <= lsn->mask; i++) {
+		lsn->table [i].mac = WOL_LISTEN_EMPTY;
+	}
+	lsn->used = 0;
+	memset (&lsn->totals, 0, sizeof (lsn->totals));
+	memset (&lsn->first, 0, sizeof (lsn->first));
+	memset (&lsn->last, 0, sizeof (lsn->last));
+	lsn->firstValid = 0;
+}
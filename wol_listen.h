@@ -0,0 +1,77 @@
+/**
+ * @file wol_listen.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_listen.c
+ * @details Provides the function prototypes of the magic packet listener.
+ * The listener receives magic packets on the UDP wake ports, and optionally
+ * as EtherType 0x0842 frames, validates them, and counts the deliveries to
+ * each MAC address, so a sender can be checked and measured on one box.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_LISTEN_H
+#define WOL_LISTEN_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Flags for wol_listen_open(). */
+#define WOL_LISTEN_L2      0x1   /**< also capture EtherType 0x0842 frames, Linux only */
+
+/** The number of UDP ports listened on by default: 7, 9 and 60000. */
+#define WOL_LISTEN_DEF_PORTS  3
+
+/**
+ * The listener's totals.
+ */
+typedef struct wol_listen_stats {
+	uint64_t packets;     /**< datagrams and frames received */
+	uint64_t valid;       /**< well formed magic packets */
+	uint64_t invalid;     /**< anything else */
+	uint64_t drops;       /**< dropped by the kernel, the receive buffer full */
+	uint64_t macs;        /**< distinct MAC addresses woken */
+	uint64_t expected;    /**< deliveries announced with wol_listen_expect() */
+	uint64_t lost;        /**< announced deliveries not received */
+	double rate;          /**< valid packets per second, first to last */
+} wol_listen_stats;
+
+/** Callback for wol_listen_foreach(). A nonzero return stops the walk. */
+typedef int (*wol_listen_cb) (void *arg, wol_mac mac, uint64_t delivered, uint64_t expected);
+
+/** Opaque magic packet listener. */
+typedef struct wol_listener wol_listener;
+
+wol_listener *wol_listen_open (const int *ports, int portCount, const char *ifName, int flags);
+void wol_listen_close (wol_listener *lsn);
+int wol_listen_poll (wol_listener *lsn, int timeoutMs);
+uint64_t wol_listen_count (const wol_listener *lsn, wol_mac mac);
+int wol_listen_expect (wol_listener *lsn, wol_mac mac, uint64_t count);
+void wol_listen_get_stats (const wol_listener *lsn, wol_listen_stats *stats);
+int wol_listen_foreach (const wol_listener *lsn, wol_listen_cb cb, void *arg);
+void wol_listen_reset (wol_listener *lsn);
+int wol_listen_valid (const unsigned char *payload, int len, wol_mac *mac);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_LISTEN_H */
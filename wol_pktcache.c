@@ -0,0 +1,186 @@
+/**
+ * @file wol_pktcache.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Precomputed magic packet cache, keyed by MAC address.
+ * @details Keeps a ready-to-send magic packet for each known MAC address in one
+ * contiguous arena of cache line aligned slots, indexed by an open addressing
+ * hash table on the packed MAC address. Periodic re-wake sweeps of the same
+ * fleet pass the arena slices straight to wol_ctx_send_packets(), with no
+ * per-send packet construction. The arena does not move, so the returned
+ * packet pointers stay valid until the cache is destroyed.
+ * A cache is not safe for concurrent inserts; lookups may run concurrently
+ * with each other.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_lib.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** The size of one arena slot: the packet rounded up to two 64 byte cache lines. */
+#define PKTCACHE_SLOT   128
+#define PKTCACHE_ALIGN  64
+
+
+/**
+ * The magic packet cache.
+ */
+struct wol_pktcache {
+	unsigned char *arena;      /**< capacity x PKTCACHE_SLOT bytes of packets */
+	wol_mac *macs;             /**< the MAC address of each arena slot */
+	uint32_t *index;           /**< hash slots, holding arena slot + 1 */
+	uint32_t mask;             /**< the number of hash slots minus one */
+	int capacity;              /**< the number of arena slots */
+	int count;                 /**< the number of arena slots in use */
+};
+
+
+/**
+ * Function to create a magic packet cache.
+ *
+ * @param capacity - the maximum number of MAC addresses the cache holds
+ *
+ * @return the new cache, or NULL on failure to allocate
+ */
+wol_pktcache *wol_pktcache_create (int capacity)
+{
+	wol_pktcache *cache;
+	uint32_t slots = 16;
+	void *arena;
+	
+	if (capacity <= 0) {
+		return (NULL);
+	}
+	while (slots < (uint32_t)capacity * 2) {
+		slots <<= 1;
+	}
+	
+	if ((cache = calloc (1, sizeof (wol_pktcache))) == NULL) {
+		return (NULL);
+	}
+	if (posix_memalign (&arena, PKTCACHE_ALIGN, (size_t)capacity * PKTCACHE_SLOT) != 0) {
+		free (cache);
+		return (NULL);
+	}
+	cache->arena = arena;
+	cache->macs = malloc ((size_t)capacity * sizeof (wol_mac));
+	cache->index = calloc (slots, sizeof (uint32_t));
+	if (cache->macs == NULL || cache->index == NULL) {
+		wol_pktcache_destroy (cache);
+		return (NULL);
+	}
+	cache->mask = slots - 1;
+	cache->capacity = capacity;
+	
+	return (cache);
+}
+
+
+/**
+ * Function to release a magic packet cache. Packet pointers returned by the
+ * cache are invalid afterwards.
+ *
+ * @param cache - the cache to release, may be NULL
+ */
+void wol_pktcache_destroy (wol_pktcache *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+	free (cache->arena);
+	free (cache->macs);
+	free (cache->index);
+	free (cache);
+}
+
+
+/**
+ * Function to find the hash slot of a MAC address: the slot holding it, or
+ * the empty slot where it belongs.
+ */
+static uint32_t wol_pktcache_slot (const wol_pktcache *cache, wol_mac mac)
+{
+	uint32_t slot = wol_mac_hash (mac) & cache->mask;
+	
+	while (cache->index [slot] != 0 && cache->macs [cache->index [slot] - 1] != mac) {
+		slot = (slot + 1) & cache->mask;
+	}
+	return (slot);
+}
+
+
+/**
+ * Function to look up the cached magic packet of a MAC address.
+ *
+ * @param cache - the cache
+ * @param mac - the packed MAC address
+ *
+ * @return the WOL_PACKET_LEN byte packet, or NULL if the address is not cached
+ */
+const unsigned char *wol_pktcache_find (const wol_pktcache *cache, wol_mac mac)
+{
+	uint32_t entry = cache->index [wol_pktcache_slot (cache, mac)];
+	
+	return (entry != 0) ? cache->arena + (size_t)(entry - 1) * PKTCACHE_SLOT : NULL;
+}
+
+
+/**
+ * Function to get the magic packet of a MAC address, building and caching
+ * it on the first request.
+ *
+ * @param cache - the cache
+ * @param mac - the packed MAC address
+ *
+ * @return the WOL_PACKET_LEN byte packet, or NULL if the cache is full
+ */
+const unsigned char *wol_pktcache_get (wol_pktcache *cache, wol_mac mac)
+{
+	uint32_t slot = wol_pktcache_slot (cache, mac);
+	unsigned char *packet;
+	
+	if (cache->index [slot] != 0) {
+		return (cache->arena + (size_t)(cache->index [slot] - 1) * PKTCACHE_SLOT);
+	}
+	if (cache->count == cache->capacity) {
+		return (NULL);
+	}
+	
+	packet = cache->arena + (size_t)cache->count * PKTCACHE_SLOT;
+	wol_build_magic (mac, packet);
+	cache->macs [cache->count] = mac;
+	cache->index [slot] = ++cache->count;
+	
+	return (packet);
+}
+
+
+/**
+ * Function to get the number of MAC addresses in the cache.
+ *
+ * @param cache - the cache
+ *
+ * @return the number of cached packets
+ */
+int wol_pktcache_count (const wol_pktcache *cache)
+{
+	return (cache->count);
+}
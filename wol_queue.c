@@ -0,0 +1,386 @@
+/**
+ * @file wol_queue.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Lock-free multi-producer wake submission queue, and its sender thread.
+ * @details Wake requests are packed into one 64 bit word, the MAC address and
+ * the number of copies, and put into a bounded ring of sequenced cells. A
+ * submitter claims a cell with one compare and swap, and publishes it with a
+ * release store of the cell's sequence; no lock is taken. The sender thread
+ * is the only consumer. It drains the ring in batches, and sends each batch
+ * with wol_ctx_send_batch() on its one socket. When the ring is empty it
+ * sleeps, and the first submitter to find it asleep wakes it.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define QUEUE_IDLE_MS   100     /**< the longest the sender sleeps without a wake up */
+
+
+/**
+ * A ring cell. The sequence tells whose turn it is: equal to the position,
+ * the cell is free for the submitter claiming that position; one more, it
+ * holds a request for the sender.
+ */
+struct queue_cell {
+	uint64_t seq;
+	uint64_t request;                /**< the MAC address, and the copies in the top byte */
+};
+
+/**
+ * The queue. The submitters' and the sender's positions are kept on their
+ * own cache lines, so they do not slow each other down.
+ */
+struct wol_queue {
+	uint64_t tail __attribute__((aligned(64)));   /**< the next position to claim */
+	uint64_t rejected;                             /**< updated by submitters */
+	int sleeping;                                  /**< the sender is waiting for work */
+
+	uint64_t head __attribute__((aligned(64)));   /**< the next position to take, the sender's */
+	uint64_t completed;                            /**< the positions before it are sent */
+	uint64_t sent;
+	uint64_t failed;
+	uint64_t batches;
+	int stop;
+
+	struct queue_cell *cells __attribute__((aligned(64)));
+	uint64_t mask;                   /**< the number of cells minus one */
+	wol_ctx *ctx;                    /**< the sender's socket */
+	pthread_t thread;
+	pthread_mutex_t lock;            /**< for sleeping and waking only */
+	pthread_cond_t work;             /**< signalled when the sender is woken */
+	pthread_cond_t done;             /**< broadcast after each batch, for wol_queue_flush() */
+};
+
+
+/**
+ * Function to compute an absolute time for pthread_cond_timedwait().
+ */
+static void queue_deadline (struct timespec *ts, int ms)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	ts->tv_sec = tv.tv_sec + ms / 1000;
+	ts->tv_nsec = tv.tv_usec * 1000L + (ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+
+/**
+ * Function to take the requests published in the ring, in order, up to a
+ * batch of magic packets. Called by the sender thread only.
+ *
+ * @param q - the queue
+ * @param hwAddrs - populated with a hardware address per copy
+ *
+ * @return the number of magic packets to send
+ */
+static int queue_take (wol_queue *q, unsigned char (*hwAddrs)[6])
+{
+	int n = 0;
+
+	for (;;) {
+		struct queue_cell *cell = &q->cells [q->head & q->mask];
+		uint64_t request;
+		int repeat;
+
+		if (__atomic_load_n (&cell->seq, __ATOMIC_ACQUIRE) != q->head + 1) {
+			break;
+		}
+		request = cell->request;
+		repeat = (int)(request >> 56);
+		if (n + repeat > WOL_QUEUE_BATCH) {
+			break;
+		}
+		while (repeat-- > 0) {
+			wol_mac_to_bytes (request & 0xffffffffffffULL, hwAddrs [n++]);
+		}
+
+		/** Hand the cell back, for the submitter one lap later. */
+		__atomic_store_n (&cell->seq, q->head + q->mask + 1, __ATOMIC_RELEASE);
+		q->head++;
+	}
+
+	return (n);
+}
+
+
+/**
+ * The sender thread. Sends batches until the ring is empty, then sleeps
+ * until woken. On stop, the ring is drained first.
+ */
+static void *queue_sender (void *arg)
+{
+	wol_queue *q = arg;
+	unsigned char hwAddrs [WOL_QUEUE_BATCH][6];
+	int status [WOL_QUEUE_BATCH];
+
+	for (;;) {
+		int n = queue_take (q, hwAddrs);
+
+		if (n > 0) {
+			int sent = wol_ctx_send_batch (q->ctx, hwAddrs, n, status);
+
+			sent = sent < 0 ? 0 : sent;
+			__atomic_add_fetch (&q->sent, sent, __ATOMIC_RELAXED);
+			__atomic_add_fetch (&q->failed, n - sent, __ATOMIC_RELAXED);
+			__atomic_add_fetch (&q->batches, 1, __ATOMIC_RELAXED);
+			__atomic_store_n (&q->completed, q->head, __ATOMIC_RELEASE);
+			pthread_mutex_lock (&q->lock);
+			pthread_cond_broadcast (&q->done);
+			pthread_mutex_unlock (&q->lock);
+			continue;
+		}
+
+		/**
+         * The ring looks empty. Announce the sleep, then look again: a
+         * submitter that published before the announcement is seen here,
+         * and one that published after it sees the announcement.
+         */
+		pthread_mutex_lock (&q->lock);
+		pthread_cond_broadcast (&q->done);
+		__atomic_store_n (&q->sleeping, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence (__ATOMIC_SEQ_CST);
+		if (__atomic_load_n (&q->cells [q->head & q->mask].seq, __ATOMIC_ACQUIRE) != q->head + 1) {
+			struct timespec ts;
+
+			if (__atomic_load_n (&q->stop, __ATOMIC_ACQUIRE)) {
+				pthread_mutex_unlock (&q->lock);
+				break;
+			}
+			queue_deadline (&ts, QUEUE_IDLE_MS);
+			pthread_cond_timedwait (&q->work, &q->lock, &ts);
+		}
+		__atomic_store_n (&q->sleeping, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock (&q->lock);
+	}
+
+	return (NULL);
+}
+
+
+/**
+ * Function to create a wake submission queue, and start its sender thread.
+ *
+ * @param bcastAddr - the destination IPv4 address string, NULL or "" for 255.255.255.255
+ * @param port - the destination UDP port, 0 for the default port 60000
+ * @param size - the number of ring slots, rounded up to a power of two, 0 for the default 4096
+ *
+ * @return the new queue, or NULL on failure
+ */
+wol_queue *wol_queue_create (const char *bcastAddr, int port, int size)
+{
+	wol_queue *q;
+	uint64_t cells = 2, i;
+
+	if (size <= 0) {
+		size = WOL_QUEUE_DEF_SIZE;
+	}
+	while (cells < (uint64_t)size) {
+		cells <<= 1;
+	}
+
+	if (posix_memalign ((void **)&q, 64, sizeof (wol_queue)) != 0) {
+		return (NULL);
+	}
+	memset (q, 0, sizeof (wol_queue));
+	if ((q->cells = malloc (cells * sizeof (struct queue_cell))) == NULL) {
+		free (q);
+		return (NULL);
+	}
+	for (i = 0; i < cells; i++) {
+		q->cells [i].seq = i;
+	}
+	q->mask = cells - 1;
+
+	if ((q->ctx = wol_ctx_create (bcastAddr, port)) == NULL) {
+		free (q->cells);
+		free (q);
+		return (NULL);
+	}
+	pthread_mutex_init (&q->lock, NULL);
+	pthread_cond_init (&q->work, NULL);
+	pthread_cond_init (&q->done, NULL);
+	if (pthread_create (&q->thread, NULL, queue_sender, q) != 0) {
+		pthread_cond_destroy (&q->done);
+		pthread_cond_destroy (&q->work);
+		pthread_mutex_destroy (&q->lock);
+		wol_ctx_destroy (q->ctx);
+		free (q->cells);
+		free (q);
+		return (NULL);
+	}
+
+	return (q);
+}
+
+
+/**
+ * Function to stop the sender thread, once the requests in the ring are
+ * sent, and release the queue. No submitter may be running.
+ *
+ * @param q - the queue to release, may be NULL
+ */
+void wol_queue_destroy (wol_queue *q)
+{
+	if (q == NULL) {
+		return;
+	}
+	pthread_mutex_lock (&q->lock);
+	__atomic_store_n (&q->stop, 1, __ATOMIC_RELEASE);
+	pthread_cond_signal (&q->work);
+	pthread_mutex_unlock (&q->lock);
+	pthread_join (q->thread, NULL);
+
+	pthread_cond_destroy (&q->done);
+	pthread_cond_destroy (&q->work);
+	pthread_mutex_destroy (&q->lock);
+	wol_ctx_destroy (q->ctx);
+	free (q->cells);
+	free (q);
+}
+
+
+/**
+ * Function to submit a wake request. Safe to call from any number of threads
+ * at once, and never blocks: a full ring is reported, not waited out.
+ *
+ * @param q - the queue
+ * @param mac - the MAC address to wake
+ * @param repeat - the number of copies of the magic packet to send, 1 to WOL_QUEUE_MAX_REPEAT, 0 for 1
+ *
+ * @return 0 if queued, or -1 with errno EAGAIN if the ring is full, or EINVAL
+ */
+int wol_queue_submit (wol_queue *q, wol_mac mac, int repeat)
+{
+	struct queue_cell *cell;
+	uint64_t pos, seq;
+
+	if (repeat == 0) {
+		repeat = 1;
+	}
+	if (repeat < 0 || repeat > WOL_QUEUE_MAX_REPEAT || mac > 0xffffffffffffULL) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	/**
+     * Claim the position at the tail. The cell is free when its sequence
+     * equals the position; one lap behind, the ring is full.
+     */
+	pos = __atomic_load_n (&q->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &q->cells [pos & q->mask];
+		seq = __atomic_load_n (&cell->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n (&q->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if ((int64_t)(seq - pos) < 0) {
+			__atomic_add_fetch (&q->rejected, 1, __ATOMIC_RELAXED);
+			errno = EAGAIN;
+			return (-1);
+		}
+		else {
+			pos = __atomic_load_n (&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	/** Fill the cell, and publish it to the sender. */
+	cell->request = mac | ((uint64_t)repeat << 56);
+	__atomic_store_n (&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	/**
+     * Wake the sender if it announced a sleep. The fence orders the publish
+     * before the check, against the sender's announce before its look.
+     */
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	if (__atomic_load_n (&q->sleeping, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock (&q->lock);
+		pthread_cond_signal (&q->work);
+		pthread_mutex_unlock (&q->lock);
+	}
+
+	return (0);
+}
+
+
+/**
+ * Function to wait until every request submitted before the call is sent.
+ *
+ * @param q - the queue
+ * @param timeoutMs - the longest to wait, in milliseconds, or -1 to wait without limit
+ *
+ * @return 0 if sent, or -1 with errno ETIMEDOUT
+ */
+int wol_queue_flush (wol_queue *q, int timeoutMs)
+{
+	uint64_t target = __atomic_load_n (&q->tail, __ATOMIC_ACQUIRE);
+	struct timespec ts;
+	int rc = 0;
+
+	if (timeoutMs >= 0) {
+		queue_deadline (&ts, timeoutMs);
+	}
+	pthread_mutex_lock (&q->lock);
+	while ((int64_t)(__atomic_load_n (&q->completed, __ATOMIC_ACQUIRE) - target) < 0) {
+		pthread_cond_signal (&q->work);
+		if (timeoutMs < 0) {
+			pthread_cond_wait (&q->done, &q->lock);
+		}
+		else if (pthread_cond_timedwait (&q->done, &q->lock, &ts) == ETIMEDOUT) {
+			rc = -1;
+			errno = ETIMEDOUT;
+			break;
+		}
+	}
+	pthread_mutex_unlock (&q->lock);
+
+	return (rc);
+}
+
+
+/**
+ * Function to read the queue's totals. The counts are read without stopping
+ * the sender, so they may be a moment apart.
+ *
+ * @param q - the queue
+ * @param stats - populated with the totals
+ */
+void wol_queue_get_stats (wol_queue *q, wol_queue_stats *stats)
+{
+	stats->submitted = __atomic_load_n (&q->tail, __ATOMIC_ACQUIRE);
+	stats->rejected = __atomic_load_n (&q->rejected, __ATOMIC_RELAXED);
+	stats->sent = __atomic_load_n (&q->sent, __ATOMIC_RELAXED);
+	stats->failed = __atomic_load_n (&q->failed, __ATOMIC_RELAXED);
+	stats->batches = __atomic_load_n (&q->batches, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,65 @@
+/**
+ * @file wol_queue.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_queue.c
+ * @details Provides the function prototypes of the wake submission queue. Any
+ * thread submits a wake request into a bounded lock-free ring, and a single
+ * sender thread drains it in batches onto one long-lived socket. A full ring
+ * is reported to the submitter with EAGAIN, rather than blocking it.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_QUEUE_H
+#define WOL_QUEUE_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WOL_QUEUE_DEF_SIZE    4096    /**< ring slots by default */
+#define WOL_QUEUE_BATCH       256     /**< magic packets per send batch */
+#define WOL_QUEUE_MAX_REPEAT  8       /**< the most copies of one magic packet */
+
+/**
+ * The queue's totals.
+ */
+typedef struct wol_queue_stats {
+	uint64_t submitted;   /**< requests accepted into the ring */
+	uint64_t rejected;    /**< requests refused, the ring full */
+	uint64_t sent;        /**< magic packets sent */
+	uint64_t failed;      /**< magic packets the kernel refused */
+	uint64_t batches;     /**< send batches */
+} wol_queue_stats;
+
+/** Opaque wake submission queue. */
+typedef struct wol_queue wol_queue;
+
+wol_queue *wol_queue_create (const char *bcastAddr, int port, int size);
+void wol_queue_destroy (wol_queue *q);
+int wol_queue_submit (wol_queue *q, wol_mac mac, int repeat);
+int wol_queue_flush (wol_queue *q, int timeoutMs);
+void wol_queue_get_stats (wol_queue *q, wol_queue_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_QUEUE_H */
@@ -0,0 +1,804 @@
+/**
+ * @file wol_relay.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Wake relay engine: receives wake requests, and broadcasts them locally.
+ * @details The request sockets are registered with one epoll instance, and
+ * drained with recvmmsg(), a batch of datagrams per system call. Each request
+ * is matched to a target subnet, and checked against the requests of the
+ * coalescing window. New wakes are queued per target, and sent with
+ * wol_ctx_send_batch() on the target's persistent socket when the queue is
+ * full, or when the event loop has drained its sockets.
+ * The coalescing window is a hash set of (MAC address, target) keys, and a
+ * ring of the same keys in arrival order. As the window is the same for every
+ * key, expiry is always from the head of the ring. Both are allocated once,
+ * for WOL_RELAY_MAX_PENDING keys; when a burst fills them, the oldest key is
+ * forgotten early, so memory stays bounded under any request rate.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* recvmmsg() */
+#endif
+
+#include "wol_relay.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define RELAY_BATCH       64         /**< datagrams per recvmmsg() call */
+#define RELAY_DGRAM       2048       /**< the largest request datagram */
+#define RELAY_DRAIN       64         /**< batches per socket per event, so one socket cannot starve the rest */
+#define RELAY_SEND        256        /**< wakes queued per target before sending */
+#define RELAY_MAX_LISTEN  8          /**< request sockets */
+#define RELAY_EVENTS      RELAY_MAX_LISTEN
+#define RELAY_RCVBUF      (4 << 20)
+#define RELAY_EMPTY       (~(uint64_t)0)
+
+
+/**
+ * A target subnet, with its wake context and queue of wakes.
+ */
+struct relay_target {
+	uint32_t net;                      /**< the subnet address, network byte order */
+	uint32_t mask;                     /**< the netmask, network byte order */
+	wol_ctx *ctx;                      /**< sends to the subnet broadcast address */
+	unsigned char hwAddrs [RELAY_SEND][6];
+	int count;
+};
+
+/**
+ * The relay.
+ */
+struct wol_relay {
+	int epfd;
+	int port;                          /**< the destination port of the magic packets */
+	uint64_t windowNs;
+	struct relay_target *targets;
+	int targetCount;
+	int listenFds [RELAY_MAX_LISTEN];
+	int listenCount;
+	char *unixPath;                    /**< the unix socket to unlink when destroyed */
+	wol_relay_stats stats;
+
+	uint64_t *keys;                    /**< the coalescing set: (target << 48) | MAC */
+	unsigned int keyMask;
+	uint64_t *ringKeys;                /**< the coalescing window, in arrival order */
+	uint64_t *ringExpiry;              /**< when each ring key expires, monotonic ns */
+	unsigned int ringHead;
+	unsigned int ringCount;
+
+	unsigned char bufs [RELAY_BATCH][RELAY_DGRAM];
+	struct mmsghdr msgs [RELAY_BATCH];
+	struct iovec iovs [RELAY_BATCH];
+};
+
+
+/**
+ * Function to read the monotonic clock.
+ */
+static uint64_t relay_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+
+/**
+ * Function to parse an address, with an optional prefix length.
+ *
+ * @param str - "a.b.c.d" or "a.b.c.d/len"
+ * @param addr - populated with the address, network byte order
+ * @param mask - populated with the netmask, all ones without a prefix length
+ *
+ * @return 0 success, or -1 malformed
+ */
+static int relay_parse_subnet (const char *str, uint32_t *addr, uint32_t *mask)
+{
+	char buf [INET_ADDRSTRLEN + 4];
+	char *slash, *end;
+	long len = 32;
+
+	if (strlen (str) >= sizeof (buf)) {
+		return (-1);
+	}
+	strcpy (buf, str);
+	if ((slash = strchr (buf, '/')) != NULL) {
+		*slash++ = '\0';
+		len = strtol (slash, &end, 10);
+		if (end == slash || *end != '\0' || len < 0 || len > 32) {
+			return (-1);
+		}
+	}
+	if (inet_pton (AF_INET, buf, addr) != 1) {
+		return (-1);
+	}
+	*mask = (len == 0) ? 0 : htonl(0xffffffffu << (32 - len));
+
+	return (0);
+}
+
+
+/**
+ * Function to find the target subnet of a request: the configured subnet with
+ * the longest prefix that contains the requested address.
+ *
+ * @return the target index, or -1 if there is none
+ */
+static int relay_route (const wol_relay *relay, const char *subnet)
+{
+	uint32_t addr, mask;
+	int i, best = -1;
+
+	if (relay_parse_subnet (subnet, &addr, &mask) < 0) {
+		return (-1);
+	}
+
+	/**
+     * A subnet in CIDR notation is matched by its broadcast address.
+     */
+	addr |= ~mask;
+	for (i = 0; i < relay->targetCount; i++) {
+		const struct relay_target *t = &relay->targets [i];
+
+		if ((addr & t->mask) == t->net && (best < 0 || ntohl(t->mask) > ntohl(relay->targets [best].mask))) {
+			best = i;
+		}
+	}
+	return (best);
+}
+
+
+/**
+ * Function to find the slot of a key in the coalescing set, or the empty
+ * slot it would go in.
+ */
+static unsigned int relay_key_slot (const wol_relay *relay, uint64_t key)
+{
+	unsigned int slot = wol_mac_hash (key) & relay->keyMask;
+
+	while (relay->keys [slot] != RELAY_EMPTY && relay->keys [slot] != key) {
+		slot = (slot + 1) & relay->keyMask;
+	}
+	return (slot);
+}
+
+
+/**
+ * Function to remove a key from the coalescing set. The keys after it in its
+ * probe run are shifted back over the gap, so no tombstones are needed.
+ */
+static void relay_key_remove (wol_relay *relay, uint64_t key)
+{
+	unsigned int i = relay_key_slot (relay, key), j = i;
+
+	if (relay->keys [i] == RELAY_EMPTY) {
+		return;
+	}
+	for (;;) {
+		unsigned int home;
+
+		j = (j + 1) & relay->keyMask;
+		if (relay->keys [j] == RELAY_EMPTY) {
+			break;
+		}
+
+		/**
+         * Move the key at j into the gap at i, unless its home slot lies
+         * cyclically in (i, j], where it is still reachable.
+         */
+		home = wol_mac_hash (relay->keys [j]) & relay->keyMask;
+		if ((i < j) ? (home <= i || home > j) : (home <= i && home > j)) {
+			relay->keys [i] = relay->keys [j];
+			i = j;
+		}
+	}
+	relay->keys [i] = RELAY_EMPTY;
+}
+
+
+/**
+ * Function to check a wake against the coalescing window, and remember it.
+ *
+ * @return 1 if a duplicate within the window, else 0
+ */
+static int relay_coalesce (wol_relay *relay, uint64_t key, uint64_t now)
+{
+	unsigned int slot, tail;
+
+	if (relay->windowNs == 0) {
+		return (0);
+	}
+
+	/**
+     * Expire the keys whose window has closed, then forget the oldest key
+     * early if the window is still full.
+     */
+	while (relay->ringCount > 0 &&
+		   (relay->ringExpiry [relay->ringHead] <= now || relay->ringCount == WOL_RELAY_MAX_PENDING)) {
+		if (relay->ringExpiry [relay->ringHead] > now &&
+			relay->keys [relay_key_slot (relay, key)] == key) {
+			return (1);
+		}
+		relay_key_remove (relay, relay->ringKeys [relay->ringHead]);
+		relay->ringHead = (relay->ringHead + 1) & (WOL_RELAY_MAX_PENDING - 1);
+		relay->ringCount--;
+	}
+
+	slot = relay_key_slot (relay, key);
+	if (relay->keys [slot] == key) {
+		return (1);
+	}
+	relay->keys [slot] = key;
+	tail = (relay->ringHead + relay->ringCount) & (WOL_RELAY_MAX_PENDING - 1);
+	relay->ringKeys [tail] = key;
+	relay->ringExpiry [tail] = now + relay->windowNs;
+	relay->ringCount++;
+
+	return (0);
+}
+
+
+/**
+ * Function to send a target's queued wakes.
+ */
+static void relay_flush_target (wol_relay *relay, struct relay_target *t)
+{
+	int status [RELAY_SEND];
+	int sent;
+
+	if (t->count == 0) {
+		return;
+	}
+	sent = wol_ctx_send_batch (t->ctx, t->hwAddrs, t->count, status);
+	if (sent < 0) {
+		sent = 0;
+	}
+	relay->stats.sent += sent;
+	relay->stats.failed += t->count - sent;
+	t->count = 0;
+}
+
+
+/**
+ * Function to process one request datagram.
+ *
+ * @return the number of wakes queued
+ */
+static int relay_process (wol_relay *relay, const char *request, int len, uint64_t now)
+{
+	const char *p = request, *end = request + len;
+	int queued = 0;
+
+	while (p < end) {
+		char tokens [3][INET_ADDRSTRLEN + 4];
+		int count = 0, target = 0, n;
+		const char *eol = memchr (p, '\n', end - p);
+		wol_mac mac;
+
+		if (eol == NULL) {
+			eol = end;
+		}
+
+		/**
+         * Split the line into at most three tokens, so a third one is
+         * detected and the line rejected.
+         */
+		while (p < eol && count < 3) {
+			while (p < eol && isspace ((unsigned char)*p)) {
+				p++;
+			}
+			if (p == eol) {
+				break;
+			}
+			for (n = 0; p < eol && !isspace ((unsigned char)*p); p++) {
+				if (n < (int)sizeof (tokens [0]) - 1) {
+					tokens [count][n++] = *p;
+				}
+			}
+			tokens [count++][n] = '\0';
+		}
+		p = eol + 1;
+		if (count == 0) {
+			continue;
+		}
+
+		relay->stats.requests++;
+		if (count > 2 || wol_mac_parse (tokens [0], &mac) < 0 ||
+			(count == 2 && (target = relay_route (relay, tokens [1])) < 0)) {
+			relay->stats.rejected++;
+			continue;
+		}
+		if (relay_coalesce (relay, ((uint64_t)target << 48) | mac, now)) {
+			relay->stats.coalesced++;
+			continue;
+		}
+
+		wol_mac_to_bytes (mac, relay->targets [target].hwAddrs [relay->targets [target].count++]);
+		if (relay->targets [target].count == RELAY_SEND) {
+			relay_flush_target (relay, &relay->targets [target]);
+		}
+		queued++;
+	}
+
+	return (queued);
+}
+
+
+/**
+ * Function to create a wake relay. The relay starts with one target, the
+ * default for requests naming no subnet: the limited broadcast address.
+ *
+ * @param port - the destination port of the magic packets, 0 for 9
+ * @param windowMs - the coalescing window, 0 not to coalesce, -1 for the default
+ *
+ * @return the new relay, or NULL on failure
+ */
+wol_relay *wol_relay_create (int port, int windowMs)
+{
+	wol_relay *relay;
+	unsigned int i;
+
+	if ((relay = calloc (1, sizeof (wol_relay))) == NULL) {
+		return (NULL);
+	}
+	relay->port = (port > 0) ? port : 9;
+	relay->windowNs = (uint64_t)(windowMs < 0 ? WOL_RELAY_WINDOW_MS : windowMs) * 1000000ULL;
+	relay->keyMask = WOL_RELAY_MAX_PENDING * 2 - 1;
+	relay->epfd = epoll_create1 (EPOLL_CLOEXEC);
+	relay->targets = calloc (WOL_RELAY_MAX_TARGETS, sizeof (struct relay_target));
+	relay->keys = malloc ((relay->keyMask + 1) * sizeof (uint64_t));
+	relay->ringKeys = malloc (WOL_RELAY_MAX_PENDING * sizeof (uint64_t));
+	relay->ringExpiry = malloc (WOL_RELAY_MAX_PENDING * sizeof (uint64_t));
+	if (relay->epfd < 0 || relay->targets == NULL || relay->keys == NULL ||
+		relay->ringKeys == NULL || relay->ringExpiry == NULL ||
+		wol_relay_add_target (relay, "255.255.255.255") < 0) {
+		wol_relay_destroy (relay);
+		return (NULL);
+	}
+	for (i = 0; i <= relay->keyMask; i++) {
+		relay->keys [i] = RELAY_EMPTY;
+	}
+
+	for (i = 0; i < RELAY_BATCH; i++) {
+		relay->iovs [i].iov_base = relay->bufs [i];
+		relay->iovs [i].iov_len = RELAY_DGRAM;
+	}
+
+	return (relay);
+}
+
+
+/**
+ * Function to destroy a wake relay. Queued wakes are discarded, see
+ * wol_relay_flush().
+ *
+ * @param relay - the relay to destroy, may be NULL
+ */
+void wol_relay_destroy (wol_relay *relay)
+{
+	int i;
+
+	if (relay == NULL) {
+		return;
+	}
+	for (i = 0; i < relay->listenCount; i++) {
+		close (relay->listenFds [i]);
+	}
+	if (relay->unixPath != NULL) {
+		unlink (relay->unixPath);
+		free (relay->unixPath);
+	}
+	for (i = 0; i < relay->targetCount; i++) {
+		wol_ctx_destroy (relay->targets [i].ctx);
+	}
+	if (relay->epfd >= 0) {
+		close (relay->epfd);
+	}
+	free (relay->targets);
+	free (relay->keys);
+	free (relay->ringKeys);
+	free (relay->ringExpiry);
+	free (relay);
+}
+
+
+/**
+ * Function to add a target subnet. Requests naming an address in the subnet
+ * are broadcast to its broadcast address. A plain address is taken as a
+ * broadcast address, and matched exactly.
+ *
+ * @param relay - the relay
+ * @param subnet - the subnet in CIDR notation, e.g. "10.1.2.0/24", or a broadcast address
+ *
+ * @return the target index, or -1 on failure
+ */
+int wol_relay_add_target (wol_relay *relay, const char *subnet)
+{
+	struct relay_target *t;
+	char bcastAddr [INET_ADDRSTRLEN];
+	uint32_t addr, mask, bcast;
+
+	if (relay->targetCount == WOL_RELAY_MAX_TARGETS || relay_parse_subnet (subnet, &addr, &mask) < 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+	bcast = addr | ~mask;
+	inet_ntop (AF_INET, &bcast, bcastAddr, sizeof (bcastAddr));
+
+	t = &relay->targets [relay->targetCount];
+	if ((t->ctx = wol_ctx_create (bcastAddr, relay->port)) == NULL) {
+		return (-1);
+	}
+	t->net = addr & mask;
+	t->mask = mask;
+	t->count = 0;
+
+	return (relay->targetCount++);
+}
+
+
+/**
+ * Function to register a non-blocking request socket with the event loop.
+ */
+static int relay_add_listener (wol_relay *relay, int fd)
+{
+	struct epoll_event ev;
+	int rcvBuf = RELAY_RCVBUF;
+
+	if (setsockopt (fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvBuf, sizeof (rcvBuf)) < 0) {
+		setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof (rcvBuf));
+	}
+	memset (&ev, 0, sizeof (ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl (relay->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close (fd);
+		return (-1);
+	}
+	relay->listenFds [relay->listenCount++] = fd;
+
+	return (0);
+}
+
+
+/**
+ * Function to accept requests on a UDP port.
+ *
+ * @param relay - the relay
+ * @param bindAddr - the local address to bind, NULL or "" for all
+ * @param port - the port, 0 for WOL_RELAY_PORT
+ *
+ * @return success or failure
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_relay_listen_udp (wol_relay *relay, const char *bindAddr, int port)
+{
+	struct sockaddr_in sap;
+	int fd, optval = 1;
+
+	if (relay->listenCount == RELAY_MAX_LISTEN) {
+		errno = EMFILE;
+		return (-1);
+	}
+	memset (&sap, 0, sizeof (sap));
+	sap.sin_family = AF_INET;
+	sap.sin_port = htons(port > 0 ? port : WOL_RELAY_PORT);
+	sap.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bindAddr != NULL && strcmp (bindAddr, "") != 0 && inet_pton (AF_INET, bindAddr, &sap.sin_addr) != 1) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	if ((fd = socket (AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP)) < 0) {
+		return (-1);
+	}
+	setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof (optval));
+	if (bind (fd, (struct sockaddr *)&sap, sizeof (sap)) < 0) {
+		close (fd);
+		return (-1);
+	}
+	return (relay_add_listener (relay, fd));
+}
+
+
+/**
+ * Function to accept requests on a unix domain datagram socket. A stale
+ * socket file at the path is replaced, and the file is removed when the
+ * relay is destroyed.
+ *
+ * @param relay - the relay
+ * @param path - the socket path
+ *
+ * @return success or failure
+ * @retval 0 - success
+ * @retval -1 - failure
+ */
+int wol_relay_listen_unix (wol_relay *relay, const char *path)
+{
+	struct sockaddr_un sun;
+	int fd;
+
+	if (relay->listenCount == RELAY_MAX_LISTEN || relay->unixPath != NULL ||
+		strlen (path) >= sizeof (sun.sun_path)) {
+		errno = EINVAL;
+		return (-1);
+	}
+	memset (&sun, 0, sizeof (sun));
+	sun.sun_family = AF_UNIX;
+	strcpy (sun.sun_path, path);
+
+	if ((fd = socket (AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+		return (-1);
+	}
+	unlink (path);
+	if (bind (fd, (struct sockaddr *)&sun, sizeof (sun)) < 0) {
+		close (fd);
+		return (-1);
+	}
+	if ((relay->unixPath = strdup (path)) == NULL) {
+		close (fd);
+		unlink (path);
+		return (-1);
+	}
+	return (relay_add_listener (relay, fd));
+}
+
+
+/**
+ * Function to get the relay's epoll descriptor, to embed the relay in
+ * another event loop. It is readable when requests are waiting; then call
+ * wol_relay_run_once() with a timeout of 0.
+ *
+ * @param relay - the relay
+ *
+ * @return the descriptor
+ */
+int wol_relay_fd (const wol_relay *relay)
+{
+	return (relay->epfd);
+}
+
+
+/**
+ * Function to submit a request directly, without a socket. The wakes are
+ * queued, and sent when a target's queue fills, or by wol_relay_flush().
+ *
+ * @param relay - the relay
+ * @param request - one or more request lines
+ * @param len - the length of the request
+ *
+ * @return the number of wakes queued
+ */
+int wol_relay_request (wol_relay *relay, const char *request, int len)
+{
+	return (relay_process (relay, request, len, relay_now ()));
+}
+
+
+/**
+ * Function to send the queued wakes of every target.
+ *
+ * @param relay - the relay
+ *
+ * @return the number of magic packets sent
+ */
+int wol_relay_flush (wol_relay *relay)
+{
+	uint64_t sent = relay->stats.sent;
+	int i;
+
+	for (i = 0; i < relay->targetCount; i++) {
+		relay_flush_target (relay, &relay->targets [i]);
+	}
+	return ((int)(relay->stats.sent - sent));
+}
+
+
+/**
+ * Function to drain one request socket, up to RELAY_DRAIN batches.
+ *
+ * @return the number of wakes queued
+ */
+static int relay_drain (wol_relay *relay, int fd, uint64_t now)
+{
+	int queued = 0, batch, i, n;
+
+	for (batch = 0; batch < RELAY_DRAIN; batch++) {
+		memset (relay->msgs, 0, sizeof (relay->msgs));
+		for (i = 0; i < RELAY_BATCH; i++) {
+			relay->msgs [i].msg_hdr.msg_iov = &relay->iovs [i];
+			relay->msgs [i].msg_hdr.msg_iovlen = 1;
+		}
+		if ((n = recvmmsg (fd, relay->msgs, RELAY_BATCH, MSG_DONTWAIT, NULL)) <= 0) {
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			if (relay->msgs [i].msg_hdr.msg_flags & MSG_TRUNC) {
+				relay->stats.requests++;
+				relay->stats.rejected++;
+				continue;
+			}
+			queued += relay_process (relay, (char *)relay->bufs [i], (int)relay->msgs [i].msg_len, now);
+		}
+		if (n < RELAY_BATCH) {
+			break;
+		}
+	}
+	return (queued);
+}
+
+
+/**
+ * Function to run one pass of the event loop: wait for requests, drain the
+ * ready sockets, and send the wakes.
+ *
+ * @param relay - the relay
+ * @param timeoutMs - how long to wait for requests, 0 not to wait, -1 to wait forever
+ *
+ * @return the number of wakes queued by the pass, or -1 on failure
+ */
+int wol_relay_run_once (wol_relay *relay, int timeoutMs)
+{
+	struct epoll_event events [RELAY_EVENTS];
+	uint64_t now;
+	int i, n, queued = 0;
+
+	if ((n = epoll_wait (relay->epfd, events, RELAY_EVENTS, timeoutMs)) < 0) {
+		return (errno == EINTR ? 0 : -1);
+	}
+	if (n > 0) {
+		now = relay_now ();
+		for (i = 0; i < n; i++) {
+			queued += relay_drain (relay, events [i].data.fd, now);
+		}
+	}
+	wol_relay_flush (relay);
+
+	return (queued);
+}
+
+
+/**
+ * Function to run the event loop until stopped.
+ *
+ * @param relay - the relay
+ * @param stop - set nonzero, e.g. by a signal handler, to stop the loop
+ *
+ * @return 0 when stopped, or -1 on failure
+ */
+int wol_relay_run (wol_relay *relay, volatile int *stop)
+{
+	while (!*stop) {
+		if (wol_relay_run_once (relay, 100) < 0) {
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+
+/**
+ * Function to get the relay's totals.
+ *
+ * @param relay - the relay
+ * @param stats - populated with the totals
+ */
+void wol_relay_get_stats (const wol_relay *relay, wol_relay_stats *stats)
+{
+	*stats = relay->stats;
+}
+
+#else
+
+wol_relay *wol_relay_create (int port, int windowMs)
+{
+	(void)port;
+	(void)windowMs;
+	errno = ENOSYS;
+	return (NULL);
+}
+
+void wol_relay_destroy (wol_relay *relay)
+{
+	(void)relay;
+}
+
+int wol_relay_add_target (wol_relay *relay, const char *subnet)
+{
+	(void)relay;
+	(void)subnet;
+	return (-1);
+}
+
+int wol_relay_listen_udp (wol_relay *relay, const char *bindAddr, int port)
+{
+	(void)relay;
+	(void)bindAddr;
+	(void)port;
+	return (-1);
+}
+
+int wol_relay_listen_unix (wol_relay *relay, const char *path)
+{
+	(void)relay;
+	(void)path;
+	return (-1);
+}
+
+int wol_relay_fd (const wol_relay *relay)
+{
+	(void)relay;
+	return (-1);
+}
+
+int wol_relay_request (wol_relay *relay, const char *request, int len)
+{
+	(void)relay;
+	(void)request;
+	(void)len;
+	return (-1);
+}
+
+int wol_relay_flush (wol_relay *relay)
+{
+	(void)relay;
+	return (-1);
+}
+
+int wol_relay_run_once (wol_relay *relay, int timeoutMs)
+{
+	(void)relay;
+	(void)timeoutMs;
+	return (-1);
+}
+
+int wol_relay_run (wol_relay *relay, volatile int *stop)
+{
+	(void)relay;
+	(void)stop;
+	return (-1);
+}
+
+void wol_relay_get_stats (const wol_relay *relay, wol_relay_stats *stats)
+{
+	(void)relay;
+	memset (stats, 0, sizeof (*stats));
+}
+
+#endif /* __linux__ */
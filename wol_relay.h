@@ -0,0 +1,80 @@
+/**
+ * @file wol_relay.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_relay.c
+ * @details Provides the function prototypes of the wake relay engine. The
+ * relay accepts wake requests on UDP and unix domain datagram sockets,
+ * coalesces duplicates within a window, and broadcasts the magic packets on
+ * its local subnets, from a single epoll event loop. It carries wakes across
+ * routers, which do not forward broadcasts. Only available on Linux.
+ *
+ * A request is a datagram of one or more lines, each a MAC address and an
+ * optional target subnet, in CIDR notation, or as any address in it:
+ *
+ *     00:1b:63:aa:bb:cc
+ *     00:1b:63:aa:bb:cd 10.1.2.0/24
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_RELAY_H
+#define WOL_RELAY_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WOL_RELAY_PORT         9009    /**< the default request port */
+#define WOL_RELAY_WINDOW_MS    1000    /**< the default coalescing window */
+#define WOL_RELAY_MAX_TARGETS  64      /**< target subnets, including the default */
+#define WOL_RELAY_MAX_PENDING  65536   /**< requests remembered for coalescing */
+
+/**
+ * The relay's totals.
+ */
+typedef struct wol_relay_stats {
+	uint64_t requests;    /**< wake requests received */
+	uint64_t coalesced;   /**< duplicates dropped within the window */
+	uint64_t rejected;    /**< malformed, or for a subnet not configured */
+	uint64_t sent;        /**< magic packets sent */
+	uint64_t failed;      /**< magic packets the kernel refused */
+} wol_relay_stats;
+
+/** Opaque wake relay. */
+typedef struct wol_relay wol_relay;
+
+wol_relay *wol_relay_create (int port, int windowMs);
+void wol_relay_destroy (wol_relay *relay);
+int wol_relay_add_target (wol_relay *relay, const char *subnet);
+int wol_relay_listen_udp (wol_relay *relay, const char *bindAddr, int port);
+int wol_relay_listen_unix (wol_relay *relay, const char *path);
+int wol_relay_fd (const wol_relay *relay);
+int wol_relay_request (wol_relay *relay, const char *request, int len);
+int wol_relay_flush (wol_relay *relay);
+int wol_relay_run_once (wol_relay *relay, int timeoutMs);
+int wol_relay_run (wol_relay *relay, volatile int *stop);
+void wol_relay_get_stats (const wol_relay *relay, wol_relay_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_RELAY_H */
@@ -0,0 +1,773 @@
+/**
+ * @file wol_sched.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Paced wake scheduler for wake storms.
+ * @details Wakes are added with an optional group, e.g. a rack or PDU, and an
+ * optional delay. Delayed wakes wait in a four level hierarchical timer wheel
+ * of 256 slots per level, at WOL_SCHED_TICK_USEC resolution, so adding and
+ * expiring a wake costs the same for ten wakes or a million. Due wakes wait
+ * in their group's ready queue. The dispatcher serves the ready groups round
+ * robin, taking a token from the global bucket and from the group's bucket
+ * for each wake, and hands up to WOL_SCHED_BATCH packets to the kernel in one
+ * wol_ctx_send_packets() call. Between batches it sleeps to the absolute time
+ * at which the buckets next allow a full batch, so with a burst of B the
+ * packets leave in batches of B at intervals of B / rate.
+ * A scheduler must only be used from one thread.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_sched.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define WHEEL_BITS    8
+#define WHEEL_SLOTS   (1 << WHEEL_BITS)
+#define WHEEL_MASK    (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS  4
+
+/** The longest delay the wheel holds, in ticks. Longer delays are clamped. */
+#define WHEEL_MAX_TICKS  ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define NO_EXPIRY     UINT64_MAX
+
+
+/**
+ * A queued wake. Entries are linked by index, so the pool may grow.
+ */
+struct sched_entry {
+	wol_mac mac;
+	uint64_t due;                      /**< the tick the wake is due */
+	int group;
+	int next;                          /**< wheel slot, ready queue or free list link */
+};
+
+/**
+ * A FIFO list of entries.
+ */
+struct sched_list {
+	int head;
+	int tail;
+};
+
+/**
+ * A token bucket. A rate of 0 is unlimited.
+ */
+struct sched_bucket {
+	double rate;                       /**< tokens per microsecond */
+	double burst;                      /**< the bucket size */
+	double tokens;
+	long long last;                    /**< the time of the last refill, usec */
+};
+
+/**
+ * A group of wakes sharing a bucket, e.g. a rack or PDU.
+ */
+struct sched_group {
+	struct sched_bucket bucket;
+	struct sched_list ready;           /**< due wakes, in the order they came due */
+	int active;                        /**< 1 while in the round robin ring */
+	int nextActive;
+	int prevActive;
+};
+
+
+/**
+ * The paced wake scheduler.
+ */
+struct wol_sched {
+	wol_ctx *ctx;
+
+	struct sched_entry *entries;
+	int capacity;
+	int freeList;
+
+	struct sched_list wheel [WHEEL_LEVELS][WHEEL_SLOTS];
+	int levelCount [WHEEL_LEVELS];     /**< the entries in each wheel level */
+	uint64_t tick;                     /**< the wheel's current tick */
+	long long epoch;                   /**< the monotonic time of tick 0, usec */
+
+	struct sched_bucket global;
+	struct sched_group *groups;
+	int groupCount;
+	int activeHead;                    /**< the round robin ring of groups with ready wakes */
+	int activeCount;
+
+	int depth;
+	int ready;
+	uint64_t queued;
+	uint64_t sent;
+	uint64_t failed;
+	long long firstSend;               /**< the time of the first send, usec */
+	long long lastSend;
+	long long windowStart;             /**< the start of the rate window, usec */
+	uint64_t windowSent;
+	double rate;                       /**< the rate over the last full window */
+
+	unsigned char packets [WOL_SCHED_BATCH][WOL_PACKET_LEN];
+};
+
+
+/**
+ * Function to read the monotonic clock in microseconds.
+ */
+static long long sched_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+}
+
+
+/**
+ * Function to sleep until a monotonic time in microseconds.
+ */
+static void sched_sleep_until (long long usec)
+{
+	struct timespec ts;
+
+#if defined(__linux__)
+	ts.tv_sec = usec / 1000000LL;
+	ts.tv_nsec = (usec % 1000000LL) * 1000;
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+	}
+#else
+	long long now = sched_now ();
+
+	if (usec <= now) {
+		return;
+	}
+	ts.tv_sec = (usec - now) / 1000000LL;
+	ts.tv_nsec = ((usec - now) % 1000000LL) * 1000;
+	nanosleep (&ts, NULL);
+#endif
+}
+
+
+/*
+ * Token buckets.
+ */
+
+static void bucket_init (struct sched_bucket *b, double rate, int burst, long long now)
+{
+	b->rate = (rate > 0) ? rate / 1000000.0 : 0;
+	b->burst = (burst > 0) ? burst : 1;
+	b->tokens = b->burst;
+	b->last = now;
+}
+
+static void bucket_refill (struct sched_bucket *b, long long now)
+{
+	if (b->rate > 0 && now > b->last) {
+		b->tokens += (now - b->last) * b->rate;
+		if (b->tokens > b->burst) {
+			b->tokens = b->burst;
+		}
+	}
+	b->last = now;
+}
+
+static inline int bucket_ok (const struct sched_bucket *b)
+{
+	return (b->rate == 0 || b->tokens >= 1.0);
+}
+
+/**
+ * Function to get the time until a bucket holds the tokens, in usec.
+ */
+static double bucket_wait (const struct sched_bucket *b, double tokens)
+{
+	if (b->rate == 0 || b->tokens >= tokens) {
+		return (0);
+	}
+	return ((tokens - b->tokens) / b->rate);
+}
+
+
+/*
+ * Entry lists.
+ */
+
+static void list_push (wol_sched *sched, struct sched_list *list, int idx)
+{
+	sched->entries [idx].next = -1;
+	if (list->tail >= 0) {
+		sched->entries [list->tail].next = idx;
+	}
+	else {
+		list->head = idx;
+	}
+	list->tail = idx;
+}
+
+static int list_pop (wol_sched *sched, struct sched_list *list)
+{
+	int idx = list->head;
+
+	if (idx >= 0) {
+		list->head = sched->entries [idx].next;
+		if (list->head < 0) {
+			list->tail = -1;
+		}
+	}
+	return (idx);
+}
+
+
+/*
+ * The round robin ring of groups with ready wakes.
+ */
+
+static void group_activate (wol_sched *sched, int g)
+{
+	struct sched_group *grp = &sched->groups [g];
+
+	grp->active = 1;
+	if (sched->activeHead < 0) {
+		grp->nextActive = grp->prevActive = g;
+		sched->activeHead = g;
+	}
+	else {
+		/** Join at the tail of the ring, behind the groups already waiting. */
+		struct sched_group *head = &sched->groups [sched->activeHead];
+
+		grp->nextActive = sched->activeHead;
+		grp->prevActive = head->prevActive;
+		sched->groups [head->prevActive].nextActive = g;
+		head->prevActive = g;
+	}
+	sched->activeCount++;
+}
+
+static void group_deactivate (wol_sched *sched, int g)
+{
+	struct sched_group *grp = &sched->groups [g];
+
+	grp->active = 0;
+	if (--sched->activeCount == 0) {
+		sched->activeHead = -1;
+		return;
+	}
+	sched->groups [grp->prevActive].nextActive = grp->nextActive;
+	sched->groups [grp->nextActive].prevActive = grp->prevActive;
+	if (sched->activeHead == g) {
+		sched->activeHead = grp->nextActive;
+	}
+}
+
+
+/**
+ * Function to move a due entry to its group's ready queue.
+ */
+static void sched_make_ready (wol_sched *sched, int idx)
+{
+	int g = sched->entries [idx].group;
+
+	list_push (sched, &sched->groups [g].ready, idx);
+	if (!sched->groups [g].active) {
+		group_activate (sched, g);
+	}
+	sched->ready++;
+}
+
+
+/*
+ * The hierarchical timer wheel.
+ */
+
+/**
+ * Function to insert an entry into the wheel level and slot its due tick
+ * falls in, or into its ready queue if it is due.
+ */
+static void wheel_insert (wol_sched *sched, int idx)
+{
+	uint64_t due = sched->entries [idx].due;
+	uint64_t delta;
+	int level = 0;
+
+	if (due <= sched->tick) {
+		sched_make_ready (sched, idx);
+		return;
+	}
+	delta = due - sched->tick;
+	while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+		level++;
+	}
+	list_push (sched, &sched->wheel [level][(due >> (WHEEL_BITS * level)) & WHEEL_MASK], idx);
+	sched->levelCount [level]++;
+}
+
+/**
+ * Function to empty a wheel slot, re-inserting its entries a level down.
+ */
+static void wheel_cascade (wol_sched *sched, int level, int slot)
+{
+	struct sched_list list = sched->wheel [level][slot];
+	int idx;
+
+	sched->wheel [level][slot].head = sched->wheel [level][slot].tail = -1;
+	while ((idx = list_pop (sched, &list)) >= 0) {
+		sched->levelCount [level]--;
+		wheel_insert (sched, idx);
+	}
+}
+
+/**
+ * Function to get the lowest wheel level holding entries, or -1.
+ */
+static int wheel_lowest_level (const wol_sched *sched)
+{
+	int level;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		if (sched->levelCount [level] > 0) {
+			return (level);
+		}
+	}
+	return (-1);
+}
+
+/**
+ * Function to advance the wheel to a tick, moving the entries that come due
+ * to their ready queues. Runs of empty slots are skipped a level at a time.
+ */
+static void wheel_advance (wol_sched *sched, uint64_t target)
+{
+	while (sched->tick < target) {
+		int level = wheel_lowest_level (sched);
+
+		if (level < 0) {
+			sched->tick = target;
+			break;
+		}
+		if (level == 0) {
+			sched->tick++;
+		}
+		else {
+			/** Jump to the next boundary at which the lowest occupied level cascades. */
+			uint64_t next = (sched->tick | ((1ULL << (WHEEL_BITS * level)) - 1)) + 1;
+
+			if (next > target) {
+				sched->tick = target;
+				break;
+			}
+			sched->tick = next;
+		}
+
+		/** Cascade the higher levels whose slot boundary this tick is, highest first. */
+		for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+			if ((sched->tick & ((1ULL << (WHEEL_BITS * level)) - 1)) == 0) {
+				wheel_cascade (sched, level, (sched->tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+			}
+		}
+		wheel_cascade (sched, 0, sched->tick & WHEEL_MASK);
+	}
+}
+
+/**
+ * Function to get the next tick at which the wheel has work: an entry
+ * coming due, or a cascade. NO_EXPIRY if the wheel is empty.
+ */
+static uint64_t wheel_next (const wol_sched *sched)
+{
+	uint64_t next = NO_EXPIRY;
+	int level, i;
+
+	if (sched->levelCount [0] > 0) {
+		for (i = 1; i <= WHEEL_SLOTS; i++) {
+			if (sched->wheel [0][(sched->tick + i) & WHEEL_MASK].head >= 0) {
+				next = sched->tick + i;
+				break;
+			}
+		}
+	}
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		if (sched->levelCount [level] > 0) {
+			uint64_t boundary = (sched->tick | ((1ULL << (WHEEL_BITS * level)) - 1)) + 1;
+
+			return (boundary < next ? boundary : next);
+		}
+	}
+	return (next);
+}
+
+
+/**
+ * Function to create a paced wake scheduler.
+ *
+ * @param ctx - the wake context the packets are sent through; not owned
+ * @param groups - the number of groups, numbered from 0; at least 1
+ * @param rate - the global rate limit in wakes per second, or 0 for unlimited
+ * @param burst - the global bucket size, and so the largest batch
+ *
+ * @return the new scheduler, or NULL on failure
+ */
+wol_sched *wol_sched_create (wol_ctx *ctx, int groups, double rate, int burst)
+{
+	wol_sched *sched;
+	long long now = sched_now ();
+	int level, slot, g;
+
+	if (ctx == NULL) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if (groups < 1) {
+		groups = 1;
+	}
+	if ((sched = calloc (1, sizeof (wol_sched))) == NULL) {
+		return (NULL);
+	}
+	if ((sched->groups = calloc (groups, sizeof (struct sched_group))) == NULL) {
+		free (sched);
+		return (NULL);
+	}
+	sched->ctx = ctx;
+	sched->groupCount = groups;
+	sched->freeList = -1;
+	sched->activeHead = -1;
+	sched->epoch = now;
+	sched->windowStart = now;
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < WHEEL_SLOTS; slot++) {
+			sched->wheel [level][slot].head = sched->wheel [level][slot].tail = -1;
+		}
+	}
+	bucket_init (&sched->global, rate, burst, now);
+	for (g = 0; g < groups; g++) {
+		bucket_init (&sched->groups [g].bucket, 0, 1, now);
+		sched->groups [g].ready.head = sched->groups [g].ready.tail = -1;
+	}
+
+	return (sched);
+}
+
+
+/**
+ * Function to release a scheduler. Wakes not yet sent are dropped.
+ *
+ * @param sched - the scheduler to release, may be NULL
+ */
+void wol_sched_destroy (wol_sched *sched)
+{
+	if (sched == NULL) {
+		return;
+	}
+	free (sched->entries);
+	free (sched->groups);
+	free (sched);
+}
+
+
+/**
+ * Function to set a group's rate limit. Groups are unlimited until set.
+ *
+ * @param sched - the scheduler
+ * @param group - the group number
+ * @param rate - the group rate limit in wakes per second, or 0 for unlimited
+ * @param burst - the group bucket size
+ *
+ * @return 0 on success, -1 if the group is out of range
+ */
+int wol_sched_set_group (wol_sched *sched, int group, double rate, int burst)
+{
+	if (group < 0 || group >= sched->groupCount) {
+		errno = EINVAL;
+		return (-1);
+	}
+	bucket_init (&sched->groups [group].bucket, rate, burst, sched_now ());
+
+	return (0);
+}
+
+
+/**
+ * Function to add a wake to the plan.
+ *
+ * @param sched - the scheduler
+ * @param mac - the packed MAC address to wake
+ * @param group - the group number, 0 if not grouped
+ * @param delayUsec - the time from now before the wake is due, 0 for now
+ *
+ * @return 0 on success, -1 if the group is out of range or on failure to allocate
+ */
+int wol_sched_add (wol_sched *sched, wol_mac mac, int group, long delayUsec)
+{
+	long long now = sched_now ();
+	int idx;
+
+	if (group < 0 || group >= sched->groupCount) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (sched->freeList < 0) {
+		int capacity = sched->capacity ? sched->capacity * 2 : 1024;
+		struct sched_entry *grown = realloc (sched->entries, capacity * sizeof (struct sched_entry));
+		int i;
+
+		if (grown == NULL) {
+			return (-1);
+		}
+		for (i = capacity - 1; i >= sched->capacity; i--) {
+			grown [i].next = sched->freeList;
+			sched->freeList = i;
+		}
+		sched->entries = grown;
+		sched->capacity = capacity;
+	}
+	idx = sched->freeList;
+	sched->freeList = sched->entries [idx].next;
+
+	sched->entries [idx].mac = mac;
+	sched->entries [idx].group = group;
+	sched->depth++;
+	sched->queued++;
+
+	wheel_advance (sched, (uint64_t)(now - sched->epoch) / WOL_SCHED_TICK_USEC);
+	if (delayUsec <= 0) {
+		sched->entries [idx].due = sched->tick;
+		sched_make_ready (sched, idx);
+	}
+	else {
+		sched->entries [idx].due = (uint64_t)(now - sched->epoch + delayUsec + WOL_SCHED_TICK_USEC - 1) / WOL_SCHED_TICK_USEC;
+		if (sched->entries [idx].due - sched->tick > WHEEL_MAX_TICKS) {
+			sched->entries [idx].due = sched->tick + WHEEL_MAX_TICKS;
+		}
+		wheel_insert (sched, idx);
+	}
+
+	return (0);
+}
+
+
+/**
+ * Function to compute the time until the scheduler next has work.
+ */
+static long sched_next_usec (wol_sched *sched, long long now)
+{
+	double wait = -1;
+	uint64_t next;
+
+	if (sched->activeCount > 0) {
+		double need = sched->ready, groupWait = -1;
+		int g = sched->activeHead, i;
+
+		/**
+		 * Wait for the global bucket to allow a full batch, and for at
+		 * least one ready group to hold a token.
+		 */
+		if (need > sched->global.burst) {
+			need = sched->global.burst;
+		}
+		if (need > WOL_SCHED_BATCH) {
+			need = WOL_SCHED_BATCH;
+		}
+		for (i = 0; i < sched->activeCount; i++) {
+			struct sched_bucket *b = &sched->groups [g].bucket;
+			double w;
+
+			bucket_refill (b, now);
+			w = bucket_wait (b, 1.0);
+			if (groupWait < 0 || w < groupWait) {
+				groupWait = w;
+			}
+			g = sched->groups [g].nextActive;
+		}
+		wait = bucket_wait (&sched->global, need);
+		if (groupWait > wait) {
+			wait = groupWait;
+		}
+	}
+	if ((next = wheel_next (sched)) != NO_EXPIRY) {
+		double w = (double)(next * WOL_SCHED_TICK_USEC) - (double)(now - sched->epoch);
+
+		if (w < 0) {
+			w = 0;
+		}
+		if (wait < 0 || w < wait) {
+			wait = w;
+		}
+	}
+	return ((wait < 0) ? -1 : (long)(wait + 0.999));
+}
+
+
+/**
+ * Function to send the wakes the buckets allow now, in one batch, without
+ * waiting. For callers driving the scheduler from their own event loop.
+ *
+ * @param sched - the scheduler
+ * @param nextUsec - populated with the time until the scheduler next has
+ * work, 0 if now, or -1 if the plan is complete; may be NULL
+ *
+ * @return the number of wakes sent
+ */
+int wol_sched_step (wol_sched *sched, long *nextUsec)
+{
+	const unsigned char *packets [WOL_SCHED_BATCH];
+	int status [WOL_SCHED_BATCH];
+	int batch [WOL_SCHED_BATCH];
+	long long now = sched_now ();
+	int n = 0, blocked = 0, sent = 0, i;
+
+	wheel_advance (sched, (uint64_t)(now - sched->epoch) / WOL_SCHED_TICK_USEC);
+	bucket_refill (&sched->global, now);
+
+	/**
+     * Serve the ready groups round robin, one wake per group per turn, until
+     * the batch is full, the global bucket is empty, or every ready group's
+     * bucket is empty.
+     */
+	while (n < WOL_SCHED_BATCH && sched->activeCount > 0 && blocked < sched->activeCount &&
+		   bucket_ok (&sched->global)) {
+		int g = sched->activeHead;
+		struct sched_group *grp = &sched->groups [g];
+
+		bucket_refill (&grp->bucket, now);
+		if (!bucket_ok (&grp->bucket)) {
+			blocked++;
+			sched->activeHead = grp->nextActive;
+			continue;
+		}
+		blocked = 0;
+		if (grp->bucket.rate > 0) {
+			grp->bucket.tokens -= 1.0;
+		}
+		if (sched->global.rate > 0) {
+			sched->global.tokens -= 1.0;
+		}
+		batch [n] = list_pop (sched, &grp->ready);
+		sched->ready--;
+		wol_build_magic (sched->entries [batch [n]].mac, sched->packets [n]);
+		packets [n] = sched->packets [n];
+		n++;
+
+		if (grp->ready.head < 0) {
+			group_deactivate (sched, g);
+		}
+		else {
+			sched->activeHead = grp->nextActive;
+		}
+	}
+
+	if (n > 0) {
+		sent = wol_ctx_send_packets (sched->ctx, packets, n, status);
+		for (i = 0; i < n; i++) {
+			sched->entries [batch [i]].next = sched->freeList;
+			sched->freeList = batch [i];
+		}
+		sched->depth -= n;
+		sched->sent += sent;
+		sched->failed += n - sent;
+
+		if (sched->firstSend == 0) {
+			sched->firstSend = now;
+			sched->windowStart = now;
+		}
+		sched->lastSend = now;
+		sched->windowSent += sent;
+		if (now - sched->windowStart >= 1000000) {
+			sched->rate = sched->windowSent * 1000000.0 / (now - sched->windowStart);
+			sched->windowStart = now;
+			sched->windowSent = 0;
+		}
+	}
+
+	if (nextUsec != NULL) {
+		*nextUsec = (n == WOL_SCHED_BATCH && sched->ready > 0) ? 0 : sched_next_usec (sched, now);
+	}
+	return (sent);
+}
+
+
+/**
+ * Function to run the plan, sleeping between batches, until every wake is
+ * sent or the timeout passes. Wakes added while running, e.g. by another
+ * plan source between calls, are sent by the next call.
+ *
+ * @param sched - the scheduler
+ * @param timeoutMs - the longest time to run, or -1 to run until the plan is complete
+ *
+ * @return the number of wakes sent
+ */
+int wol_sched_run (wol_sched *sched, int timeoutMs)
+{
+	long long start = sched_now ();
+	long long end = start + (long long)timeoutMs * 1000;
+	int total = 0;
+
+	for (;;) {
+		long next;
+		long long now;
+
+		total += wol_sched_step (sched, &next);
+		if (next < 0) {
+			break;
+		}
+		now = sched_now ();
+		if (timeoutMs >= 0) {
+			if (now >= end) {
+				break;
+			}
+			if (now + next > end) {
+				next = (long)(end - now);
+			}
+		}
+		if (next > 0) {
+			sched_sleep_until (now + next);
+		}
+	}
+	return (total);
+}
+
+
+/**
+ * Function to get the scheduler statistics.
+ *
+ * @param sched - the scheduler
+ * @param stats - populated with the statistics
+ */
+void wol_sched_get_stats (const wol_sched *sched, wol_sched_stats *stats)
+{
+	long long now = sched_now ();
+
+	stats->queued = sched->queued;
+	stats->sent = sched->sent;
+	stats->failed = sched->failed;
+	stats->depth = sched->depth;
+	stats->ready = sched->ready;
+
+	/** A window older than a second is complete; report it rather than the last full one. */
+	if (sched->firstSend != 0 && now - sched->windowStart >= 1000000) {
+		stats->rate = sched->windowSent * 1000000.0 / (now - sched->windowStart);
+	}
+	else {
+		stats->rate = sched->rate;
+	}
+	if (sched->firstSend != 0 && sched->lastSend > sched->firstSend) {
+		stats->avgRate = sched->sent * 1000000.0 / (sched->lastSend - sched->firstSend);
+	}
+	else {
+		stats->avgRate = 0;
+	}
+}
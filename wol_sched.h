@@ -0,0 +1,71 @@
+/**
+ * @file wol_sched.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_sched.c
+ * @details Provides the types and function prototypes of the paced wake
+ * scheduler. A wake plan is paced by a global token bucket and optional
+ * per-group token buckets, e.g. one per rack or PDU, and sent in batches
+ * through a wake context.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_SCHED_H
+#define WOL_SCHED_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The timer wheel resolution for delayed wakes, in microseconds. */
+#define WOL_SCHED_TICK_USEC  100
+
+/** The most packets handed to the kernel in one send. */
+#define WOL_SCHED_BATCH      64
+
+/**
+ * Scheduler statistics.
+ */
+typedef struct wol_sched_stats {
+	uint64_t queued;                   /**< wakes added */
+	uint64_t sent;                     /**< wakes sent */
+	uint64_t failed;                   /**< wakes that failed to send */
+	int depth;                         /**< wakes not yet sent, delayed or ready */
+	int ready;                         /**< wakes due, waiting for tokens */
+	double rate;                       /**< the achieved rate over the last second, wakes per second */
+	double avgRate;                    /**< the achieved rate since the first send */
+} wol_sched_stats;
+
+/** Opaque paced wake scheduler. */
+typedef struct wol_sched wol_sched;
+
+wol_sched *wol_sched_create (wol_ctx *ctx, int groups, double rate, int burst);
+void wol_sched_destroy (wol_sched *sched);
+int wol_sched_set_group (wol_sched *sched, int group, double rate, int burst);
+int wol_sched_add (wol_sched *sched, wol_mac mac, int group, long delayUsec);
+int wol_sched_step (wol_sched *sched, long *nextUsec);
+int wol_sched_run (wol_sched *sched, int timeoutMs);
+void wol_sched_get_stats (const wol_sched *sched, wol_sched_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_SCHED_H */
@@ -0,0 +1,456 @@
+/**
+ * @file wol_stats.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Per-thread counters and latency histograms, with snapshots.
+ * @details Each thread records into its own statistics block, allocated on
+ * its first record, so recording takes no lock and shares no cache line
+ * with other threads. Each value has one writer, so it is updated with a
+ * relaxed load and store rather than an atomic read-modify-write, which
+ * keeps a record to a few instructions.
+ * wol_stats_snapshot_take() merges the blocks of all live threads, and the
+ * totals of exited threads, which are folded in when a thread exits.
+ * The histograms are log-linear, in the manner of HDR histograms: exact below
+ * 16 ns, then 16 sub-buckets per power of two, so any recorded latency is
+ * within 6.25% of its bucket, in a fixed 608 buckets.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
+
+/** Add to a value only this thread writes, readable by a snapshot at any time. */
+#define STATS_ADD(ptr, n) \
+	__atomic_store_n ((ptr), __atomic_load_n ((ptr), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#define STATS_LOAD(ptr)   __atomic_load_n ((ptr), __ATOMIC_RELAXED)
+
+
+/**
+ * A thread's statistics block.
+ */
+struct stats_thread {
+	wol_stats_snapshot stats;
+	struct stats_thread *next;
+	struct stats_thread *prev;
+};
+
+int wol_stats_enabled = 1;
+
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t statsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t statsKey;
+static struct stats_thread *statsThreads = NULL;   /**< the live threads' blocks */
+static wol_stats_snapshot statsRetired;             /**< the totals of exited threads */
+static __thread struct stats_thread *statsSelf = NULL;
+
+static const char *counterNames [WOL_CTR_COUNT] = {
+	"wol_packets_sent_total", "wol_packets_failed_total", "wol_probes_sent_total",
+	"wol_probes_answered_total", "wol_probes_timeout_total", "wol_arp_lookups_total",
+	"wol_arp_misses_total", "wol_mdns_queries_total", "wol_mdns_answers_total"
+};
+static const char *stageNames [WOL_STAGE_COUNT] = {
+	"parse", "socket", "setsockopt", "send", "arp", "ping", "mdns"
+};
+static const char *histNames [WOL_HIST_COUNT] = {
+	"send", "arp", "ping", "mdns"
+};
+
+/** The Prometheus histogram bucket bounds, in seconds. */
+static const double promBounds [] = {
+	1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3,
+	0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+
+/**
+ * Function to add one statistics block to another.
+ */
+static void stats_merge (wol_stats_snapshot *dst, wol_stats_snapshot *src)
+{
+	int i, j;
+
+	for (i = 0; i < WOL_CTR_COUNT; i++) {
+		dst->counters [i] += STATS_LOAD (&src->counters [i]);
+	}
+	for (i = 0; i < WOL_STAGE_COUNT; i++) {
+		dst->stageErrors [i] += STATS_LOAD (&src->stageErrors [i]);
+	}
+	for (i = 0; i < WOL_STATS_ERRNOS; i++) {
+		dst->errnoErrors [i] += STATS_LOAD (&src->errnoErrors [i]);
+	}
+	for (i = 0; i < WOL_HIST_COUNT; i++) {
+		wol_stats_hist *d = &dst->hists [i], *s = &src->hists [i];
+		uint64_t max = STATS_LOAD (&s->max);
+
+		d->count += STATS_LOAD (&s->count);
+		d->sum += STATS_LOAD (&s->sum);
+		if (max > d->max) {
+			d->max = max;
+		}
+		for (j = 0; j < WOL_HIST_BUCKETS; j++) {
+			d->buckets [j] += STATS_LOAD (&s->buckets [j]);
+		}
+	}
+}
+
+
+/**
+ * Thread exit destructor: fold the thread's block into the exited totals.
+ */
+static void stats_thread_exit (void *arg)
+{
+	struct stats_thread *self = arg;
+
+	pthread_mutex_lock (&statsLock);
+	stats_merge (&statsRetired, &self->stats);
+	if (self->prev != NULL) {
+		self->prev->next = self->next;
+	}
+	else {
+		statsThreads = self->next;
+	}
+	if (self->next != NULL) {
+		self->next->prev = self->prev;
+	}
+	pthread_mutex_unlock (&statsLock);
+	free (self);
+}
+
+static void stats_init_key (void)
+{
+	pthread_key_create (&statsKey, stats_thread_exit);
+}
+
+
+/**
+ * Function to get the calling thread's block, allocating it on first use.
+ */
+static wol_stats_snapshot *stats_self (void)
+{
+	struct stats_thread *self = statsSelf;
+
+	if (self != NULL) {
+		return (&self->stats);
+	}
+	pthread_once (&statsOnce, stats_init_key);
+	if ((self = calloc (1, sizeof (struct stats_thread))) == NULL) {
+		return (NULL);
+	}
+	pthread_mutex_lock (&statsLock);
+	self->next = statsThreads;
+	if (statsThreads != NULL) {
+		statsThreads->prev = self;
+	}
+	statsThreads = self;
+	pthread_mutex_unlock (&statsLock);
+	pthread_setspecific (statsKey, self);
+	statsSelf = self;
+
+	return (&self->stats);
+}
+
+
+/**
+ * Function to switch recording on or off for all threads. On by default.
+ *
+ * @param enabled - 1 to record, 0 to not
+ */
+void wol_stats_enable (int enabled)
+{
+	wol_stats_enabled = enabled;
+}
+
+
+/**
+ * Function to add to a counter.
+ *
+ * @param counter - the counter, WOL_CTR_*
+ * @param n - the amount to add
+ */
+void wol_stats_count (int counter, uint64_t n)
+{
+	wol_stats_snapshot *s = stats_self ();
+
+	if (s != NULL && counter >= 0 && counter < WOL_CTR_COUNT) {
+		STATS_ADD (&s->counters [counter], n);
+	}
+}
+
+
+/**
+ * Function to count an error, by stage and by errno.
+ *
+ * @param stage - the stage that failed, WOL_STAGE_*
+ * @param err - the errno value
+ */
+void wol_stats_error (int stage, int err)
+{
+	wol_stats_snapshot *s = stats_self ();
+
+	if (s == NULL || stage < 0 || stage >= WOL_STAGE_COUNT) {
+		return;
+	}
+	if (err < 0 || err >= WOL_STATS_ERRNOS) {
+		err = WOL_STATS_ERRNOS - 1;
+	}
+	STATS_ADD (&s->stageErrors [stage], 1);
+	STATS_ADD (&s->errnoErrors [err], 1);
+}
+
+
+/**
+ * Function to get the histogram bucket of a value.
+ */
+static inline int stats_bucket (uint64_t v)
+{
+	int msb, shift, idx;
+
+	if (v < WOL_HIST_SUB) {
+		return ((int)v);
+	}
+	msb = 63 - __builtin_clzll (v);
+	shift = msb - WOL_HIST_SUB_BITS;
+	idx = (shift + 1) * WOL_HIST_SUB + (int)((v >> shift) & (WOL_HIST_SUB - 1));
+
+	return (idx < WOL_HIST_BUCKETS ? idx : WOL_HIST_BUCKETS - 1);
+}
+
+
+/**
+ * Function to get the lowest and highest value of a histogram bucket.
+ */
+static void stats_bucket_range (int idx, uint64_t *low, uint64_t *high)
+{
+	int shift;
+
+	if (idx < WOL_HIST_SUB) {
+		*low = *high = (uint64_t)idx;
+		return;
+	}
+	shift = idx / WOL_HIST_SUB - 1;
+	*low = (uint64_t)(WOL_HIST_SUB + idx % WOL_HIST_SUB) << shift;
+	*high = *low + ((uint64_t)1 << shift) - 1;
+}
+
+
+/**
+ * Function to record a latency.
+ *
+ * @param hist - the histogram, WOL_HIST_*
+ * @param ns - the latency in nanoseconds
+ */
+void wol_stats_latency (int hist, uint64_t ns)
+{
+	wol_stats_snapshot *s = stats_self ();
+	wol_stats_hist *h;
+
+	if (s == NULL || hist < 0 || hist >= WOL_HIST_COUNT) {
+		return;
+	}
+	h = &s->hists [hist];
+	STATS_ADD (&h->count, 1);
+	STATS_ADD (&h->sum, ns);
+	STATS_ADD (&h->buckets [stats_bucket (ns)], 1);
+	if (ns > STATS_LOAD (&h->max)) {
+		__atomic_store_n (&h->max, ns, __ATOMIC_RELAXED);
+	}
+}
+
+
+/**
+ * Function to read the monotonic clock, for latencies.
+ *
+ * @return the time in nanoseconds
+ */
+uint64_t wol_stats_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+
+/**
+ * Function to merge the statistics of all threads into a snapshot.
+ *
+ * @param snap - populated with the snapshot
+ */
+void wol_stats_snapshot_take (wol_stats_snapshot *snap)
+{
+	struct stats_thread *t;
+
+	pthread_mutex_lock (&statsLock);
+	memcpy (snap, &statsRetired, sizeof (*snap));
+	for (t = statsThreads; t != NULL; t = t->next) {
+		stats_merge (snap, &t->stats);
+	}
+	pthread_mutex_unlock (&statsLock);
+}
+
+
+/**
+ * Function to zero the statistics of all threads. Records made while the
+ * reset runs may survive it.
+ */
+void wol_stats_reset (void)
+{
+	struct stats_thread *t;
+	size_t i;
+
+	pthread_mutex_lock (&statsLock);
+	memset (&statsRetired, 0, sizeof (statsRetired));
+	for (t = statsThreads; t != NULL; t = t->next) {
+		uint64_t *v = (uint64_t *)&t->stats;
+
+		for (i = 0; i < sizeof (t->stats) / sizeof (uint64_t); i++) {
+			__atomic_store_n (&v [i], 0, __ATOMIC_RELAXED);
+		}
+	}
+	pthread_mutex_unlock (&statsLock);
+}
+
+
+/**
+ * Function to estimate a percentile of a histogram.
+ *
+ * @param hist - the histogram, e.g. of a snapshot
+ * @param percentile - the percentile, from 0 to 100
+ *
+ * @return the upper bound of the bucket holding the percentile, in
+ * nanoseconds, or 0 if the histogram is empty
+ */
+uint64_t wol_stats_percentile (const wol_stats_hist *hist, double percentile)
+{
+	uint64_t rank, seen = 0, low, high;
+	int i;
+
+	if (hist->count == 0) {
+		return (0);
+	}
+	rank = (uint64_t)(percentile / 100.0 * hist->count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+	for (i = 0; i < WOL_HIST_BUCKETS; i++) {
+		seen += hist->buckets [i];
+		if (seen >= rank) {
+			stats_bucket_range (i, &low, &high);
+			return (high < hist->max ? high : hist->max);
+		}
+	}
+	return (hist->max);
+}
+
+
+/**
+ * Output buffer for the Prometheus dump. Counts the full length even once
+ * the buffer is full, as snprintf() does.
+ */
+struct prom_out {
+	char *buf;
+	size_t len;
+	size_t used;
+};
+
+static void prom_printf (struct prom_out *out, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start (ap, fmt);
+	n = vsnprintf (out->used < out->len ? out->buf + out->used : NULL,
+				   out->used < out->len ? out->len - out->used : 0, fmt, ap);
+	va_end (ap);
+	if (n > 0) {
+		out->used += n;
+	}
+}
+
+
+/**
+ * Function to render a snapshot in the Prometheus text exposition format.
+ *
+ * @param snap - the snapshot
+ * @param buf - the output buffer
+ * @param len - the size of the output buffer
+ *
+ * @return the length of the full output, excluding the terminator. If it is
+ * len or more, the output was truncated, as for snprintf().
+ */
+int wol_stats_prometheus (const wol_stats_snapshot *snap, char *buf, size_t len)
+{
+	struct prom_out out = { buf, len, 0 };
+	int i, j, b;
+
+	if (len > 0) {
+		buf [0] = '\0';
+	}
+	for (i = 0; i < WOL_CTR_COUNT; i++) {
+		prom_printf (&out, "# TYPE %s counter\n%s %llu\n", counterNames [i], counterNames [i],
+					 (unsigned long long)snap->counters [i]);
+	}
+
+	prom_printf (&out, "# TYPE wol_errors_total counter\n");
+	for (i = 0; i < WOL_STAGE_COUNT; i++) {
+		prom_printf (&out, "wol_errors_total{stage=\"%s\"} %llu\n", stageNames [i],
+					 (unsigned long long)snap->stageErrors [i]);
+	}
+	prom_printf (&out, "# TYPE wol_errno_total counter\n");
+	for (i = 0; i < WOL_STATS_ERRNOS; i++) {
+		if (snap->errnoErrors [i] != 0) {
+			prom_printf (&out, "wol_errno_total{errno=\"%d\"} %llu\n", i,
+						 (unsigned long long)snap->errnoErrors [i]);
+		}
+	}
+
+	prom_printf (&out, "# TYPE wol_latency_seconds histogram\n");
+	for (i = 0; i < WOL_HIST_COUNT; i++) {
+		const wol_stats_hist *h = &snap->hists [i];
+		uint64_t cumulative = 0;
+
+		/** Each fine bucket falls in the first Prometheus bucket its lowest value fits. */
+		for (j = 0, b = 0; b < (int)(sizeof (promBounds) / sizeof (promBounds [0])); b++) {
+			for (; j < WOL_HIST_BUCKETS; j++) {
+				uint64_t low, high;
+
+				stats_bucket_range (j, &low, &high);
+				if (low > promBounds [b] * 1e9) {
+					break;
+				}
+				cumulative += h->buckets [j];
+			}
+			prom_printf (&out, "wol_latency_seconds_bucket{op=\"%s\",le=\"%g\"} %llu\n",
+						 histNames [i], promBounds [b], (unsigned long long)cumulative);
+		}
+		prom_printf (&out, "wol_latency_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n",
+					 histNames [i], (unsigned long long)h->count);
+		prom_printf (&out, "wol_latency_seconds_sum{op=\"%s\"} %.9f\n", histNames [i], h->sum / 1e9);
+		prom_printf (&out, "wol_latency_seconds_count{op=\"%s\"} %llu\n", histNames [i],
+					 (unsigned long long)h->count);
+	}
+
+	return ((int)out.used);
+}
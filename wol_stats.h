@@ -0,0 +1,138 @@
+/**
+ * @file wol_stats.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_stats.c
+ * @details Provides the instrumentation surface: per-thread counters, errors
+ * by stage and by errno, and latency histograms, merged on demand into a
+ * snapshot and rendered in the Prometheus text format. The library's send,
+ * ARP, ping and mDNS paths record into it through the WOL_STATS_* macros,
+ * which compile to nothing when WOL_NO_STATS is defined.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_STATS_H
+#define WOL_STATS_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Counters. */
+#define WOL_CTR_PACKETS_SENT     0   /**< magic packets handed to the kernel */
+#define WOL_CTR_PACKETS_FAILED   1   /**< magic packets the kernel refused */
+#define WOL_CTR_PROBES_SENT      2   /**< echo requests sent */
+#define WOL_CTR_PROBES_ANSWERED  3   /**< echo requests answered */
+#define WOL_CTR_PROBES_TIMEOUT   4   /**< echo requests unanswered */
+#define WOL_CTR_ARP_LOOKUPS      5   /**< neighbor table lookups */
+#define WOL_CTR_ARP_MISSES       6   /**< lookups finding no MAC address */
+#define WOL_CTR_MDNS_QUERIES     7   /**< hosts queried for device info */
+#define WOL_CTR_MDNS_ANSWERS     8   /**< hosts answering */
+#define WOL_CTR_COUNT            9
+
+/** The stages errors are recorded against. */
+#define WOL_STAGE_PARSE          0   /**< MAC or IP address parsing */
+#define WOL_STAGE_SOCKET         1   /**< socket() */
+#define WOL_STAGE_SETSOCKOPT     2   /**< setsockopt() */
+#define WOL_STAGE_SEND           3   /**< sendto(), sendmmsg() */
+#define WOL_STAGE_ARP            4   /**< reading the neighbor table */
+#define WOL_STAGE_PING           5   /**< sending or receiving ICMP */
+#define WOL_STAGE_MDNS           6   /**< sending or receiving mDNS */
+#define WOL_STAGE_COUNT          7
+
+/** Latency histograms. */
+#define WOL_HIST_SEND            0   /**< one send call */
+#define WOL_HIST_ARP             1   /**< one MAC address lookup */
+#define WOL_HIST_PING            2   /**< echo round trip */
+#define WOL_HIST_MDNS            3   /**< query to answer, per host */
+#define WOL_HIST_COUNT           4
+
+/** Errno values counted individually; larger ones are counted in the last. */
+#define WOL_STATS_ERRNOS         160
+
+/**
+ * Histogram buckets: values below 16 exactly, then 16 linear sub-buckets
+ * per power of two, to 2^40 ns, for a relative error under 6.25%.
+ */
+#define WOL_HIST_SUB_BITS        4
+#define WOL_HIST_SUB             (1 << WOL_HIST_SUB_BITS)
+#define WOL_HIST_BUCKETS         ((40 - WOL_HIST_SUB_BITS + 1) * WOL_HIST_SUB + WOL_HIST_SUB)
+
+/**
+ * A latency histogram, in nanoseconds.
+ */
+typedef struct wol_stats_hist {
+	uint64_t count;
+	uint64_t sum;                      /**< the sum of the values, ns */
+	uint64_t max;
+	uint64_t buckets [WOL_HIST_BUCKETS];
+} wol_stats_hist;
+
+/**
+ * A snapshot of the statistics of all threads, live and exited.
+ */
+typedef struct wol_stats_snapshot {
+	uint64_t counters [WOL_CTR_COUNT];
+	uint64_t stageErrors [WOL_STAGE_COUNT];
+	uint64_t errnoErrors [WOL_STATS_ERRNOS];
+	wol_stats_hist hists [WOL_HIST_COUNT];
+} wol_stats_snapshot;
+
+void wol_stats_enable (int enabled);
+void wol_stats_count (int counter, uint64_t n);
+void wol_stats_error (int stage, int err);
+void wol_stats_latency (int hist, uint64_t ns);
+uint64_t wol_stats_now (void);
+void wol_stats_snapshot_take (wol_stats_snapshot *snap);
+void wol_stats_reset (void);
+uint64_t wol_stats_percentile (const wol_stats_hist *hist, double percentile);
+int wol_stats_prometheus (const wol_stats_snapshot *snap, char *buf, size_t len);
+
+/** Whether recording is on, see wol_stats_enable(). */
+extern int wol_stats_enabled;
+
+/**
+ * Instrumentation macros for the library. WOL_STATS_START() declares a
+ * start time, WOL_STATS_LATENCY() records the time since it.
+ */
+#if defined(WOL_NO_STATS)
+#define WOL_STATS_COUNT(counter, n)
+#define WOL_STATS_ERROR(stage, err)
+#define WOL_STATS_START(var)
+#define WOL_STATS_LATENCY(hist, var)
+#define WOL_STATS_LATENCY_NS(hist, ns)
+#else
+#define WOL_STATS_COUNT(counter, n) \
+	do { if (wol_stats_enabled) wol_stats_count ((counter), (n)); } while (0)
+#define WOL_STATS_ERROR(stage, err) \
+	do { if (wol_stats_enabled) wol_stats_error ((stage), (err)); } while (0)
+#define WOL_STATS_START(var) \
+	uint64_t var = wol_stats_enabled ? wol_stats_now () : 0
+#define WOL_STATS_LATENCY(hist, var) \
+	do { if (wol_stats_enabled && (var) != 0) wol_stats_latency ((hist), wol_stats_now () - (var)); } while (0)
+#define WOL_STATS_LATENCY_NS(hist, ns) \
+	do { if (wol_stats_enabled) wol_stats_latency ((hist), (ns)); } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_STATS_H */
@@ -0,0 +1,523 @@
+/**
+ * @file wol_verify.c
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Wake-and-verify engine for confirming many hosts concurrently.
+ * @details Each host moves through the states sent, waiting, probing, and
+ * then up, or failed once its last magic packet goes unanswered. The wakes
+ * and probes are operations of one asynchronous engine, see wol_async.c, so
+ * all hosts are probed from one ICMP socket and replies are matched by echo
+ * sequence number, with no thread or blocking call per host.
+ * Magic packets are re-sent while a host does not answer, at intervals that
+ * grow by the backoff factor. The time to alive of each host runs from its
+ * first magic packet to its first echo reply.
+ * An engine must only be used from one thread.
+ *
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include "wol_verify.h"
+#include "wol_async.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#define VERIFY_RETRY_USEC   10000      /**< to retry a submission the engine had no room for */
+#define VERIFY_STATES       6
+
+
+/**
+ * One host being verified.
+ */
+struct verify_host {
+	wol_verify *ver;
+	int state;                         /**< WOL_VERIFY_*, or 0 if the slot is free */
+	int heapIdx;                       /**< position in the timer heap, or -1 */
+	int next;                          /**< free list link */
+	long long timer;                   /**< the time of the next action, usec */
+	wol_mac mac;
+	char ipAddr [16];
+	int wakes;
+	int probes;
+	long long firstWake;               /**< the time of the first magic packet, usec */
+	long long lastProbe;               /**< the time of the last echo request, usec */
+	long long resendAt;                /**< the time of the next re-send, usec */
+	long long resendUsec;              /**< the current re-send interval */
+	wol_verify_cb cb;
+	void *arg;
+};
+
+
+/**
+ * The wake-and-verify engine.
+ */
+struct wol_verify {
+	wol_async *async;
+	wol_verify_params params;
+	struct verify_host *hosts;
+	int maxHosts;
+	int freeList;
+	int *heap;                         /**< timer min-heap of host slots */
+	int heapLen;
+	int pending;                       /**< hosts not yet up or failed */
+	int finished;                      /**< hosts finished by the current poll */
+	int counts [VERIFY_STATES];        /**< hosts in each state */
+};
+
+
+/**
+ * Function to read the monotonic clock in microseconds.
+ */
+static long long verify_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+}
+
+
+/*
+ * The timer heap, ordered by the time of each host's next action.
+ */
+
+static void heap_swap (wol_verify *ver, int a, int b)
+{
+	int t = ver->heap [a];
+
+	ver->heap [a] = ver->heap [b];
+	ver->heap [b] = t;
+	ver->hosts [ver->heap [a]].heapIdx = a;
+	ver->hosts [ver->heap [b]].heapIdx = b;
+}
+
+static void heap_up (wol_verify *ver, int i)
+{
+	while (i > 0 && ver->hosts [ver->heap [(i - 1) / 2]].timer > ver->hosts [ver->heap [i]].timer) {
+		heap_swap (ver, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void heap_down (wol_verify *ver, int i)
+{
+	for (;;) {
+		int l = i * 2 + 1, r = l + 1, min = i;
+
+		if (l < ver->heapLen && ver->hosts [ver->heap [l]].timer < ver->hosts [ver->heap [min]].timer) {
+			min = l;
+		}
+		if (r < ver->heapLen && ver->hosts [ver->heap [r]].timer < ver->hosts [ver->heap [min]].timer) {
+			min = r;
+		}
+		if (min == i) {
+			break;
+		}
+		heap_swap (ver, i, min);
+		i = min;
+	}
+}
+
+static void heap_remove (wol_verify *ver, int slot)
+{
+	int i = ver->hosts [slot].heapIdx;
+
+	if (i < 0) {
+		return;
+	}
+	ver->hosts [slot].heapIdx = -1;
+	if (--ver->heapLen == i) {
+		return;
+	}
+	ver->heap [i] = ver->heap [ver->heapLen];
+	ver->hosts [ver->heap [i]].heapIdx = i;
+	heap_down (ver, i);
+	heap_up (ver, i);
+}
+
+/**
+ * Function to set the time of a host's next action.
+ */
+static void verify_set_timer (wol_verify *ver, struct verify_host *host, long long when)
+{
+	int slot = (int)(host - ver->hosts);
+
+	heap_remove (ver, slot);
+	host->timer = when;
+	ver->heap [ver->heapLen] = slot;
+	host->heapIdx = ver->heapLen++;
+	heap_up (ver, host->heapIdx);
+}
+
+
+/**
+ * Function to move a host to a state.
+ */
+static void verify_set_state (wol_verify *ver, struct verify_host *host, int state)
+{
+	ver->counts [host->state]--;
+	host->state = state;
+	ver->counts [state]++;
+}
+
+
+/**
+ * Function to finish a host: deliver its result and release its slot.
+ */
+static void verify_finish (wol_verify *ver, struct verify_host *host, int state, long long now)
+{
+	wol_verify_result res;
+
+	verify_set_state (ver, host, state);
+	heap_remove (ver, (int)(host - ver->hosts));
+
+	memset (&res, 0, sizeof (res));
+	res.mac = host->mac;
+	strcpy (res.ipAddr, host->ipAddr);
+	res.state = state;
+	res.wakes = host->wakes;
+	res.probes = host->probes;
+	res.ttaUsec = (state == WOL_VERIFY_UP) ? (long)(now - host->firstWake) : 0;
+	res.arg = host->arg;
+
+	/** The host keeps its final state in the counts; the slot is reused. */
+	host->state = 0;
+	host->next = ver->freeList;
+	ver->freeList = (int)(host - ver->hosts);
+	ver->pending--;
+	ver->finished++;
+
+	if (host->cb != NULL) {
+		host->cb (&res);
+	}
+}
+
+
+static void verify_on_wake (const wol_async_result *result);
+static void verify_on_probe (const wol_async_result *result);
+
+
+/**
+ * Function to submit a host's magic packet, or retry shortly if the
+ * asynchronous engine is full.
+ */
+static void verify_wake (wol_verify *ver, struct verify_host *host, long long now)
+{
+	verify_set_state (ver, host, WOL_VERIFY_SENT);
+	heap_remove (ver, (int)(host - ver->hosts));
+	if (wol_async_wake (ver->async, host->mac, verify_on_wake, host) < 0) {
+		verify_set_timer (ver, host, now + VERIFY_RETRY_USEC);
+	}
+}
+
+
+/**
+ * Function to submit a host's echo request, or retry shortly if the
+ * asynchronous engine is full.
+ */
+static void verify_probe (wol_verify *ver, struct verify_host *host, long long now)
+{
+	heap_remove (ver, (int)(host - ver->hosts));
+	if (wol_async_probe (ver->async, host->ipAddr, ver->params.probeTimeoutMs, verify_on_probe, host) < 0) {
+		verify_set_timer (ver, host, now + VERIFY_RETRY_USEC);
+		return;
+	}
+	verify_set_state (ver, host, WOL_VERIFY_PROBING);
+	host->probes++;
+	host->lastProbe = now;
+}
+
+
+/**
+ * Callback for a completed magic packet send. Sent or not, the host waits
+ * to be probed; an unsent packet is covered by the next re-send.
+ */
+static void verify_on_wake (const wol_async_result *result)
+{
+	struct verify_host *host = result->arg;
+	wol_verify *ver = host->ver;
+	long long now = verify_now ();
+
+	if (host->wakes++ == 0) {
+		host->firstWake = now;
+		host->resendUsec = (long long)ver->params.resendMs * 1000;
+		host->resendAt = now + host->resendUsec;
+		verify_set_state (ver, host, WOL_VERIFY_WAITING);
+		verify_set_timer (ver, host, now + (long long)ver->params.bootDelayMs * 1000);
+	}
+	else {
+		verify_set_state (ver, host, WOL_VERIFY_WAITING);
+		verify_set_timer (ver, host, host->lastProbe + (long long)ver->params.probeIntervalMs * 1000);
+	}
+}
+
+
+/**
+ * Callback for a completed echo request. An answer finishes the host.
+ * Otherwise the host is probed again, re-woken when its re-send interval
+ * has passed, or failed when its last magic packet has gone unanswered.
+ */
+static void verify_on_probe (const wol_async_result *result)
+{
+	struct verify_host *host = result->arg;
+	wol_verify *ver = host->ver;
+	long long now = verify_now ();
+
+	if (result->status == 0) {
+		verify_finish (ver, host, WOL_VERIFY_UP, now);
+	}
+	else if (now < host->resendAt) {
+		verify_set_state (ver, host, WOL_VERIFY_WAITING);
+		verify_set_timer (ver, host, host->lastProbe + (long long)ver->params.probeIntervalMs * 1000);
+	}
+	else if (host->wakes >= ver->params.maxWakes) {
+		verify_finish (ver, host, WOL_VERIFY_FAILED, now);
+	}
+	else {
+		host->resendUsec *= ver->params.backoff;
+		host->resendAt = now + host->resendUsec;
+		verify_wake (ver, host, now);
+	}
+}
+
+
+/**
+ * Function to create a wake-and-verify engine. Wakes go to the broadcast
+ * address 255.255.255.255:60000, as send_wol() does.
+ *
+ * @param maxHosts - the maximum number of hosts being verified at once, at most 65000
+ * @param params - the verify timing, or NULL for the defaults
+ *
+ * @return the new engine, or NULL on failure. Probes need an ICMP socket, see pingIPWithTimeout().
+ */
+wol_verify *wol_verify_create (int maxHosts, const wol_verify_params *params)
+{
+	wol_verify *ver;
+	int i;
+
+	if (maxHosts <= 0 || maxHosts > 65000) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if ((ver = calloc (1, sizeof (wol_verify))) == NULL) {
+		return (NULL);
+	}
+	if (params != NULL) {
+		ver->params = *params;
+	}
+	if (ver->params.bootDelayMs <= 0) {
+		ver->params.bootDelayMs = 2000;
+	}
+	if (ver->params.probeIntervalMs <= 0) {
+		ver->params.probeIntervalMs = 1000;
+	}
+	if (ver->params.probeTimeoutMs <= 0) {
+		ver->params.probeTimeoutMs = 1000;
+	}
+	if (ver->params.resendMs <= 0) {
+		ver->params.resendMs = 30000;
+	}
+	if (ver->params.backoff <= 0) {
+		ver->params.backoff = 2;
+	}
+	if (ver->params.maxWakes <= 0) {
+		ver->params.maxWakes = 3;
+	}
+
+	ver->maxHosts = maxHosts;
+	ver->hosts = calloc (maxHosts, sizeof (struct verify_host));
+	ver->heap = malloc (maxHosts * sizeof (int));
+	if (ver->hosts == NULL || ver->heap == NULL ||
+		(ver->async = wol_async_create (maxHosts + 16, 0)) == NULL) {
+		wol_verify_destroy (ver);
+		return (NULL);
+	}
+	ver->freeList = -1;
+	for (i = maxHosts - 1; i >= 0; i--) {
+		ver->hosts [i].ver = ver;
+		ver->hosts [i].heapIdx = -1;
+		ver->hosts [i].next = ver->freeList;
+		ver->freeList = i;
+	}
+
+	return (ver);
+}
+
+
+/**
+ * Function to release a wake-and-verify engine. Hosts still being verified
+ * are abandoned without a result.
+ *
+ * @param ver - the engine to release, may be NULL
+ */
+void wol_verify_destroy (wol_verify *ver)
+{
+	if (ver == NULL) {
+		return;
+	}
+	wol_async_destroy (ver->async);
+	free (ver->hosts);
+	free (ver->heap);
+	free (ver);
+}
+
+
+/**
+ * Function to add a host: send its magic packet, and verify it comes up.
+ *
+ * @param ver - the engine
+ * @param mac - the packed MAC address to wake
+ * @param ipAddr - the IP address to probe, in dotted decimal
+ * @param cb - the result callback, or NULL to only count the host's state
+ * @param arg - the caller's argument, returned in the result
+ *
+ * @return 0 on success, -1 if the address is invalid or the engine is full
+ */
+int wol_verify_add (wol_verify *ver, wol_mac mac, const char *ipAddr, wol_verify_cb cb, void *arg)
+{
+	struct in_addr addr;
+	struct verify_host *host;
+
+	if (inet_pton (AF_INET, ipAddr, &addr) != 1) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (ver->freeList < 0) {
+		errno = EAGAIN;
+		return (-1);
+	}
+	host = &ver->hosts [ver->freeList];
+	ver->freeList = host->next;
+
+	host->mac = mac;
+	inet_ntop (AF_INET, &addr, host->ipAddr, sizeof (host->ipAddr));
+	host->wakes = 0;
+	host->probes = 0;
+	host->cb = cb;
+	host->arg = arg;
+	host->state = 0;
+	ver->counts [0]++;
+	ver->pending++;
+
+	verify_wake (ver, host, verify_now ());
+
+	return (0);
+}
+
+
+/**
+ * Function to drive the engine: send the wakes and probes that are due, and
+ * process the answers. Waits up to the timeout for at least one host to
+ * finish.
+ *
+ * @param ver - the engine
+ * @param timeoutMs - the longest time to wait, 0 to not wait, or -1 to wait
+ * until a host finishes
+ *
+ * @return the number of hosts finished, up or failed, by this call
+ */
+int wol_verify_poll (wol_verify *ver, int timeoutMs)
+{
+	long long start = verify_now ();
+
+	ver->finished = 0;
+
+	for (;;) {
+		long long now = verify_now ();
+		int waitMs = timeoutMs;
+
+		/** Take the actions that are due: re-tried wakes, and probes. */
+		while (ver->heapLen > 0 && ver->hosts [ver->heap [0]].timer <= now) {
+			struct verify_host *host = &ver->hosts [ver->heap [0]];
+
+			if (host->state == WOL_VERIFY_SENT) {
+				verify_wake (ver, host, now);
+			}
+			else {
+				verify_probe (ver, host, now);
+			}
+		}
+		wol_async_poll (ver->async, 0);
+
+		if (ver->finished > 0 || timeoutMs == 0 || ver->pending == 0) {
+			break;
+		}
+
+		/**
+		 * Wait no longer than the caller's timeout, nor past the next
+		 * host action.
+		 */
+		now = verify_now ();
+		if (timeoutMs > 0) {
+			waitMs = timeoutMs - (int)((now - start) / 1000);
+			if (waitMs <= 0) {
+				break;
+			}
+		}
+		if (ver->heapLen > 0) {
+			long long untilTimer = (ver->hosts [ver->heap [0]].timer - now + 999) / 1000;
+
+			if (waitMs < 0 || untilTimer < waitMs) {
+				waitMs = (int)untilTimer;
+			}
+		}
+		if (wol_async_pending (ver->async) > 0) {
+			wol_async_poll (ver->async, waitMs);
+		}
+		else {
+			poll (NULL, 0, waitMs);
+		}
+	}
+
+	return (ver->finished);
+}
+
+
+/**
+ * Function to get the number of hosts not yet up or failed.
+ *
+ * @param ver - the engine
+ *
+ * @return the number of hosts being verified
+ */
+int wol_verify_pending (const wol_verify *ver)
+{
+	return (ver->pending);
+}
+
+
+/**
+ * Function to count the hosts in a state, for progress reports. Finished
+ * hosts are counted in WOL_VERIFY_UP or WOL_VERIFY_FAILED.
+ *
+ * @param ver - the engine
+ * @param state - the state, WOL_VERIFY_*
+ *
+ * @return the number of hosts in the state
+ */
+int wol_verify_state (const wol_verify *ver, int state)
+{
+	if (state < WOL_VERIFY_SENT || state > WOL_VERIFY_FAILED) {
+		return (0);
+	}
+	return (ver->counts [state]);
+}
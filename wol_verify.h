@@ -0,0 +1,87 @@
+/**
+ * @file wol_verify.h
+ *
+ * @author Perry Spagnola
+ * @date 10/16/26 - created
+ * @version 1.0
+ * @brief Header file for wol_verify.c
+ * @details Provides the types and function prototypes of the wake-and-verify
+ * engine. Each host is woken, then probed until it answers, with the magic
+ * packet re-sent on a backoff, and its time to alive reported.
+ * @copyright Copyright 2026 Perry M. Spagnola. All rights reserved.
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef WOL_VERIFY_H
+#define WOL_VERIFY_H
+
+#include "wol_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Host states. */
+#define WOL_VERIFY_SENT     1   /**< magic packet submitted */
+#define WOL_VERIFY_WAITING  2   /**< waiting to probe */
+#define WOL_VERIFY_PROBING  3   /**< echo request outstanding */
+#define WOL_VERIFY_UP       4   /**< answered a probe */
+#define WOL_VERIFY_FAILED   5   /**< no answer after the last magic packet */
+
+/**
+ * Verify timing. Zero fields take the defaults in brackets.
+ */
+typedef struct wol_verify_params {
+	int bootDelayMs;                   /**< from a wake to the first probe [2000] */
+	int probeIntervalMs;               /**< between probes of one host [1000] */
+	int probeTimeoutMs;                /**< to wait for an echo reply [1000] */
+	int resendMs;                      /**< from the first wake to the first re-send [30000] */
+	int backoff;                       /**< the re-send interval multiplier [2] */
+	int maxWakes;                      /**< magic packets before failing [3] */
+} wol_verify_params;
+
+/**
+ * The result for one host.
+ */
+typedef struct wol_verify_result {
+	wol_mac mac;
+	char ipAddr [16];
+	int state;                         /**< WOL_VERIFY_UP or WOL_VERIFY_FAILED */
+	int wakes;                         /**< magic packets sent */
+	int probes;                        /**< echo requests sent */
+	long ttaUsec;                      /**< time to alive, from the first wake to the first reply */
+	void *arg;                         /**< the caller's argument */
+} wol_verify_result;
+
+/**
+ * The result callback. Invoked from wol_verify_poll(), on the polling thread.
+ */
+typedef void (*wol_verify_cb) (const wol_verify_result *result);
+
+/** Opaque wake-and-verify engine. */
+typedef struct wol_verify wol_verify;
+
+wol_verify *wol_verify_create (int maxHosts, const wol_verify_params *params);
+void wol_verify_destroy (wol_verify *ver);
+int wol_verify_add (wol_verify *ver, wol_mac mac, const char *ipAddr, wol_verify_cb cb, void *arg);
+int wol_verify_poll (wol_verify *ver, int timeoutMs);
+int wol_verify_pending (const wol_verify *ver);
+int wol_verify_state (const wol_verify *ver, int state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WOL_VERIFY_H */